@@ -0,0 +1,804 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+
+#include "cache_disque.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <kamikaze/context.h>
+#include <kamikaze/geomlists.h>
+#include <kamikaze/mesh.h>
+#include <kamikaze/noeud.h>
+#include <kamikaze/operateur.h>
+#include <kamikaze/prim_points.h>
+#include <kamikaze/primitive.h>
+#include <kamikaze/segmentprim.h>
+#include <kamikaze/trace.h>
+
+#include "graphs/object_graph.h"
+
+#include "object.h"
+
+namespace kamikaze {
+
+/* ************************************************************************** */
+
+static constexpr char MAGIE[8] = { 'K', 'M', 'K', 'C', 'A', 'C', 'H', 'E' };
+static constexpr uint32_t VERSION_FICHIER = 1;
+static constexpr uint64_t ALIGNEMENT = 64;
+static constexpr size_t TAILLE_NOM = 64;
+
+enum {
+	PRIM_MAILLAGE = 0,
+	PRIM_POINTS = 1,
+	PRIM_SEGMENTS = 2,
+};
+
+enum {
+	BLOC_POINTS = 0,
+	BLOC_INDEX = 1,
+	BLOC_DECALAGES = 2,
+	BLOC_ARETES = 3,
+	BLOC_ATTRIBUT = 4,
+};
+
+struct EnTeteFichier {
+	char magie[8];
+	uint32_t version;
+	int32_t image;
+	/* Commun à toutes les images d'un même précalcul : un renvoi vers le
+	 * fichier d'une autre image n'est suivi que si les identifiants sont
+	 * égaux. */
+	uint64_t identifiant;
+	uint64_t taille;
+	uint32_t nombre_primitives;
+	uint32_t nombre_blocs;
+};
+
+struct EnTetePrimitive {
+	uint32_t type;
+	uint32_t premier_bloc;
+	uint32_t nombre_blocs;
+	uint32_t sommets_par_polygone;
+	uint64_t nombre_polygones;
+	uint32_t disposition;
+	uint32_t bourrage;
+	char nom[TAILLE_NOM];
+};
+
+struct EnTeteBloc {
+	uint32_t genre;
+	int32_t type_attribut;
+	uint64_t nombre;
+	/* Position et taille en octets des données dans le fichier de l'image
+	 * image_source. */
+	uint64_t decalage;
+	uint64_t taille;
+	int32_t image_source;
+	uint32_t bourrage;
+	char nom[TAILLE_NOM];
+};
+
+static uint64_t aligne(uint64_t decalage)
+{
+	return (decalage + ALIGNEMENT - 1) & ~(ALIGNEMENT - 1);
+}
+
+static void copie_nom(char (&destination)[TAILLE_NOM], const std::string &nom)
+{
+	std::memset(destination, 0, TAILLE_NOM);
+	std::memcpy(destination, nom.c_str(), std::min(nom.size(), TAILLE_NOM - 1));
+}
+
+static std::string lis_nom(const char (&source)[TAILLE_NOM])
+{
+	return std::string(source, strnlen(source, TAILLE_NOM));
+}
+
+static size_t taille_type_attribut(int32_t type)
+{
+	switch (type) {
+		case ATTR_TYPE_BYTE:
+			return sizeof(char);
+		case ATTR_TYPE_INT:
+			return sizeof(int);
+		case ATTR_TYPE_FLOAT:
+			return sizeof(float);
+		case ATTR_TYPE_VEC2:
+			return sizeof(glm::vec2);
+		case ATTR_TYPE_VEC3:
+			return sizeof(glm::vec3);
+		case ATTR_TYPE_VEC4:
+			return sizeof(glm::vec4);
+		case ATTR_TYPE_MAT3:
+			return sizeof(glm::mat3);
+		case ATTR_TYPE_MAT4:
+			return sizeof(glm::mat4);
+		default:
+			break;
+	}
+
+	/* Les chaînes de caractères ne sont pas précalculées. */
+	return 0;
+}
+
+/* Retourne la taille d'un élément du bloc, ou zéro si le bloc n'a pas de sens
+ * pour la primitive. */
+static size_t taille_element(const EnTeteBloc &bloc, const EnTetePrimitive &prim)
+{
+	switch (bloc.genre) {
+		case BLOC_POINTS:
+			if (prim.disposition == DISPOSITION_VOIES_ALIGNEES) {
+				return 4 * sizeof(float);
+			}
+
+			return (prim.disposition == DISPOSITION_AOS) ? sizeof(glm::vec3) : 0;
+		case BLOC_INDEX:
+			return (prim.type == PRIM_MAILLAGE) ? sizeof(unsigned int) : 0;
+		case BLOC_DECALAGES:
+			if (prim.type != PRIM_MAILLAGE || bloc.nombre != prim.nombre_polygones + 1) {
+				return 0;
+			}
+
+			return sizeof(unsigned int);
+		case BLOC_ARETES:
+			return (prim.type == PRIM_SEGMENTS) ? sizeof(glm::uvec2) : 0;
+		case BLOC_ATTRIBUT:
+			return taille_type_attribut(bloc.type_attribut);
+		default:
+			break;
+	}
+
+	return 0;
+}
+
+filesystem::path chemin_image(const filesystem::path &dossier, int image)
+{
+	return dossier / ("image_" + std::to_string(image) + ".kmkc");
+}
+
+/* ************************************************************************** */
+
+struct BlocADecrire {
+	EnTeteBloc entete;
+	const void *donnees;
+};
+
+static void ajoute_bloc(
+		std::vector<BlocADecrire> &blocs,
+		uint32_t genre,
+		const void *donnees,
+		uint64_t nombre,
+		uint64_t taille,
+		const std::string &nom = "",
+		int32_t type_attribut = ATTR_TYPE_INVALID)
+{
+	auto bloc = BlocADecrire{};
+	bloc.entete.genre = genre;
+	bloc.entete.type_attribut = type_attribut;
+	bloc.entete.nombre = nombre;
+	bloc.entete.taille = taille;
+	bloc.donnees = donnees;
+	copie_nom(bloc.entete.nom, nom);
+
+	blocs.push_back(bloc);
+}
+
+static void decris_points(std::vector<BlocADecrire> &blocs, EnTetePrimitive &entete, const PointList &points)
+{
+	entete.disposition = points.disposition();
+	ajoute_bloc(blocs, BLOC_POINTS, points.data(), points.size(), points.byte_size());
+}
+
+/* Décrit les blocs de la primitive ; retourne faux si son type n'est pas
+ * précalculé. */
+static bool decris_primitive(
+		const Primitive *prim,
+		EnTetePrimitive &entete,
+		std::vector<BlocADecrire> &blocs)
+{
+	entete = EnTetePrimitive{};
+	entete.premier_bloc = static_cast<uint32_t>(blocs.size());
+
+	if (prim->typeID() == Mesh::id) {
+		auto maillage = static_cast<const Mesh *>(prim);
+		auto polys = maillage->polys();
+
+		entete.type = PRIM_MAILLAGE;
+		entete.nombre_polygones = polys->size();
+		entete.sommets_par_polygone = polys->sommets_par_polygone();
+
+		decris_points(blocs, entete, *maillage->points());
+		ajoute_bloc(blocs, BLOC_INDEX, polys->data(), polys->nombre_index(),
+		            polys->nombre_index() * sizeof(unsigned int));
+
+		if (!polys->est_uniforme()) {
+			ajoute_bloc(blocs, BLOC_DECALAGES, polys->decalages(), polys->size() + 1,
+			            (polys->size() + 1) * sizeof(unsigned int));
+		}
+	}
+	else if (prim->typeID() == PrimPoints::id) {
+		entete.type = PRIM_POINTS;
+		decris_points(blocs, entete, *static_cast<const PrimPoints *>(prim)->points());
+	}
+	else if (prim->typeID() == SegmentPrim::id) {
+		auto segments = static_cast<const SegmentPrim *>(prim);
+		auto aretes = segments->edges();
+
+		entete.type = PRIM_SEGMENTS;
+		decris_points(blocs, entete, *segments->points());
+		ajoute_bloc(blocs, BLOC_ARETES, aretes->data(), aretes->size(), aretes->byte_size());
+	}
+	else {
+		return false;
+	}
+
+	for (const auto &attribut : prim->attributes()) {
+		if (taille_type_attribut(attribut->type()) == 0 || attribut->name().size() >= TAILLE_NOM) {
+			continue;
+		}
+
+		ajoute_bloc(blocs, BLOC_ATTRIBUT, attribut->data(), attribut->size(),
+		            attribut->byte_size(), attribut->name(), attribut->type());
+	}
+
+	entete.nombre_blocs = static_cast<uint32_t>(blocs.size()) - entete.premier_bloc;
+
+	return true;
+}
+
+static std::string cle_bloc(size_t index_prim, const EnTeteBloc &bloc)
+{
+	return std::to_string(index_prim) + '/' + std::to_string(bloc.genre) + '/'
+	        + std::to_string(bloc.type_attribut) + '/' + bloc.nom;
+}
+
+EcrivainCache::EcrivainCache(const filesystem::path &dossier)
+    : m_dossier(dossier)
+    , m_identifiant(static_cast<uint64_t>(
+                        std::chrono::system_clock::now().time_since_epoch().count()))
+{}
+
+EcrivainCache::~EcrivainCache() = default;
+
+erreur_fichier EcrivainCache::ecris_image(int image, const PrimitiveCollection &collection)
+{
+	PorteeTrace trace("fichier", "Écriture précalcul", image);
+
+	/* Les blocs sont décrits depuis une copie, qui partage le stockage de la
+	 * collection et le gardera en vie pour comparer l'image suivante. */
+	auto copie = std::unique_ptr<PrimitiveCollection>(collection.copy());
+
+	auto prims = std::vector<EnTetePrimitive>{};
+	auto blocs = std::vector<BlocADecrire>{};
+	auto cles = std::vector<std::string>{};
+
+	for (size_t i = 0; i < copie->primitives().size(); ++i) {
+		auto entete = EnTetePrimitive{};
+		const auto premier_bloc = blocs.size();
+
+		if (!decris_primitive(copie->primitives()[i], entete, blocs)) {
+			continue;
+		}
+
+		/* La copie a renommé ses primitives pour que leurs noms soient
+		 * uniques, garde ceux de la collection. */
+		copie_nom(entete.nom, collection.primitives()[i]->name());
+
+		for (auto i = premier_bloc; i < blocs.size(); ++i) {
+			cles.push_back(cle_bloc(prims.size(), blocs[i].entete));
+		}
+
+		prims.push_back(entete);
+	}
+
+	auto entete = EnTeteFichier{};
+	std::memcpy(entete.magie, MAGIE, sizeof(MAGIE));
+	entete.version = VERSION_FICHIER;
+	entete.image = image;
+	entete.identifiant = m_identifiant;
+	entete.nombre_primitives = static_cast<uint32_t>(prims.size());
+	entete.nombre_blocs = static_cast<uint32_t>(blocs.size());
+
+	auto decalage = static_cast<uint64_t>(sizeof(EnTeteFichier)
+	                                      + prims.size() * sizeof(EnTetePrimitive)
+	                                      + blocs.size() * sizeof(EnTeteBloc));
+
+	auto blocs_ecrits = std::unordered_map<std::string, BlocEcrit>{};
+
+	for (size_t i = 0; i < blocs.size(); ++i) {
+		auto &bloc = blocs[i].entete;
+		const auto donnees = blocs[i].donnees;
+		const auto iter = m_blocs_precedents.find(cles[i]);
+
+		if (iter != m_blocs_precedents.end() && iter->second.taille == bloc.taille
+		    && (iter->second.donnees == donnees
+		        || std::memcmp(iter->second.donnees, donnees, bloc.taille) == 0))
+		{
+			bloc.decalage = iter->second.decalage;
+			bloc.image_source = iter->second.image_source;
+		}
+		else {
+			decalage = aligne(decalage);
+			bloc.decalage = decalage;
+			bloc.image_source = image;
+			decalage += bloc.taille;
+		}
+
+		blocs_ecrits[cles[i]] = BlocEcrit{ donnees, bloc.taille, bloc.decalage, bloc.image_source };
+	}
+
+	entete.taille = decalage;
+
+	/* Écrit dans un fichier temporaire, puis le renomme : les projections
+	 * de l'ancien fichier restent valides. */
+	const auto chemin = chemin_image(m_dossier, image);
+	auto chemin_temporaire = chemin;
+	chemin_temporaire += ".tmp";
+
+	std::error_code erreur;
+	filesystem::create_directories(m_dossier, erreur);
+
+	std::ofstream fichier(chemin_temporaire.c_str(), std::ios::binary | std::ios::trunc);
+
+	if (!fichier.is_open()) {
+		return NON_OUVERT;
+	}
+
+	fichier.write(reinterpret_cast<const char *>(&entete), sizeof(EnTeteFichier));
+
+	for (const auto &prim : prims) {
+		fichier.write(reinterpret_cast<const char *>(&prim), sizeof(EnTetePrimitive));
+	}
+
+	for (const auto &bloc : blocs) {
+		fichier.write(reinterpret_cast<const char *>(&bloc.entete), sizeof(EnTeteBloc));
+	}
+
+	static const char zeros[ALIGNEMENT] = {};
+
+	for (const auto &bloc : blocs) {
+		if (bloc.entete.image_source != image) {
+			continue;
+		}
+
+		const auto position = static_cast<uint64_t>(fichier.tellp());
+		fichier.write(zeros, static_cast<std::streamsize>(bloc.entete.decalage - position));
+		fichier.write(static_cast<const char *>(bloc.donnees),
+		              static_cast<std::streamsize>(bloc.entete.taille));
+	}
+
+	fichier.close();
+
+	if (!fichier) {
+		filesystem::remove(chemin_temporaire, erreur);
+		return INCONNU;
+	}
+
+	filesystem::rename(chemin_temporaire, chemin, erreur);
+
+	if (erreur) {
+		return INCONNU;
+	}
+
+	m_precedente = std::move(copie);
+	m_blocs_precedents = std::move(blocs_ecrits);
+
+	return AUCUNE_ERREUR;
+}
+
+/* ************************************************************************** */
+
+/**
+ * Vérifie que les polygones décrits par les index et les décalages ne lisent
+ * que des points existants, car ils sont partagés tels quels avec le maillage.
+ * Les décalages sont nuls si tous les polygones ont sommets_par_polygone
+ * sommets.
+ */
+static bool polygones_valides(
+        const EnTetePrimitive &prim,
+        const unsigned int *index,
+        uint64_t nombre_index,
+        const unsigned int *decalages,
+        uint64_t nombre_decalages,
+        uint64_t nombre_points)
+{
+	for (auto i = 0ul; i < nombre_index; ++i) {
+		if (index[i] >= nombre_points) {
+			return false;
+		}
+	}
+
+	if (decalages == nullptr) {
+		return nombre_index == prim.nombre_polygones * prim.sommets_par_polygone;
+	}
+
+	if (nombre_decalages != prim.nombre_polygones + 1 || decalages[0] != 0) {
+		return false;
+	}
+
+	for (auto i = 1ul; i < nombre_decalages; ++i) {
+		if (decalages[i] < decalages[i - 1]) {
+			return false;
+		}
+	}
+
+	return decalages[nombre_decalages - 1] <= nombre_index;
+}
+
+struct LecteurCache::Projection {
+	const char *donnees = nullptr;
+	size_t taille = 0;
+
+	Projection(const char *d, size_t t)
+	    : donnees(d)
+	    , taille(t)
+	{}
+
+	~Projection()
+	{
+		munmap(const_cast<char *>(donnees), taille);
+	}
+
+	Projection(const Projection &) = delete;
+	Projection &operator=(const Projection &) = delete;
+
+	const EnTeteFichier &entete() const
+	{
+		return *reinterpret_cast<const EnTeteFichier *>(donnees);
+	}
+};
+
+LecteurCache::LecteurCache(const filesystem::path &dossier)
+    : m_dossier(dossier)
+{}
+
+LecteurCache::~LecteurCache() = default;
+
+const filesystem::path &LecteurCache::dossier() const
+{
+	return m_dossier;
+}
+
+erreur_fichier LecteurCache::projette(int image, std::shared_ptr<const Projection> &projection)
+{
+	std::unique_lock<std::mutex> verrou(m_mutex);
+
+	auto iter = m_projections.find(image);
+
+	if (iter != m_projections.end()) {
+		projection = iter->second;
+		return AUCUNE_ERREUR;
+	}
+
+	verrou.unlock();
+
+	const auto chemin = chemin_image(m_dossier, image);
+	const auto fd = open(chemin.c_str(), O_RDONLY);
+
+	if (fd == -1) {
+		return NON_TROUVE;
+	}
+
+	struct stat etat;
+
+	if (fstat(fd, &etat) == -1 || static_cast<size_t>(etat.st_size) < sizeof(EnTeteFichier)) {
+		close(fd);
+		return CORROMPU;
+	}
+
+	const auto taille = static_cast<size_t>(etat.st_size);
+	auto adresse = mmap(nullptr, taille, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	/* La projection reste valide après la fermeture du descripteur. */
+	close(fd);
+
+	if (adresse == MAP_FAILED) {
+		return NON_OUVERT;
+	}
+
+	auto nouvelle = std::make_shared<const Projection>(static_cast<const char *>(adresse), taille);
+	const auto &entete = nouvelle->entete();
+
+	if (std::memcmp(entete.magie, MAGIE, sizeof(MAGIE)) != 0
+	    || entete.version != VERSION_FICHIER
+	    || entete.image != image
+	    || entete.taille != taille)
+	{
+		return CORROMPU;
+	}
+
+	verrou.lock();
+	projection = m_projections.emplace(image, std::move(nouvelle)).first->second;
+
+	return AUCUNE_ERREUR;
+}
+
+erreur_fichier LecteurCache::charge_image(int image, PrimitiveCollection &collection)
+{
+	PorteeTrace trace("fichier", "Lecture précalcul", image);
+
+	auto projection = std::shared_ptr<const Projection>();
+	auto erreur = projette(image, projection);
+
+	if (erreur != AUCUNE_ERREUR) {
+		return erreur;
+	}
+
+	const auto &entete = projection->entete();
+	const auto taille_entetes = sizeof(EnTeteFichier)
+	                            + entete.nombre_primitives * sizeof(EnTetePrimitive)
+	                            + entete.nombre_blocs * sizeof(EnTeteBloc);
+
+	if (taille_entetes > projection->taille) {
+		return CORROMPU;
+	}
+
+	auto prims = reinterpret_cast<const EnTetePrimitive *>(projection->donnees + sizeof(EnTeteFichier));
+	auto blocs = reinterpret_cast<const EnTeteBloc *>(prims + entete.nombre_primitives);
+
+	/* Vérifie tous les blocs avant de toucher à la collection, et résout les
+	 * renvois vers les fichiers des autres images. */
+	auto sources = std::vector<std::shared_ptr<const Projection>>(entete.nombre_blocs);
+
+	for (uint32_t i = 0; i < entete.nombre_primitives; ++i) {
+		const auto &prim = prims[i];
+
+		if (prim.premier_bloc + static_cast<uint64_t>(prim.nombre_blocs) > entete.nombre_blocs) {
+			return CORROMPU;
+		}
+
+		auto nombre_points = 0ul;
+		const unsigned int *index = nullptr;
+		auto nombre_index = 0ul;
+		const unsigned int *decalages = nullptr;
+		auto nombre_decalages = 0ul;
+		const glm::uvec2 *aretes = nullptr;
+		auto nombre_aretes = 0ul;
+
+		for (auto j = prim.premier_bloc; j < prim.premier_bloc + prim.nombre_blocs; ++j) {
+			const auto &bloc = blocs[j];
+
+			if (bloc.image_source == image) {
+				sources[j] = projection;
+			}
+			else {
+				erreur = projette(bloc.image_source, sources[j]);
+
+				if (erreur != AUCUNE_ERREUR) {
+					return erreur;
+				}
+
+				if (sources[j]->entete().identifiant != entete.identifiant) {
+					return CORROMPU;
+				}
+			}
+
+			const auto element = taille_element(bloc, prim);
+
+			if (element == 0 || bloc.taille != bloc.nombre * element
+			    || bloc.decalage % ALIGNEMENT != 0
+			    || bloc.decalage + bloc.taille > sources[j]->taille)
+			{
+				return CORROMPU;
+			}
+
+			const auto donnees = sources[j]->donnees + bloc.decalage;
+
+			switch (bloc.genre) {
+				case BLOC_POINTS:
+					nombre_points = bloc.nombre;
+					break;
+				case BLOC_INDEX:
+					index = reinterpret_cast<const unsigned int *>(donnees);
+					nombre_index = bloc.nombre;
+					break;
+				case BLOC_DECALAGES:
+					decalages = reinterpret_cast<const unsigned int *>(donnees);
+					nombre_decalages = bloc.nombre;
+					break;
+				case BLOC_ARETES:
+					aretes = reinterpret_cast<const glm::uvec2 *>(donnees);
+					nombre_aretes = bloc.nombre;
+					break;
+			}
+		}
+
+		/* Les index sont partagés sans copie, et lus sans vérification. */
+		if (prim.type == PRIM_MAILLAGE && index != nullptr
+		    && !polygones_valides(prim, index, nombre_index, decalages, nombre_decalages, nombre_points))
+		{
+			return CORROMPU;
+		}
+
+		for (auto a = 0ul; a < nombre_aretes; ++a) {
+			if (aretes[a].x >= nombre_points || aretes[a].y >= nombre_points) {
+				return CORROMPU;
+			}
+		}
+	}
+
+	collection.free_all();
+
+	for (uint32_t i = 0; i < entete.nombre_primitives; ++i) {
+		const auto &prim = prims[i];
+		Primitive *primitive = nullptr;
+		PointList *points = nullptr;
+
+		switch (prim.type) {
+			case PRIM_MAILLAGE:
+			{
+				auto maillage = static_cast<Mesh *>(collection.build("Mesh"));
+				points = maillage->points();
+				primitive = maillage;
+				break;
+			}
+			case PRIM_POINTS:
+			{
+				auto nuage = static_cast<PrimPoints *>(collection.build("PrimPoints"));
+				points = nuage->points();
+				primitive = nuage;
+				break;
+			}
+			case PRIM_SEGMENTS:
+			{
+				auto segments = static_cast<SegmentPrim *>(collection.build("SegmentPrim"));
+				points = segments->points();
+				primitive = segments;
+				break;
+			}
+			default:
+				continue;
+		}
+
+		primitive->name(lis_nom(prim.nom));
+
+		const unsigned int *index = nullptr;
+		const unsigned int *decalages = nullptr;
+		auto nombre_index = 0ul;
+		auto source_index = std::shared_ptr<const Projection>();
+		auto source_decalages = std::shared_ptr<const Projection>();
+
+		for (auto j = prim.premier_bloc; j < prim.premier_bloc + prim.nombre_blocs; ++j) {
+			const auto &bloc = blocs[j];
+			const auto donnees = sources[j]->donnees + bloc.decalage;
+
+			switch (bloc.genre) {
+				case BLOC_POINTS:
+					points->partage_externe(static_cast<disposition_points>(prim.disposition),
+					                        donnees, bloc.nombre, sources[j]);
+					break;
+				case BLOC_INDEX:
+					index = reinterpret_cast<const unsigned int *>(donnees);
+					nombre_index = bloc.nombre;
+					source_index = sources[j];
+					break;
+				case BLOC_DECALAGES:
+					decalages = reinterpret_cast<const unsigned int *>(donnees);
+					source_decalages = sources[j];
+					break;
+				case BLOC_ARETES:
+					static_cast<SegmentPrim *>(primitive)->edges()->partage_externe(
+					            reinterpret_cast<const glm::uvec2 *>(donnees),
+					            bloc.nombre, sources[j]);
+					break;
+				case BLOC_ATTRIBUT:
+				{
+					auto attribut = primitive->add_attribute(
+					                    lis_nom(bloc.nom),
+					                    static_cast<AttributeType>(bloc.type_attribut),
+					                    bloc.nombre);
+
+					visit_attribute(*attribut, [&](auto vue)
+					{
+						std::memcpy(static_cast<void *>(vue.data()), donnees, bloc.taille);
+					});
+
+					break;
+				}
+			}
+		}
+
+		if (prim.type == PRIM_MAILLAGE && index != nullptr) {
+			/* Les index et les décalages peuvent venir de fichiers différents,
+			 * les deux projections doivent alors rester en vie. */
+			auto proprietaire = std::shared_ptr<const void>(source_index);
+
+			if (source_decalages != nullptr && source_decalages != source_index) {
+				proprietaire = std::make_shared<const std::pair<std::shared_ptr<const Projection>,
+				                                                std::shared_ptr<const Projection>>>(
+				                   source_index, source_decalages);
+			}
+
+			static_cast<Mesh *>(primitive)->polys()->partage_externe(
+			            index, nombre_index, decalages, prim.nombre_polygones,
+			            prim.sommets_par_polygone, std::move(proprietaire));
+		}
+
+		primitive->tagUpdate();
+	}
+
+	return AUCUNE_ERREUR;
+}
+
+void LecteurCache::vide()
+{
+	std::unique_lock<std::mutex> verrou(m_mutex);
+	m_projections.clear();
+}
+
+/* ************************************************************************** */
+
+erreur_fichier precalcule_objet(const Context &contexte, Object *objet, int debut, int fin)
+{
+	const auto dossier = objet->eval_string("bake_directory");
+
+	if (dossier.empty()) {
+		return NON_TROUVE;
+	}
+
+	auto noeud_sortie = objet->graph()->sortie();
+	auto operateur = noeud_sortie->operateur();
+
+	auto ecrivain = EcrivainCache(dossier);
+
+	for (auto image = debut; image <= fin; ++image) {
+		/* Force l'évaluation de tout le graphe pour cette image. */
+		signifie_sale_amont(noeud_sortie);
+		execute_operateur(operateur, contexte, image);
+
+		/* Le résultat d'une évaluation annulée est incomplet. */
+		if (evaluation_annulee(contexte)) {
+			break;
+		}
+
+		if (operateur->collection() == nullptr) {
+			continue;
+		}
+
+		const auto erreur = ecrivain.ecris_image(image, *operateur->collection());
+
+		if (erreur != AUCUNE_ERREUR) {
+			return erreur;
+		}
+	}
+
+	auto lecteur = objet->lecteur_cache();
+
+	if (lecteur != nullptr) {
+		lecteur->vide();
+	}
+
+	return AUCUNE_ERREUR;
+}
+
+}  /* namespace kamikaze */
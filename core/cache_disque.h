@@ -0,0 +1,133 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "sauvegarde.h"
+
+class Context;
+class Object;
+class PrimitiveCollection;
+
+namespace kamikaze {
+
+/**
+ * Précalcul (« bake ») de la géométrie animée d'un objet : la collection
+ * évaluée pour chaque image est écrite dans un fichier binaire, puis relue
+ * en projetant le fichier en mémoire, sans analyse ni copie des points et des
+ * polygones, qui lisent directement les pages du fichier.
+ *
+ * Les données de chaque bloc (positions, index, décalages, arêtes, chaque
+ * attribut) sont alignées sur 64 octets. Un bloc identique à celui de l'image
+ * précédente n'est pas réécrit : l'en-tête renvoie vers le fichier de l'image
+ * où il a été écrit la première fois. La topologie et les attributs statiques
+ * ne sont ainsi stockés qu'une fois par précalcul.
+ */
+
+/**
+ * Retourne le chemin du fichier de l'image donnée dans le dossier d'un
+ * précalcul.
+ */
+filesystem::path chemin_image(const filesystem::path &dossier, int image);
+
+class EcrivainCache {
+	struct BlocEcrit {
+		const void *donnees = nullptr;
+		uint64_t taille = 0;
+		uint64_t decalage = 0;
+		int32_t image_source = 0;
+	};
+
+	filesystem::path m_dossier;
+	uint64_t m_identifiant;
+
+	/* Copie de la collection de l'image précédente : elle partage le stockage
+	 * de l'originale, et garde en vie les données des blocs déjà écrits. */
+	std::unique_ptr<PrimitiveCollection> m_precedente;
+	std::unordered_map<std::string, BlocEcrit> m_blocs_precedents{};
+
+public:
+	explicit EcrivainCache(const filesystem::path &dossier);
+	~EcrivainCache();
+
+	EcrivainCache(const EcrivainCache &) = delete;
+	EcrivainCache &operator=(const EcrivainCache &) = delete;
+
+	/**
+	 * Écrit la collection dans le fichier de l'image. Les images doivent être
+	 * écrites dans l'ordre, chaque fichier pouvant renvoyer vers ceux des
+	 * images précédentes.
+	 */
+	erreur_fichier ecris_image(int image, const PrimitiveCollection &collection);
+};
+
+class LecteurCache {
+	struct Projection;
+
+	filesystem::path m_dossier;
+
+	std::mutex m_mutex{};
+	std::unordered_map<int, std::shared_ptr<const Projection>> m_projections{};
+
+	erreur_fichier projette(int image, std::shared_ptr<const Projection> &projection);
+
+public:
+	explicit LecteurCache(const filesystem::path &dossier);
+	~LecteurCache();
+
+	LecteurCache(const LecteurCache &) = delete;
+	LecteurCache &operator=(const LecteurCache &) = delete;
+
+	const filesystem::path &dossier() const;
+
+	/**
+	 * Remplace le contenu de la collection par celui de l'image. Les points,
+	 * les polygones et les arêtes lisent la projection du fichier, et ne sont
+	 * copiés qu'au premier accès en écriture ; les attributs sont copiés.
+	 * La collection n'est pas modifiée en cas d'erreur.
+	 */
+	erreur_fichier charge_image(int image, PrimitiveCollection &collection);
+
+	/**
+	 * Oublie les fichiers projetés, par exemple après un nouveau précalcul.
+	 */
+	void vide();
+};
+
+/**
+ * Évalue le graphe de l'objet pour chaque image de [debut, fin], et écrit le
+ * résultat dans le dossier de précalcul de l'objet. S'arrête dès que
+ * l'évaluation est annulée, les images déjà écrites restant valides. Aucune
+ * passe ne doit évaluer le graphe en même temps : voir Depsgraph::bake.
+ */
+erreur_fichier precalcule_objet(const Context &contexte, Object *objet, int debut, int fin);
+
+}  /* namespace kamikaze */
@@ -26,18 +26,24 @@
 
 #include <algorithm>
 #include <cassert>
+#include <functional>
 #include <iostream>
+#include <unordered_set>
 
 #include <kamikaze/context.h>
+#include <kamikaze/noeud.h>
 #include <kamikaze/operateur.h>
+#include <kamikaze/outils/empreinte.h>
+#include <kamikaze/trace.h>
 
+#include <tbb/task_group.h>
 #include <tbb/tick_count.h>
 
 #include "graph_dumper.h"
-#include "graph_tools.h"
 
 #include "operateurs/operateurs_standards.h"
 
+#include "cache_disque.h"
 #include "object.h"
 #include "object_graph.h"
 #include "scene.h"
@@ -79,18 +85,18 @@ DepsObjectNode::DepsObjectNode(Object *object)
     : m_object(object)
 {}
 
-void DepsObjectNode::pre_process()
-{
-	/* TODO: what's the purpose of this again? */
-	m_object->collection(nullptr);
-}
-
 void DepsObjectNode::process(const Context & /*context*/, TaskNotifier */*notifier*/)
 {
 	/* The graph should already have been updated. */
 	auto graph = m_object->graph();
 	auto noeud_sortie = graph->sortie();
-	m_object->collection(noeud_sortie->operateur()->collection());
+	auto collection = noeud_sortie->operateur()->collection();
+
+	/* The output of the graph is modified by the next evaluation, while the UI
+	 * may still draw it: publish a copy instead. The buffers of the copied
+	 * primitives are shared until either side writes to them, so this does
+	 * not copy the geometry. */
+	m_object->publie_collection(std::shared_ptr<PrimitiveCollection>(collection->copy()));
 }
 
 Object *DepsObjectNode::object()
@@ -103,20 +109,78 @@ const Object *DepsObjectNode::object() const
 	return m_object;
 }
 
-const char *DepsObjectNode::name() const
+std::string DepsObjectNode::name() const
 {
-	return m_object->name().c_str();
+	return m_object->name();
 }
 
 /* ************************************************************************** */
 
-ObjectGraphDepsNode::ObjectGraphDepsNode(Graph *graph)
-    : m_graph(graph)
+static uint64_t next_node_identity()
+{
+	static std::atomic<uint64_t> identity{0};
+	return ++identity;
+}
+
+ObjectGraphDepsNode::ObjectGraphDepsNode(Object *object, CacheResultats *frame_cache)
+    : m_object(object)
+    , m_graph(object->graph())
+    , m_frame_cache(frame_cache)
+    , m_identity(next_node_identity())
 {}
 
 void ObjectGraphDepsNode::process(const Context &context, TaskNotifier */*notifier*/)
 {
 	auto noeud_sortie = m_graph->sortie();
+	auto operateur = noeud_sortie->operateur();
+	const auto frame = context.scene->currentFrame();
+
+	/* The hashes of the graph are computed once, for the frame cache key and
+	 * for the result cache of every operator. */
+	PorteeEmpreintes hashes;
+
+	/* Frames missing from the bake are evaluated. */
+	auto lecteur = m_object->lecteur_cache();
+
+	if (m_object->lit_precalcul() && lecteur != nullptr && operateur->collection() != nullptr) {
+		if (lecteur->charge_image(frame, *operateur->collection()) == kamikaze::AUCUNE_ERREUR) {
+			/* The output no longer matches the graph's result. */
+			operateur->supprime_avertissements();
+			operateur->besoin_execution(true);
+			return;
+		}
+	}
+
+	auto key = EMPREINTE_INVALIDE;
+	auto check = EMPREINTE_INVALIDE;
+
+	/* The frames are only shared with this node: the graphs of two objects
+	 * can have the same configuration and still give other results. Graphs
+	 * with non-deterministic operators, which have no valid configuration
+	 * hash, are not cached: their operators may keep a state from one frame
+	 * to the next, like simulations, which serving a frame would not update. */
+	if (operateur->empreinte() == EMPREINTE_INVALIDE && operateur->empreinte_configuration() != EMPREINTE_INVALIDE) {
+		const auto generation = m_generation.load();
+
+		key = combine_empreinte(m_identity, generation);
+		key = combine_empreinte(key, static_cast<uint64_t>(frame));
+
+		check = combine_empreinte(GRAINE_VERIFICATION, m_identity);
+		check = combine_empreinte(check, generation);
+		check = combine_empreinte(check, static_cast<uint64_t>(frame));
+	}
+
+	auto warnings = std::vector<std::string>{};
+
+	if (m_frame_cache->cherche(key, check, *operateur->collection(), warnings)) {
+		operateur->supprime_avertissements();
+
+		for (const auto &warning : warnings) {
+			operateur->ajoute_avertissement(warning);
+		}
+
+		return;
+	}
 
 	/* À FAIRE : NOTIFIE PROGRESSION. */
 
@@ -126,7 +190,13 @@ void ObjectGraphDepsNode::process(const Context &context, TaskNotifier */*notifi
 	}
 #endif
 
-	execute_operateur(noeud_sortie->operateur(), context, context.scene->currentFrame());
+	execute_operateur(operateur, context, frame);
+
+	if (evaluation_annulee(context)) {
+		return;
+	}
+
+	m_frame_cache->ajoute(key, check, *operateur->collection(), operateur->avertissements());
 
 #if 0
 	if (notifier) {
@@ -141,6 +211,11 @@ void ObjectGraphDepsNode::process(const Context &context, TaskNotifier */*notifi
 #endif
 }
 
+void ObjectGraphDepsNode::invalidate_frame_cache()
+{
+	++m_generation;
+}
+
 Graph *ObjectGraphDepsNode::graph()
 {
 	return m_graph;
@@ -151,9 +226,10 @@ const Graph *ObjectGraphDepsNode::graph() const
 	return m_graph;
 }
 
-const char *ObjectGraphDepsNode::name() const
+std::string ObjectGraphDepsNode::name() const
 {
-	return "Object Graph";
+	/* Tells the graphs of the objects apart in the traces. */
+	return m_object->name() + " Graph";
 }
 
 /* ************************************************************************** */
@@ -163,7 +239,7 @@ void TimeDepsNode::process(const Context & /*context*/, TaskNotifier */*notifier
 	/* Pass. */
 }
 
-const char *TimeDepsNode::name() const
+std::string TimeDepsNode::name() const
 {
 	return "Scene Time";
 }
@@ -174,23 +250,52 @@ const char *TimeDepsNode::name() const
 
 class GraphEvalTask : public Task {
 	Depsgraph *m_graph;
-	DepsNode *m_root;
 
 public:
-	GraphEvalTask(Depsgraph *graph, const Context &context, DepsNode *root);
+	GraphEvalTask(Depsgraph *graph, const Context &context);
 
 	void start(const Context &context) override;
 };
 
-GraphEvalTask::GraphEvalTask(Depsgraph *graph, const Context &context, DepsNode *root)
+GraphEvalTask::GraphEvalTask(Depsgraph *graph, const Context &context)
     : Task(context)
     , m_graph(graph)
-    , m_root(root)
 {}
 
 void GraphEvalTask::start(const Context &context)
 {
-	m_graph->evaluate_ex(context, m_root, m_notifier.get());
+	std::unique_lock<std::mutex> lock(m_graph->m_pass_mutex);
+
+	/* From now on, edits need another pass. */
+	m_graph->m_pass_queued = false;
+
+	m_graph->evaluate_ex(context, m_notifier.get());
+}
+
+/* Bake an object in another thread. */
+
+class BakeTask : public Task {
+	Depsgraph *m_graph;
+	int m_start;
+	int m_end;
+
+public:
+	BakeTask(Depsgraph *graph, const Context &context, int start, int end);
+
+	void start(const Context &context) override;
+};
+
+BakeTask::BakeTask(Depsgraph *graph, const Context &context, int start, int end)
+    : Task(context)
+    , m_graph(graph)
+    , m_start(start)
+    , m_end(end)
+{}
+
+void BakeTask::start(const Context &context)
+{
+	std::unique_lock<std::mutex> lock(m_graph->m_pass_mutex);
+	m_graph->bake_ex(context, m_notifier.get(), m_start, m_end);
 }
 
 /* ************************************************************************** */
@@ -199,6 +304,7 @@ Depsgraph::Depsgraph()
     : m_time_node(new TimeDepsNode)
 {
 	m_nodes.emplace_back(m_time_node);
+	m_order.push_back(m_time_node);
 }
 
 void Depsgraph::connect(SceneNode *from, SceneNode *to)
@@ -233,13 +339,30 @@ DepsNode *Depsgraph::find_node(SceneNode *scene_node, bool graph)
 
 void Depsgraph::connect(DepsOutputSocket *from, DepsInputSocket *to)
 {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	add_link(from, to);
+}
+
+void Depsgraph::disconnect(DepsOutputSocket *from, DepsInputSocket *to)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	remove_link(from, to);
+}
+
+void Depsgraph::add_link(DepsOutputSocket *from, DepsInputSocket *to)
+{
+	if (!reorder(from->parent, to->parent)) {
+		std::cerr << "Depsgraph::connect, link would create a cycle!\n";
+		return;
+	}
+
 	to->links.push_back(from);
 	from->links.push_back(to);
 
-	m_need_update = true;
+	tag_update(to->parent);
 }
 
-void Depsgraph::disconnect(DepsOutputSocket *from, DepsInputSocket *to)
+void Depsgraph::remove_link(DepsOutputSocket *from, DepsInputSocket *to)
 {
 	{
 		auto iter = std::find(from->links.begin(), from->links.end(), to);
@@ -263,7 +386,170 @@ void Depsgraph::disconnect(DepsOutputSocket *from, DepsInputSocket *to)
 		to->links.erase(iter);
 	}
 
-	m_need_update = true;
+	/* Removing a link does not invalidate the order, but the node lost an
+	 * input. */
+	tag_update(to->parent);
+}
+
+void Depsgraph::sort_by_order(std::vector<DepsNode *> &nodes)
+{
+	std::sort(nodes.begin(), nodes.end(),
+	          [](const DepsNode *a, const DepsNode *b)
+	{
+		return a->m_order_index < b->m_order_index;
+	});
+}
+
+bool Depsgraph::reorder(DepsNode *from, DepsNode *to)
+{
+	const auto lower_bound = to->m_order_index;
+	const auto upper_bound = from->m_order_index;
+
+	if (from == to) {
+		return false;
+	}
+
+	if (lower_bound > upper_bound) {
+		return true;
+	}
+
+	/* Only the nodes between the two positions are affected: gather those
+	 * reachable from `to`, which have to move after `from`... */
+	std::vector<DepsNode *> forward;
+	std::vector<DepsNode *> stack = { to };
+	to->m_visited = true;
+
+	auto is_cycle = false;
+
+	while (!stack.empty() && !is_cycle) {
+		auto node = stack.back();
+		stack.pop_back();
+		forward.push_back(node);
+
+		for (DepsInputSocket *link : node->output()->links) {
+			auto child = link->parent;
+
+			if (child == from) {
+				is_cycle = true;
+				break;
+			}
+
+			if (!child->m_visited && child->m_order_index < upper_bound) {
+				child->m_visited = true;
+				stack.push_back(child);
+			}
+		}
+	}
+
+	if (is_cycle) {
+		for (DepsNode *node : forward) {
+			node->m_visited = false;
+		}
+
+		for (DepsNode *node : stack) {
+			node->m_visited = false;
+		}
+
+		return false;
+	}
+
+	/* ...and those reaching `from`, which have to move before `to`. */
+	std::vector<DepsNode *> backward;
+	stack = { from };
+	from->m_visited = true;
+
+	while (!stack.empty()) {
+		auto node = stack.back();
+		stack.pop_back();
+		backward.push_back(node);
+
+		for (DepsOutputSocket *link : node->input()->links) {
+			auto parent = link->parent;
+
+			if (!parent->m_visited && parent->m_order_index > lower_bound) {
+				parent->m_visited = true;
+				stack.push_back(parent);
+			}
+		}
+	}
+
+	sort_by_order(forward);
+	sort_by_order(backward);
+
+	/* Reuse the positions of both sets, giving the first ones to the nodes
+	 * which must come first, without changing the order within a set. */
+	std::vector<size_t> indices;
+	indices.reserve(forward.size() + backward.size());
+
+	for (DepsNode *node : backward) {
+		indices.push_back(node->m_order_index);
+	}
+
+	for (DepsNode *node : forward) {
+		indices.push_back(node->m_order_index);
+	}
+
+	std::sort(indices.begin(), indices.end());
+
+	auto index = indices.begin();
+
+	for (DepsNode *node : backward) {
+		node->m_visited = false;
+		node->m_order_index = *index++;
+		m_order[node->m_order_index] = node;
+	}
+
+	for (DepsNode *node : forward) {
+		node->m_visited = false;
+		node->m_order_index = *index++;
+		m_order[node->m_order_index] = node;
+	}
+
+	return true;
+}
+
+void Depsgraph::remove_from_order(DepsNode *node)
+{
+	auto index = node->m_order_index;
+	m_order.erase(m_order.begin() + static_cast<std::ptrdiff_t>(index));
+
+	for (auto e = m_order.size(); index < e; ++index) {
+		m_order[index]->m_order_index = index;
+	}
+
+	if (node->m_dirty) {
+		auto iter = std::find(m_dirty_nodes.begin(), m_dirty_nodes.end(), node);
+		m_dirty_nodes.erase(iter);
+	}
+}
+
+void Depsgraph::tag_update(DepsNode *node)
+{
+	if (node->m_dirty) {
+		/* Everything downstream was tagged with it. */
+		return;
+	}
+
+	std::vector<DepsNode *> stack = { node };
+	node->m_dirty = true;
+
+	while (!stack.empty()) {
+		auto dirty = stack.back();
+		stack.pop_back();
+		m_dirty_nodes.push_back(dirty);
+
+		/* In case a pass is processing it. */
+		dirty->m_cancel.annule();
+
+		for (DepsInputSocket *link : dirty->output()->links) {
+			auto child = link->parent;
+
+			if (!child->m_dirty) {
+				child->m_dirty = true;
+				stack.push_back(child);
+			}
+		}
+	}
 }
 
 void Depsgraph::create_node(SceneNode *scene_node)
@@ -272,84 +558,94 @@ void Depsgraph::create_node(SceneNode *scene_node)
 	m_nodes.push_back(std::unique_ptr<DepsNode>(new DepsObjectNode(object)));
 	auto node = m_nodes.back().get();
 
-	m_scene_node_map[scene_node] = node;
-
-	m_nodes.push_back(std::unique_ptr<DepsNode>(new ObjectGraphDepsNode(object->graph())));
+	m_nodes.push_back(std::unique_ptr<DepsNode>(new ObjectGraphDepsNode(object, &m_frame_cache)));
 	auto graph_node = m_nodes.back().get();
 
-	m_object_graph_map[object->graph()] = graph_node;
+	/* New nodes have no link yet, they can go anywhere in the order. The maps
+	 * are read by the pass to apply the time updates. */
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_scene_node_map[scene_node] = node;
+		m_object_graph_map[object->graph()] = graph_node;
+
+		for (DepsNode *new_node : { graph_node, node }) {
+			new_node->m_order_index = m_order.size();
+			m_order.push_back(new_node);
+		}
+	}
 
 	/* Object depends on its graph. */
 	connect(graph_node->output(), node->input());
 
-	/* À FAIRE : trouver une meilleur solution pour faire dépendre les objets
-	 * sur le temps de sorte que seuls ceux qui sont dynamiques dépendent du
-	 * temps. */
-	connect(m_time_node->output(), graph_node->input());
-
-	m_need_update = true;
+	/* Graph depends on time if it is dynamic. */
+	update_time_dependency(scene_node);
 }
 
 void Depsgraph::remove_node(SceneNode *scene_node)
 {
-	/* First, remove graph node. */
-	{
-		auto object = static_cast<Object *>(scene_node);
-		auto iter = m_object_graph_map.find(object->graph());
-		assert(iter != m_object_graph_map.end());
+	auto object = static_cast<Object *>(scene_node);
 
-		DepsNode *node = iter->second;
+	auto graph_iter = m_object_graph_map.find(object->graph());
+	assert(graph_iter != m_object_graph_map.end());
 
-		auto node_iter = std::find_if(m_nodes.begin(), m_nodes.end(),
-		                              [&node](const std::unique_ptr<DepsNode> &node_ptr)
-		{
-			return node_ptr.get() == node;
-		});
-		assert(node_iter != m_nodes.end());
+	auto scene_iter = m_scene_node_map.find(scene_node);
+	assert(scene_iter != m_scene_node_map.end());
 
-		/* Disconnect input. */
-		for (DepsOutputSocket *output : node->input()->links) {
-			disconnect(output, node->input());
-		}
+	DepsNode *graph_node = graph_iter->second;
+	DepsNode *node = scene_iter->second;
 
-		/* Disconnect output. */
-		for (DepsInputSocket *input : node->output()->links) {
-			disconnect(node->output(), input);
+	/* A running pass holds pointers to the nodes: cancel its work on them,
+	 * then wait for it to end before freeing them. */
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		tag_update(graph_node);
+		tag_update(node);
+
+		if (m_bake_node == scene_node) {
+			m_bake_node = nullptr;
+			m_bake_cancel.annule();
 		}
 
-		m_object_graph_map.erase(iter);
-		m_nodes.erase(node_iter);
+		auto iter = std::find(m_time_updates.begin(), m_time_updates.end(), scene_node);
+
+		if (iter != m_time_updates.end()) {
+			m_time_updates.erase(iter);
+		}
 	}
 
-	/* Then, remove scene node. */
+	std::unique_lock<std::mutex> pass_lock(m_pass_mutex);
+
 	{
-		auto iter = m_scene_node_map.find(scene_node);
-		assert(iter != m_scene_node_map.end());
+		std::unique_lock<std::mutex> lock(m_mutex);
 
-		DepsNode *node = iter->second;
+		for (DepsNode *removed : { graph_node, node }) {
+			/* Removing links edits them, so iterate over copies. */
+			const auto inputs = removed->input()->links;
 
-		auto node_iter = std::find_if(m_nodes.begin(), m_nodes.end(),
-		                              [&node](const std::unique_ptr<DepsNode> &node_ptr)
-		{
-			return node_ptr.get() == node;
-		});
-		assert(node_iter != m_nodes.end());
+			for (DepsOutputSocket *output : inputs) {
+				remove_link(output, removed->input());
+			}
 
-		/* Disconnect input. */
-		for (DepsOutputSocket *output : node->input()->links) {
-			disconnect(output, node->input());
-		}
+			const auto outputs = removed->output()->links;
 
-		/* Disconnect output. */
-		for (DepsInputSocket *input : node->output()->links) {
-			disconnect(node->output(), input);
+			for (DepsInputSocket *input : outputs) {
+				remove_link(removed->output(), input);
+			}
+
+			remove_from_order(removed);
 		}
 
-		m_scene_node_map.erase(iter);
-		m_nodes.erase(node_iter);
+		m_object_graph_map.erase(graph_iter);
+		m_scene_node_map.erase(scene_iter);
 	}
 
-	m_need_update = true;
+	m_nodes.erase(std::remove_if(m_nodes.begin(), m_nodes.end(),
+	                             [&](const std::unique_ptr<DepsNode> &node_ptr)
+	{
+		return node_ptr.get() == graph_node || node_ptr.get() == node;
+	}),
+	              m_nodes.end());
 }
 
 void Depsgraph::connect_to_time(SceneNode *scene_node)
@@ -358,121 +654,370 @@ void Depsgraph::connect_to_time(SceneNode *scene_node)
 	connect(m_time_node->output(), node->input());
 }
 
-void Depsgraph::evaluate(const Context &context, SceneNode *scene_node)
+/* Whether the result of the operator of the node depends on the time, directly
+ * or through its inputs. */
+static bool depends_on_time(Noeud *noeud, std::unordered_set<Noeud *> &visited)
 {
-	auto node = find_node(scene_node, true);
+	if (!visited.insert(noeud).second) {
+		return false;
+	}
+
+	if (noeud->operateur()->type() == type_operateur::DYNAMIQUE) {
+		return true;
+	}
 
-	m_need_update |= (m_state != DEG_STATE_OBJECT);
-	m_state = DEG_STATE_OBJECT;
+	for (PriseEntree *entree : noeud->entrees()) {
+		if (entree->lien != nullptr && depends_on_time(entree->lien->parent, visited)) {
+			return true;
+		}
+	}
 
-	GraphEvalTask *t = new(tbb::task::allocate_root()) GraphEvalTask(this, context, node);
-	tbb::task::enqueue(*t);
+	return false;
 }
 
-void Depsgraph::evaluate_for_time_change(const Context &context)
+static bool depends_on_time(Object *object)
 {
-	m_need_update |= (m_state != DEG_STATE_TIME);
-	m_state = DEG_STATE_TIME;
+	if (object->lit_precalcul()) {
+		return true;
+	}
+
+	auto output = object->graph()->sortie();
 
-	evaluate_ex(context, m_time_node, nullptr);
+	if (output == nullptr) {
+		return false;
+	}
+
+	std::unordered_set<Noeud *> visited;
+	return depends_on_time(output, visited);
 }
 
-void Depsgraph::evaluate_ex(const Context &context, DepsNode *root, TaskNotifier *notifier)
+void Depsgraph::update_time_dependency(SceneNode *scene_node)
 {
-	if (m_need_update) {
-		build(root);
-		m_need_update = false;
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (std::find(m_time_updates.begin(), m_time_updates.end(), scene_node) == m_time_updates.end()) {
+		m_time_updates.push_back(scene_node);
 	}
+}
 
-#ifdef DEBUG_DEPSGRAPH
-	std::cerr << "Nodes size: " << m_nodes.size() << '\n';
-	std::cerr << "Stack size: " << m_stack.size() << '\n';
-#endif
+void Depsgraph::apply_time_updates()
+{
+	for (SceneNode *scene_node : m_time_updates) {
+		auto node = find_node(scene_node, true);
+		const auto is_dynamic = depends_on_time(static_cast<Object *>(scene_node));
 
-	for (auto iter = m_stack.rbegin(); iter != m_stack.rend(); ++iter) {
-		DepsNode *node = *iter;
-		node->pre_process();
-	}
+		auto &links = m_time_node->output()->links;
+		const auto is_connected = std::find(links.begin(), links.end(), node->input()) != links.end();
 
-	for (auto iter = m_stack.rbegin(); iter != m_stack.rend(); ++iter) {
-		DepsNode *node = *iter;
-		node->process(context, notifier);
+		if (is_dynamic && !is_connected) {
+			add_link(m_time_node->output(), node->input());
+		}
+		else if (!is_dynamic && is_connected) {
+			remove_link(m_time_node->output(), node->input());
+		}
 	}
 
-	context.scene->notify_listeners(static_cast<event_type>(-1));
+	m_time_updates.clear();
 }
 
-const std::vector<std::unique_ptr<DepsNode>> &Depsgraph::nodes() const
+static void gather_nodes(std::vector<DepsNode *> &nodes, DepsNode *root);
+
+void Depsgraph::evaluate(const Context &context, SceneNode *scene_node)
 {
-	return m_nodes;
+	/* The graph was edited, it may have become dynamic or static. */
+	update_time_dependency(scene_node);
+
+	auto node = find_node(scene_node, true);
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		/* The graph was edited: the frames cached for it, and for the graphs
+		 * depending on it, are stale. */
+		std::vector<DepsNode *> nodes;
+		gather_nodes(nodes, node);
+
+		for (DepsNode *downstream : nodes) {
+			downstream->invalidate_frame_cache();
+		}
+
+		/* Editing the baked object, or what it depends on, cancels the bake. */
+		if (m_bake_node != nullptr) {
+			const auto bake_node = find_node(m_bake_node, true);
+
+			if (std::find(nodes.begin(), nodes.end(), bake_node) != nodes.end()) {
+				m_bake_cancel.annule();
+			}
+		}
+
+		tag_update(node);
+	}
+
+	/* Tagging the node cancelled the work of the running pass on it, if any,
+	 * and only one pass is queued at a time, so the latest edit is evaluated
+	 * once the running pass has stopped, however many edits were made. */
+	queue_pass(context);
 }
 
-static void gather_nodes(std::vector<DepsNode *> &nodes, DepsNode *root)
+void Depsgraph::evaluate_for_time_change(const Context &context)
 {
-	if (!root) {
+	bool baking;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		tag_update(m_time_node);
+		baking = (m_bake_node != nullptr);
+	}
+
+	/* A bake holds the pass mutex for all of its frames: rather than waiting
+	 * for it on the UI thread, evaluate the new frame once it is done. */
+	if (baking) {
+		queue_pass(context);
 		return;
 	}
 
-	nodes.push_back(root);
+	std::unique_lock<std::mutex> lock(m_pass_mutex);
+	evaluate_ex(context, nullptr);
+}
 
-	for (DepsInputSocket *link : root->output()->links) {
-		gather_nodes(nodes, link->parent);
+void Depsgraph::queue_pass(const Context &context)
+{
+	if (m_pass_queued.exchange(true)) {
+		return;
 	}
+
+	GraphEvalTask *t = new(tbb::task::allocate_root()) GraphEvalTask(this, context);
+	tbb::task::enqueue(*t);
 }
 
-static inline auto is_linked(DepsNode *node)
+void Depsgraph::evaluate_all(const Context &context)
 {
-	return node->is_linked();
+	for (const auto &pair : m_scene_node_map) {
+		update_time_dependency(pair.first);
+	}
+
+	bool baking;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (DepsNode *node : m_order) {
+			tag_update(node);
+		}
+
+		baking = (m_bake_node != nullptr);
+	}
+
+	if (baking) {
+		queue_pass(context);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_pass_mutex);
+	evaluate_ex(context, nullptr);
 }
 
-static inline auto is_linked(DepsInputSocket *socket)
+bool Depsgraph::bake(const Context &context, SceneNode *scene_node, int start, int end)
 {
-	return !socket->links.empty();
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (m_bake_node != nullptr) {
+			return false;
+		}
+
+		m_bake_node = scene_node;
+	}
+
+	BakeTask *t = new(tbb::task::allocate_root()) BakeTask(this, context, start, end);
+	tbb::task::enqueue(*t);
+
+	return true;
 }
 
-static inline auto get_input(DepsNode *node, size_t /*index*/)
+void Depsgraph::bake_ex(const Context &context, TaskNotifier *notifier, int start, int end)
 {
-	return node->input();
+	/* Evaluate the pending edits first: once the node is clean, any edit
+	 * tags it again and so cancels the bake. */
+	evaluate_ex(context, notifier);
+
+	SceneNode *scene_node;
+	DepsNode *node;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		scene_node = m_bake_node;
+
+		if (scene_node == nullptr) {
+			/* The object was removed. */
+			return;
+		}
+
+		node = find_node(scene_node, true);
+		m_bake_cancel.reinitialise();
+	}
+
+	/* The bake has its own token: the passes queued meanwhile for frame
+	 * changes tag the node, which must not cancel it. */
+	auto bake_context = context;
+	bake_context.annulation = &m_bake_cancel;
+
+	if (!node->m_dirty) {
+		const auto erreur = kamikaze::precalcule_objet(
+		                        bake_context, static_cast<Object *>(scene_node), start, end);
+
+		if (erreur != kamikaze::erreur_fichier::AUCUNE_ERREUR) {
+			std::cerr << "Cannot write the bake of " << scene_node->name() << '\n';
+		}
+	}
+
+	/* The bake evaluated the graph for the last frame. */
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_bake_node = nullptr;
+		tag_update(node);
+	}
+
+	evaluate_ex(context, notifier);
 }
 
-static inline auto get_link_parent(DepsInputSocket *socket)
+void Depsgraph::evaluate_ex(const Context &context, TaskNotifier *notifier)
 {
-	return socket->links[0]->parent;
+	PorteeTrace trace("depsgraph", "Depsgraph Pass", ++m_pass_count);
+
+	/* Only the nodes downstream of what changed since the last pass are
+	 * evaluated, in topological order. */
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		/* Linking a node to the time tags it, so do it before gathering the
+		 * dirty nodes. */
+		apply_time_updates();
+
+		m_stack.swap(m_dirty_nodes);
+		m_dirty_nodes.clear();
+
+		for (DepsNode *node : m_stack) {
+			node->m_dirty = false;
+		}
+
+		sort_by_order(m_stack);
+
+		/* The pass follows the links as they are now, the UI thread may edit
+		 * them while the nodes are processed. A node only waits for the inputs
+		 * which are part of this pass, the others are already up to date. */
+		for (DepsNode *node : m_stack) {
+			node->m_in_pass = true;
+			node->m_pending_inputs = 0;
+			node->m_pass_children.clear();
+		}
+
+		for (DepsNode *node : m_stack) {
+			for (DepsInputSocket *link : node->output()->links) {
+				auto child = link->parent;
+
+				if (child->m_in_pass) {
+					node->m_pass_children.push_back(child);
+					++child->m_pending_inputs;
+				}
+			}
+		}
+	}
+
+#ifdef DEBUG_DEPSGRAPH
+	std::cerr << "Nodes size: " << m_nodes.size() << '\n';
+	std::cerr << "Stack size: " << m_stack.size() << '\n';
+#endif
+
+	for (DepsNode *node : m_stack) {
+		node->pre_process();
+	}
+
+	process_stack(context, notifier);
+
+	context.scene->notify_listeners(static_cast<event_type>(-1));
 }
 
-static inline auto num_inputs(DepsNode */*node*/)
+void Depsgraph::process_stack(const Context &context, TaskNotifier *notifier)
 {
-	return 1;
+	/* Each node is spawned as soon as its last input is processed, so that
+	 * independent object graphs are evaluated at the same time and the pass
+	 * only takes as long as its longest chain of dependencies. */
+	tbb::task_group tasks;
+
+	std::function<void(DepsNode *)> run_node = [&](DepsNode *node)
+	{
+		node->m_cancel.reinitialise();
+
+		/* The node was tagged again since the pass started, so was everything
+		 * downstream of it: leave them to the next pass. The tag is set before
+		 * the token is cancelled, so checking it after resetting the token
+		 * misses no edit. */
+		if (node->m_dirty) {
+			return;
+		}
+
+		auto node_context = context;
+		node_context.annulation = &node->m_cancel;
+
+		{
+			PorteeTrace trace("depsgraph", node->name().c_str(), m_pass_count);
+			node->process(node_context, notifier);
+		}
+
+		if (node->m_dirty) {
+			return;
+		}
+
+		for (DepsNode *child : node->m_pass_children) {
+			if (--child->m_pending_inputs == 0) {
+				tasks.run([&run_node, child]() { run_node(child); });
+			}
+		}
+	};
+
+	/* Gather the roots before spawning anything: once the tasks run, the
+	 * counters of the other nodes may drop to zero. */
+	std::vector<DepsNode *> roots;
+
+	for (DepsNode *node : m_stack) {
+		if (node->m_pending_inputs == 0) {
+			roots.push_back(node);
+		}
+	}
+
+	for (DepsNode *node : roots) {
+		tasks.run([&run_node, node]() { run_node(node); });
+	}
+
+	tasks.wait();
+
+	for (DepsNode *node : m_stack) {
+		node->m_in_pass = false;
+		node->m_pass_children.clear();
+	}
 }
 
-static inline auto get_degree(DepsNode *node)
+const std::vector<std::unique_ptr<DepsNode>> &Depsgraph::nodes() const
 {
-	return node->output()->links.size();
+	return m_nodes;
 }
 
-static inline auto is_zero_out_degree(DepsNode *node)
+CacheResultats *Depsgraph::frame_cache()
 {
-	return get_degree(node) == 0;
+	return &m_frame_cache;
 }
 
-void Depsgraph::build(DepsNode *root)
+static void gather_nodes(std::vector<DepsNode *> &nodes, DepsNode *root)
 {
-	if (root) {
-		std::vector<DepsNode *> branch;
-		gather_nodes(branch, root);
-
-		topology_sort(branch, m_stack);
+	if (!root) {
+		return;
 	}
-	else {
-		/* Sort the whole graph. */
-		std::vector<DepsNode *> nodes(m_nodes.size());
 
-		std::transform(m_nodes.begin(), m_nodes.end(), nodes.begin(),
-		               [](const std::unique_ptr<DepsNode> &node) -> DepsNode*
-		{
-			return node.get();
-		});
+	nodes.push_back(root);
 
-		topology_sort(nodes, m_stack);
+	for (DepsInputSocket *link : root->output()->links) {
+		gather_nodes(nodes, link->parent);
 	}
 }
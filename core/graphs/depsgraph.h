@@ -24,13 +24,17 @@
 
 #pragma once
 
+#include <kamikaze/cache.h>
+#include <kamikaze/context.h>
+
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 class DepsNode;
-class Context;
-class EvaluationContext;
 class Graph;
 class Object;
 class SceneNode;
@@ -61,6 +65,27 @@ class DepsNode {
 	DepsInputSocket m_input;
 	DepsOutputSocket m_output;
 
+	/* Scheduling state of an evaluation pass: whether the node is part of the
+	 * pass, the number of its inputs from the pass not yet processed, and the
+	 * nodes of the pass it feeds. The links are copied when the pass starts,
+	 * as they may be edited while it runs. */
+	bool m_in_pass = false;
+	std::atomic<int> m_pending_inputs{0};
+	std::vector<DepsNode *> m_pass_children{};
+
+	/* Position of the node in the topological order of the graph, whether its
+	 * result is out of date, and a mark for the searches of the reordering. */
+	size_t m_order_index = 0;
+	std::atomic<bool> m_dirty{false};
+	bool m_visited = false;
+
+	/* Cancelled when the node is tagged for update while being processed, so
+	 * that the operators stop working on a result which is already stale. */
+	JetonAnnulation m_cancel{};
+
+	friend class Depsgraph;
+	friend class DepsgraphTester;
+
 public:
 	DepsNode();
 
@@ -75,7 +100,13 @@ public:
 
 	bool is_linked() const;
 
-	virtual const char *name() const = 0;
+	/**
+	 * Discard the frames cached for this node, e.g. because the graph it
+	 * evaluates was edited.
+	 */
+	virtual void invalidate_frame_cache() {}
+
+	virtual std::string name() const = 0;
 };
 
 /* ************************************************************************** */
@@ -89,32 +120,55 @@ public:
 
 	~DepsObjectNode() = default;
 
-	void pre_process() override;
 	void process(const Context &context, TaskNotifier *notifier) override;
 
 	Object *object();
 	const Object *object() const;
 
-	const char *name() const override;
+	std::string name() const override;
 };
 
 /* ************************************************************************** */
 
+/**
+ * Evaluates the graph of an object.
+ *
+ * The results of graphs that depend on more than their configuration (time,
+ * files, ...) are kept per frame in the depsgraph's frame cache, so that
+ * scrubbing or replaying the timeline over frames already evaluated copies
+ * the cached collection into the output node instead of running operators.
+ * Other graphs are already served by the operator result cache.
+ *
+ * Objects reading a bake load the baked frames from disk instead, so that
+ * their playback does not depend on the cost of the graph.
+ */
 class ObjectGraphDepsNode : public DepsNode {
+	Object *m_object;
 	Graph *m_graph;
+	CacheResultats *m_frame_cache;
+
+	/* Identifies the node in the frame cache keys. Unlike the addresses of
+	 * the node or of its graph, it is never reused by another node. */
+	const uint64_t m_identity;
+
+	/* Bumped when the cached frames are invalidated: it is part of the cache
+	 * keys, so older entries are never hit again and age out of the cache. */
+	std::atomic<uint64_t> m_generation{0};
 
 public:
 	ObjectGraphDepsNode() = delete;
-	explicit ObjectGraphDepsNode(Graph *graph);
+	ObjectGraphDepsNode(Object *object, CacheResultats *frame_cache);
 
 	~ObjectGraphDepsNode() = default;
 
 	void process(const Context &context, TaskNotifier *notifier) override;
 
+	void invalidate_frame_cache() override;
+
 	Graph *graph();
 	const Graph *graph() const;
 
-	const char *name() const override;
+	std::string name() const override;
 };
 
 /* ************************************************************************** */
@@ -126,30 +180,63 @@ public:
 
 	void process(const Context &context, TaskNotifier *notifier) override;
 
-	const char *name() const override;
+	std::string name() const override;
 };
 
 /* ************************************************************************** */
 
-enum {
-	DEG_STATE_NONE   = -1,
-	DEG_STATE_OBJECT = 0,
-	DEG_STATE_TIME   = 1,
-};
-
 class Depsgraph {
 	std::vector<std::unique_ptr<DepsNode>> m_nodes;
 	std::vector<DepsNode *> m_stack;
 	std::unordered_map<SceneNode *, DepsNode *> m_scene_node_map;
 	std::unordered_map<const Graph *, DepsNode *> m_object_graph_map;
 
-	int m_state = DEG_STATE_NONE;
-	bool m_need_update = false;
+	/* Every node, sorted topologically. The order is kept up to date as links
+	 * are added (Pearce-Kelly), so that editing the graph does not require to
+	 * sort it again. */
+	std::vector<DepsNode *> m_order;
+
+	/* Nodes whose result is out of date, evaluated by the next pass. Tagging a
+	 * node also tags every node downstream of it. */
+	std::vector<DepsNode *> m_dirty_nodes;
+
+	/* Objects whose link to the time node has to be checked again, done by the
+	 * next pass before it gathers its nodes. */
+	std::vector<SceneNode *> m_time_updates;
+
+	/* Protects the links, the order, the dirty nodes and the time updates, which are edited from
+	 * the UI thread while a pass may be gathering its nodes in a task. */
+	std::mutex m_mutex;
+
+	/* Serialises the passes, and tells whether a pass is already waiting in
+	 * the task queue: edits made meanwhile are coalesced into it instead of
+	 * queuing a pass each. */
+	std::mutex m_pass_mutex;
+	std::atomic<bool> m_pass_queued{false};
+
+	/* The object of the bake queued or running, if any, reset by remove_node
+	 * so that the bake does not touch a removed object. Protected by the
+	 * mutex. */
+	SceneNode *m_bake_node = nullptr;
+
+	/* Cancels the running bake, when its object, or what it depends on, is
+	 * edited or removed. */
+	JetonAnnulation m_bake_cancel;
+
+	/* Number of passes so far, to tell them apart in traces. */
+	int64_t m_pass_count = 0;
 
 	DepsNode *m_time_node = nullptr;
 
+	CacheResultats m_frame_cache{};
+
+	friend class BakeTask;
+	friend class DepsGraphDumper;
 	friend class GraphEvalTask;
 
+	/* Lets the unit tests inspect the order and the dirty nodes. */
+	friend class DepsgraphTester;
+
 public:
 	Depsgraph();
 	~Depsgraph() = default;
@@ -169,14 +256,76 @@ public:
 
 	void connect_to_time(SceneNode *scene_node);
 
+	/**
+	 * Connect the graph of the object to the time node if its result depends
+	 * on the time (dynamic operators, bake), or disconnect it otherwise, so
+	 * that only the animated part of the scene is evaluated on frame change.
+	 * This is done for every evaluation of the object, and should be called
+	 * when anything else it depends on changes. The update is queued, and
+	 * applied by the next pass, so that the links are not edited while a pass
+	 * is running.
+	 */
+	void update_time_dependency(SceneNode *scene_node);
+
 	void evaluate(const Context &context, SceneNode *scene_node);
 	void evaluate_for_time_change(const Context &context);
 
+	/**
+	 * Evaluate every object, e.g. after loading a file.
+	 */
+	void evaluate_all(const Context &context);
+
+	/**
+	 * Bake the object for the frames of [start, end] in a task, which holds
+	 * the pass mutex so that no pass evaluates the graphs meanwhile: frame
+	 * changes and edits are evaluated by a pass queued after it. Editing or
+	 * removing the object cancels the bake. Return false if a bake is already
+	 * queued or running.
+	 */
+	bool bake(const Context &context, SceneNode *scene_node, int start, int end);
+
 	const std::vector<std::unique_ptr<DepsNode> > &nodes() const;
 
+	/**
+	 * The per-frame cache of the object graphs, to configure its memory
+	 * budget or query its statistics.
+	 */
+	CacheResultats *frame_cache();
+
 private:
-	void build(DepsNode *root);
+	/* Move the nodes of the graph so that `from` comes before `to`, returns
+	 * false if `from` depends on `to`. */
+	bool reorder(DepsNode *from, DepsNode *to);
+
+	/* Add or remove a link, and tag the node it goes to for update, the mutex
+	 * must be locked. */
+	void add_link(DepsOutputSocket *from, DepsInputSocket *to);
+	void remove_link(DepsOutputSocket *from, DepsInputSocket *to);
+
+	/* Remove the node from the order and from the dirty nodes, the mutex must
+	 * be locked. */
+	void remove_from_order(DepsNode *node);
+
+	/* Connect to or disconnect from the time node the objects queued by
+	 * update_time_dependency, the pass mutex and the mutex must be locked. */
+	void apply_time_updates();
+
+	static void sort_by_order(std::vector<DepsNode *> &nodes);
+
+	/* Tag the node and everything downstream of it for the next pass, the
+	 * mutex must be locked. */
+	void tag_update(DepsNode *node);
+
+	/* Queue a pass in a task, unless one is already waiting in the queue. */
+	void queue_pass(const Context &context);
+
+	/* Evaluate the nodes tagged for update, the pass mutex must be locked. */
+	void evaluate_ex(const Context &context, TaskNotifier *notifier);
+
+	/* Bake the object of m_bake_node, the pass mutex must be locked. */
+	void bake_ex(const Context &context, TaskNotifier *notifier, int start, int end);
 
-	void evaluate_ex(const Context &context, DepsNode *root, TaskNotifier *notifier);
+	/* Process the nodes of the stack, running independent ones concurrently. */
+	void process_stack(const Context &context, TaskNotifier *notifier);
 	DepsNode *find_node(SceneNode *scene_node, bool graph);
 };
@@ -24,10 +24,13 @@
 
 #include "graph_dumper.h"
 
+#include <kamikaze/operateur.h>
 #include <numero7/systeme_fichier/file.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
+#include <unordered_map>
 
 #include "depsgraph.h"
 #include "object_graph.h"
@@ -40,6 +43,142 @@ static constexpr auto fontsize = 20.0f;
 static constexpr auto node_label_size = 14.0f;
 static constexpr auto color_value = "gold1";
 
+/* ************************************************************************** */
+
+/* Performance figures shown for a node. */
+struct Annotation {
+	/* Median exclusive execution time, in seconds. */
+	double time = 0.0;
+
+	/* Peak size of the output, and elements of the last output. */
+	size_t bytes = 0;
+	size_t points = 0;
+	size_t primitives = 0;
+
+	size_t executions = 0;
+	size_t cache_hits = 0;
+
+	/* Bytes the last execution duplicated when writing to buffers shared with
+	 * its inputs, the cache or a bake. */
+	size_t copied_bytes = 0;
+};
+
+/* Highest figures of the graph, which get the hottest colours. */
+struct HeatScale {
+	double time = 0.0;
+	size_t bytes = 0;
+	size_t copied_bytes = 0;
+
+	void add(const Annotation &annotation)
+	{
+		time = std::max(time, annotation.time);
+		bytes = std::max(bytes, annotation.bytes);
+		copied_bytes = std::max(copied_bytes, annotation.copied_bytes);
+	}
+};
+
+static Annotation make_annotation(const StatistiquesOperateur &stats)
+{
+	Annotation annotation;
+	annotation.time = stats.temps_median;
+	annotation.bytes = stats.octets_max;
+	annotation.points = stats.points_dernier;
+	annotation.primitives = stats.primitives_dernier;
+	annotation.executions = stats.nombre_executions;
+	annotation.cache_hits = stats.succes_cache;
+	annotation.copied_bytes = stats.octets_dupliques_dernier;
+
+	return annotation;
+}
+
+/* Times are exclusive, so the cost of a graph is the sum of its operators'.
+ * The elements are those of the output node. */
+static Annotation make_annotation(const Graph *graph)
+{
+	Annotation annotation;
+
+	for (const auto &noeud : graph->noeuds()) {
+		const auto node_annotation = make_annotation(noeud->operateur()->statistiques());
+
+		annotation.time += node_annotation.time;
+		annotation.bytes = std::max(annotation.bytes, node_annotation.bytes);
+		annotation.executions += node_annotation.executions;
+		annotation.cache_hits += node_annotation.cache_hits;
+		annotation.copied_bytes += node_annotation.copied_bytes;
+
+		if (noeud.get() == graph->sortie()) {
+			annotation.points = node_annotation.points;
+			annotation.primitives = node_annotation.primitives;
+		}
+	}
+
+	return annotation;
+}
+
+static double heat_ratio(double value, double max)
+{
+	return (max > 0.0) ? std::min(1.0, value / max) : 0.0;
+}
+
+/* Goes from pale yellow to red, in the "H S V" format of Graphviz. */
+static std::string heat_color(double ratio)
+{
+	char color[32];
+	snprintf(color, sizeof(color), "%.3f %.3f 1.000", 0.166 * (1.0 - ratio), 0.15 + 0.85 * ratio);
+	return color;
+}
+
+static void dump_annotation(numero7::systeme_fichier::File &file,
+                            const Annotation &annotation,
+                            const HeatScale &scale)
+{
+	file.print("<TR><TD COLSPAN=\"2\">%.3f ms, %.1f KB</TD></TR>",
+	           annotation.time * 1000.0, static_cast<double>(annotation.bytes) / 1024.0);
+	file.print("<TR><TD COLSPAN=\"2\">%zu points, %zu prims</TD></TR>",
+	           annotation.points, annotation.primitives);
+
+	if (annotation.copied_bytes != 0) {
+		const auto ratio = heat_ratio(static_cast<double>(annotation.copied_bytes),
+		                              static_cast<double>(scale.copied_bytes));
+
+		file.print("<TR><TD COLSPAN=\"2\" BGCOLOR=\"%s\">%.1f KB copied</TD></TR>",
+		           heat_color(ratio).c_str(), static_cast<double>(annotation.copied_bytes) / 1024.0);
+	}
+}
+
+static std::string json_string(const std::string &str)
+{
+	std::stringstream ss;
+
+	ss << '"';
+
+	for (const auto c : str) {
+		if (c == '"' || c == '\\') {
+			ss << '\\' << c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			ss << ' ';
+		}
+		else {
+			ss << c;
+		}
+	}
+
+	ss << '"';
+
+	return ss.str();
+}
+
+static void dump_json_annotation(numero7::systeme_fichier::File &file, const Annotation &annotation)
+{
+	file.print(",\"time\":%.9f,\"bytes\":%zu,\"points\":%zu,\"primitives\":%zu",
+	           annotation.time, annotation.bytes, annotation.points, annotation.primitives);
+	file.print(",\"executions\":%zu,\"cache_hits\":%zu,\"copied_bytes\":%zu",
+	           annotation.executions, annotation.cache_hits, annotation.copied_bytes);
+}
+
+/* ************************************************************************** */
+
 inline static std::string node_id(const Noeud *noeud, bool quoted = true)
 {
 	std::stringstream ss;
@@ -121,12 +260,15 @@ inline static std::string output_id(const PriseSortie *sortie, int index, bool q
 	return ss.str();
 }
 
-inline void dump_node(numero7::systeme_fichier::File &file, Noeud *noeud)
+inline void dump_node(numero7::systeme_fichier::File &file,
+                      Noeud *noeud,
+                      const Annotation *annotation = nullptr,
+                      const HeatScale &scale = HeatScale())
 {
 	constexpr auto shape = "box";
 	constexpr auto style = "filled,rounded";
-	constexpr auto color = "black";
-	constexpr auto fillcolor = "gainsboro";
+	std::string color = "black";
+	std::string fillcolor = "gainsboro";
 	auto penwidth = 1.0f;
 
 	file.print("// %s\n", noeud->nom().c_str());
@@ -136,6 +278,16 @@ inline void dump_node(numero7::systeme_fichier::File &file, Noeud *noeud)
 	file.print("label=<<TABLE BORDER=\"0\" CELLBORDER=\"0\" CELLSPACING=\"0\" CELLPADDING=\"4\">");
 	file.print("<TR><TD COLSPAN=\"2\">%s</TD></TR>", noeud->nom().c_str());
 
+	if (annotation) {
+		dump_annotation(file, *annotation, scale);
+
+		const auto bytes_ratio = heat_ratio(static_cast<double>(annotation->bytes), static_cast<double>(scale.bytes));
+
+		fillcolor = heat_color(heat_ratio(annotation->time, scale.time));
+		color = heat_color(bytes_ratio);
+		penwidth += 4.0f * static_cast<float>(bytes_ratio);
+	}
+
 	const auto numin = noeud->entrees().size();
 	const auto numout = noeud->sorties().size();
 
@@ -183,14 +335,18 @@ inline void dump_node(numero7::systeme_fichier::File &file, Noeud *noeud)
 	file.print(",fontsize=\"%f\"", node_label_size);
 	file.print(",shape=\"%s\"", shape);
 	file.print(",style=\"%s\"", style);
-	file.print(",color=\"%s\"", color);
-	file.print(",fillcolor=\"%s\"", fillcolor);
+	file.print(",color=\"%s\"", color.c_str());
+	file.print(",fillcolor=\"%s\"", fillcolor.c_str());
 	file.print(",penwidth=\"%f\"", penwidth);
 	file.print("];\n");
 	file.print("\n");
 }
 
-inline void dump_link(numero7::systeme_fichier::File &file, const PriseSortie *de, const PriseEntree *a)
+inline void dump_link(numero7::systeme_fichier::File &file,
+                      const PriseSortie *de,
+                      const PriseEntree *a,
+                      size_t copied_bytes = 0,
+                      const HeatScale &scale = HeatScale())
 {
 	float penwidth = 2.0f;
 
@@ -202,25 +358,60 @@ inline void dump_link(numero7::systeme_fichier::File &file, const PriseSortie *d
 
 	/* Note: without label an id seem necessary to avoid bugs in graphviz/dot */
 	file.print("id=\"VAL%s:%s\"", node_id(a->parent, false).c_str(), input_id(a, -1, false).c_str());
-	file.print(",penwidth=\"%f\"", penwidth);
 
+	if (copied_bytes != 0) {
+		const auto ratio = heat_ratio(static_cast<double>(copied_bytes), static_cast<double>(scale.copied_bytes));
+
+		penwidth += 4.0f * static_cast<float>(ratio);
+
+		file.print(",color=\"%s\"", heat_color(ratio).c_str());
+		file.print(",label=\"%.1f KB copied\"", static_cast<double>(copied_bytes) / 1024.0);
+	}
+
+	file.print(",penwidth=\"%f\"", penwidth);
 	file.print("];\n");
 	file.print("\n");
 }
 
-inline void dump_node_links(numero7::systeme_fichier::File &file, const Noeud *noeud)
+/* The copies are made by the operator of the node when it writes to the data
+ * it received: they are shown on every link going to it, as they cannot be
+ * told apart by input. */
+inline void dump_node_links(numero7::systeme_fichier::File &file,
+                            const Noeud *noeud,
+                            const Annotation *annotation = nullptr,
+                            const HeatScale &scale = HeatScale())
 {
-	for (const auto &entree : noeud->entrees()) {
+	const auto copied_bytes = (annotation != nullptr) ? annotation->copied_bytes : 0ul;
+
+	for (const auto entree : noeud->entrees()) {
 		if (entree->lien) {
-			dump_link(file, entree->lien, entree);
+			dump_link(file, entree->lien, entree, copied_bytes, scale);
 		}
 	}
 }
 
+using StatisticsMap = std::unordered_map<const Noeud *, StatistiquesOperateur>;
+
+static StatisticsMap collect_statistics(const Graph *graph)
+{
+	StatisticsMap statistics;
+
+	for (const auto &noeud : graph->noeuds()) {
+		statistics[noeud.get()] = noeud->operateur()->statistiques();
+	}
+
+	return statistics;
+}
+
 GraphDumper::GraphDumper(Graph *graph)
     : m_graph(graph)
 {}
 
+void GraphDumper::show_statistics(bool yesno)
+{
+	m_show_statistics = yesno;
+}
+
 void GraphDumper::operator()(const std::experimental::filesystem::path &path)
 {
 	numero7::systeme_fichier::File file(path, "w");
@@ -238,17 +429,85 @@ void GraphDumper::operator()(const std::experimental::filesystem::path &path)
 	file.print("label=\"Object Graph\"");
 	file.print("]\n");
 
+	if (!m_show_statistics) {
+		for (const auto &noeud : m_graph->noeuds()) {
+			dump_node(file, noeud.get());
+		}
+
+		for (const auto &noeud : m_graph->noeuds()) {
+			dump_node_links(file, noeud.get());
+		}
+
+		file.print("}\n");
+		return;
+	}
+
+	const auto statistics = collect_statistics(m_graph);
+	HeatScale scale;
+
+	for (const auto &pair : statistics) {
+		scale.add(make_annotation(pair.second));
+	}
+
 	for (const auto &noeud : m_graph->noeuds()) {
-		dump_node(file, noeud.get());
+		const auto annotation = make_annotation(statistics.at(noeud.get()));
+		dump_node(file, noeud.get(), &annotation, scale);
 	}
 
 	for (const auto &noeud : m_graph->noeuds()) {
-		dump_node_links(file, noeud.get());
+		const auto annotation = make_annotation(statistics.at(noeud.get()));
+		dump_node_links(file, noeud.get(), &annotation, scale);
 	}
 
 	file.print("}\n");
 }
 
+void GraphDumper::dump_json(const std::experimental::filesystem::path &path)
+{
+	numero7::systeme_fichier::File file(path, "w");
+
+	if (!file) {
+		return;
+	}
+
+	const auto statistics = collect_statistics(m_graph);
+	auto first = true;
+
+	file.print("{\"graph\":\"object\",\"nodes\":[\n");
+
+	for (const auto &noeud : m_graph->noeuds()) {
+		file.print("%s{\"id\":%s", first ? "" : ",\n", json_string(node_id(noeud.get(), false)).c_str());
+		file.print(",\"name\":%s", json_string(noeud->nom()).c_str());
+		dump_json_annotation(file, make_annotation(statistics.at(noeud.get())));
+		file.print("}");
+
+		first = false;
+	}
+
+	file.print("\n],\"links\":[\n");
+	first = true;
+
+	for (const auto &noeud : m_graph->noeuds()) {
+		const auto copied_bytes = statistics.at(noeud.get()).octets_dupliques_dernier;
+
+		for (const auto entree : noeud->entrees()) {
+			if (!entree->lien) {
+				continue;
+			}
+
+			file.print("%s{\"from\":%s", first ? "" : ",\n", json_string(node_id(entree->lien->parent, false)).c_str());
+			file.print(",\"output\":%s", json_string(entree->lien->nom).c_str());
+			file.print(",\"to\":%s", json_string(node_id(noeud.get(), false)).c_str());
+			file.print(",\"input\":%s", json_string(entree->nom).c_str());
+			file.print(",\"copied_bytes\":%zu}", copied_bytes);
+
+			first = false;
+		}
+	}
+
+	file.print("\n]}\n");
+}
+
 /* ************************************************************************** */
 
 #define kmkz_inline static inline
@@ -298,22 +557,35 @@ kmkz_inline std::string output_id(const DepsOutputSocket */*socket*/, bool quote
 	return ss.str();
 }
 
-kmkz_inline void dump_node(numero7::systeme_fichier::File &file, DepsNode *node)
+kmkz_inline void dump_node(numero7::systeme_fichier::File &file,
+                           DepsNode *node,
+                           const Annotation *annotation = nullptr,
+                           const HeatScale &scale = HeatScale())
 {
 	constexpr auto shape = "box";
 	constexpr auto style = "filled,rounded";
-	constexpr auto color = "black";
-	constexpr auto fillcolor = "gainsboro";
+	std::string color = "black";
+	std::string fillcolor = "gainsboro";
 	auto penwidth = 1.0f;
 
 	const auto ob_name = node->name();
 
-	file.print("// %s\n", ob_name);
+	file.print("// %s\n", ob_name.c_str());
 	file.print("%s", node_id(node).c_str());
 	file.print("[");
 
 	file.print("label=<<TABLE BORDER=\"0\" CELLBORDER=\"0\" CELLSPACING=\"0\" CELLPADDING=\"4\">");
-	file.print("<TR><TD COLSPAN=\"2\">%s</TD></TR>", ob_name);
+	file.print("<TR><TD COLSPAN=\"2\">%s</TD></TR>", ob_name.c_str());
+
+	if (annotation) {
+		dump_annotation(file, *annotation, scale);
+
+		const auto bytes_ratio = heat_ratio(static_cast<double>(annotation->bytes), static_cast<double>(scale.bytes));
+
+		fillcolor = heat_color(heat_ratio(annotation->time, scale.time));
+		color = heat_color(bytes_ratio);
+		penwidth += 4.0f * static_cast<float>(bytes_ratio);
+	}
 
 	file.print("<TR>");
 
@@ -347,8 +619,8 @@ kmkz_inline void dump_node(numero7::systeme_fichier::File &file, DepsNode *node)
 	file.print(",fontsize=\"%f\"", node_label_size);
 	file.print(",shape=\"%s\"", shape);
 	file.print(",style=\"%s\"", style);
-	file.print(",color=\"%s\"", color);
-	file.print(",fillcolor=\"%s\"", fillcolor);
+	file.print(",color=\"%s\"", color.c_str());
+	file.print(",fillcolor=\"%s\"", fillcolor.c_str());
 	file.print(",penwidth=\"%f\"", penwidth);
 	file.print("];\n");
 	file.print("\n");
@@ -381,10 +653,31 @@ kmkz_inline void dump_node_links(numero7::systeme_fichier::File &file, const Dep
 	}
 }
 
+/* Only the nodes evaluating object graphs run operators. */
+static std::unordered_map<const DepsNode *, Annotation> collect_annotations(const Depsgraph *graph)
+{
+	std::unordered_map<const DepsNode *, Annotation> annotations;
+
+	for (const auto &node : graph->nodes()) {
+		auto graph_node = dynamic_cast<const ObjectGraphDepsNode *>(node.get());
+
+		if (graph_node != nullptr) {
+			annotations[node.get()] = make_annotation(graph_node->graph());
+		}
+	}
+
+	return annotations;
+}
+
 DepsGraphDumper::DepsGraphDumper(Depsgraph *graph)
     : m_graph(graph)
 {}
 
+void DepsGraphDumper::show_statistics(bool yesno)
+{
+	m_show_statistics = yesno;
+}
+
 void DepsGraphDumper::operator()(const std::experimental::filesystem::path &path)
 {
 	numero7::systeme_fichier::File file(path, "w");
@@ -402,8 +695,25 @@ void DepsGraphDumper::operator()(const std::experimental::filesystem::path &path
 	file.print("label=\"Dependency Graph\"");
 	file.print("]\n");
 
+	/* The links are protected by the mutex of the graph. */
+	std::unique_lock<std::mutex> lock(m_graph->m_mutex);
+
+	std::unordered_map<const DepsNode *, Annotation> annotations;
+	HeatScale scale;
+
+	if (m_show_statistics) {
+		annotations = collect_annotations(m_graph);
+
+		for (const auto &pair : annotations) {
+			scale.add(pair.second);
+		}
+	}
+
 	for (const auto &node : m_graph->nodes()) {
-		dump_node(file, node.get());
+		auto iter = annotations.find(node.get());
+		auto annotation = (iter != annotations.end()) ? &iter->second : nullptr;
+
+		dump_node(file, node.get(), annotation, scale);
 	}
 
 	for (const auto &node : m_graph->nodes()) {
@@ -412,3 +722,48 @@ void DepsGraphDumper::operator()(const std::experimental::filesystem::path &path
 
 	file.print("}\n");
 }
+
+void DepsGraphDumper::dump_json(const std::experimental::filesystem::path &path)
+{
+	numero7::systeme_fichier::File file(path, "w");
+
+	if (!file) {
+		return;
+	}
+
+	const auto annotations = collect_annotations(m_graph);
+	auto first = true;
+
+	std::unique_lock<std::mutex> lock(m_graph->m_mutex);
+
+	file.print("{\"graph\":\"dependency\",\"nodes\":[\n");
+
+	for (const auto &node : m_graph->nodes()) {
+		file.print("%s{\"id\":%s", first ? "" : ",\n", json_string(node_id(node.get(), false)).c_str());
+		file.print(",\"name\":%s", json_string(node->name()).c_str());
+
+		auto iter = annotations.find(node.get());
+
+		if (iter != annotations.end()) {
+			dump_json_annotation(file, iter->second);
+		}
+
+		file.print("}");
+
+		first = false;
+	}
+
+	file.print("\n],\"links\":[\n");
+	first = true;
+
+	for (const auto &node : m_graph->nodes()) {
+		for (const auto &output : node->input()->links) {
+			file.print("%s{\"from\":%s", first ? "" : ",\n", json_string(node_id(output->parent, false)).c_str());
+			file.print(",\"to\":%s}", json_string(node_id(node.get(), false)).c_str());
+
+			first = false;
+		}
+	}
+
+	file.print("\n]}\n");
+}
@@ -29,20 +29,38 @@
 class Depsgraph;
 class Graph;
 
+/* With statistics shown, nodes are filled from pale yellow to red by their
+ * median exclusive execution time, their border goes the same way with the
+ * peak size of their output, and links through which the collection was
+ * deep copied, because the output feeds several nodes, are drawn in red. */
+
 class GraphDumper {
 	Graph *m_graph;
+	bool m_show_statistics = false;
 
 public:
 	explicit GraphDumper(Graph *graph);
 
+	void show_statistics(bool yesno);
+
 	void operator()(const std::experimental::filesystem::path &path);
+
+	/* Writes the operators' statistics and the links as JSON. */
+	void dump_json(const std::experimental::filesystem::path &path);
 };
 
 class DepsGraphDumper {
 	Depsgraph *m_graph;
+	bool m_show_statistics = false;
 
 public:
 	explicit DepsGraphDumper(Depsgraph *graph);
 
+	void show_statistics(bool yesno);
+
 	void operator()(const std::experimental::filesystem::path &path);
+
+	/* Writes the statistics of the object graphs, summed over their
+	 * operators, and the links as JSON. */
+	void dump_json(const std::experimental::filesystem::path &path);
 };
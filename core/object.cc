@@ -30,6 +30,7 @@
 
 #include "operateurs/operateurs_standards.h"
 
+#include "cache_disque.h"
 #include "scene.h"
 #include "task.h"
 
@@ -53,17 +54,46 @@ Object::Object(const Context &contexte)
 	set_prop_min_max(0.0f, 10.0f);
 	set_prop_default_value_vec3(glm::vec3(1.0f, 1.0f, 1.0f));
 
+	add_prop("read_bake", "Read Bake", property_type::prop_bool);
+	set_prop_default_value_bool(false);
+	set_prop_tooltip("Read the geometry from the bake directory for the frames that were baked.");
+
+	add_prop("bake_directory", "Bake Directory", property_type::prop_string);
+	set_prop_default_value_string("");
+
 	updateMatrix();
 }
 
-PrimitiveCollection *Object::collection() const
+Object::~Object() = default;
+
+PrimitiveCollection *Object::collection()
 {
-	return m_collection;
+	m_displayed = std::atomic_load(&m_published);
+
+	/* The collections replaced since the last call are not displayed anymore,
+	 * unless it is the current one. */
+	std::lock_guard<std::mutex> lock(m_retired_mutex);
+	m_retired.clear();
+
+	return m_displayed.get();
 }
 
-void Object::collection(PrimitiveCollection *coll)
+void Object::publie_collection(std::shared_ptr<PrimitiveCollection> collection)
 {
-	m_collection = coll;
+	auto previous = std::atomic_exchange(&m_published, std::move(collection));
+
+	/* Once swapped out, no reader can take a new reference to the previous
+	 * collection. If the UI does not hold it either, it was never displayed
+	 * and has no GPU buffers: free it here, so that the retired list does not
+	 * grow while nothing is repainted. Otherwise the UI still draws it and
+	 * must be the one releasing it; the list then only ever holds the
+	 * displayed collection. */
+	if (previous == nullptr || previous.use_count() == 1) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_retired_mutex);
+	m_retired.push_back(std::move(previous));
 }
 
 void Object::matrix(const glm::mat4 &m)
@@ -127,6 +157,29 @@ void Object::removeChild(Object *child)
 	child->parent(nullptr);
 }
 
+bool Object::lit_precalcul()
+{
+	return eval_bool("read_bake") && !eval_string("bake_directory").empty();
+}
+
+void Object::met_a_jour_lecteur_cache()
+{
+	const auto dossier = filesystem::path(eval_string("bake_directory"));
+	const auto lecteur = lecteur_cache();
+
+	if (dossier.empty()) {
+		std::atomic_store(&m_lecteur_cache, std::shared_ptr<kamikaze::LecteurCache>());
+	}
+	else if (lecteur == nullptr || lecteur->dossier() != dossier) {
+		std::atomic_store(&m_lecteur_cache, std::make_shared<kamikaze::LecteurCache>(dossier));
+	}
+}
+
+std::shared_ptr<kamikaze::LecteurCache> Object::lecteur_cache() const
+{
+	return std::atomic_load(&m_lecteur_cache);
+}
+
 const std::vector<Object *> &Object::children() const
 {
 	return m_children;
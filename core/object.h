@@ -24,6 +24,10 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "graphs/object_graph.h"
 #include "graphs/scene_node.h"
 
@@ -31,8 +35,21 @@ class Node;
 class Noeud;
 class PrimitiveCollection;
 
+namespace kamikaze {
+class LecteurCache;
+}
+
 class Object : public SceneNode {
-	PrimitiveCollection *m_collection = nullptr;
+	/* The last evaluated collection, swapped atomically by the evaluation. */
+	std::shared_ptr<PrimitiveCollection> m_published{};
+
+	/* The collection drawn by the UI. Its primitives hold GPU buffers, so it
+	 * must be released from the UI thread: the evaluation hands the displayed
+	 * collection over to the UI through the retired list when it replaces
+	 * it. */
+	std::shared_ptr<PrimitiveCollection> m_displayed{};
+	std::vector<std::shared_ptr<PrimitiveCollection>> m_retired{};
+	std::mutex m_retired_mutex{};
 
 	glm::mat4 m_matrix = glm::mat4(0.0f);
 	glm::mat4 m_inv_matrix = glm::mat4(0.0f);
@@ -42,12 +59,27 @@ class Object : public SceneNode {
 	Object *m_parent = nullptr;
 	std::vector<Object *> m_children;
 
+	/* Replaced from the UI thread while a pass may be reading it, so it is
+	 * only accessed atomically. */
+	std::shared_ptr<kamikaze::LecteurCache> m_lecteur_cache{};
+
 public:
 	explicit Object(const Context &contexte);
-	~Object() = default;
+	~Object();
+
+	/**
+	 * Return the last collection published for this object, which is not
+	 * modified by the evaluation anymore. To be called from the UI thread
+	 * only, the collection stays valid until the next call.
+	 */
+	PrimitiveCollection *collection();
 
-	PrimitiveCollection *collection() const;
-	void collection(PrimitiveCollection *coll);
+	/**
+	 * Replace the collection returned by collection() with a complete result
+	 * of the evaluation, without waiting for the UI. Can be called from any
+	 * thread.
+	 */
+	void publie_collection(std::shared_ptr<PrimitiveCollection> collection);
 
 	/* Return the object's matrix. */
 	void matrix(const glm::mat4 &m);
@@ -67,4 +99,25 @@ public:
 
 	Object *parent() const;
 	void parent(Object *parent);
+
+	/* Bake. */
+
+	/**
+	 * Return whether the evaluated geometry should be read from the bake
+	 * directory instead of evaluating the graph.
+	 */
+	bool lit_precalcul();
+
+	/**
+	 * Create the reader of the bake directory, or replace it if the directory
+	 * changed. To be called from the UI thread when the properties change.
+	 */
+	void met_a_jour_lecteur_cache();
+
+	/**
+	 * Return the reader of the bake directory, if any. The reader stays valid
+	 * for as long as the returned pointer is held, even if it is replaced in
+	 * the meantime. Can be called from any thread.
+	 */
+	std::shared_ptr<kamikaze::LecteurCache> lecteur_cache() const;
 };
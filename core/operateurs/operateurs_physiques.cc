@@ -61,6 +61,10 @@ static bool verifie_collision(const PlanPhysique &plan, const glm::vec3 &pos, co
 class OperateurGravite : public Operateur {
 	glm::vec3 m_gravite = glm::vec3{0.0f, -9.80665f, 0.0f};
 	PrimitiveCollection *m_collection_original = nullptr;
+
+	/* L'état de la simulation : chaque image continue depuis la dernière image
+	 * exécutée. Le résultat ne dépend donc pas que du temps et n'est pas
+	 * déclaré déterministe, pour ne jamais être repris d'un cache. */
 	PrimitiveCollection *m_derniere_collection = nullptr;
 	int m_image_debut = 0;
 
@@ -78,6 +82,11 @@ public:
 		delete m_derniere_collection;
 	}
 
+	type_operateur type() const override
+	{
+		return type_operateur::DYNAMIQUE;
+	}
+
 	const char *nom_entree(size_t /*index*/) override
 	{
 		return "Entrée";
@@ -141,6 +150,8 @@ public:
 					attr_vel->vec3(i, -velocite);
 				}
 			}
+
+			nuage_points->tagUpdate();
 		}
 	}
 };
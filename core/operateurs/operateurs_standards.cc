@@ -31,23 +31,31 @@
 #include <kamikaze/prim_points.h>
 #include <kamikaze/segmentprim.h>
 
+#include <kamikaze/outils/adjacence.h>
+#include <kamikaze/outils/aléatoire.h>
 #include <kamikaze/outils/géométrie.h>
 #include <kamikaze/outils/interpolation.h>
 #include <kamikaze/outils/mathématiques.h>
 #include <kamikaze/outils/parallélisme.h>
+#include <kamikaze/outils/triangles.h>
 
-#include <random>
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 
 #include "ui/paramfactory.h"
 
+/* Identifiants des attributs les plus utilisés, afin de ne pas rechercher leur
+ * nom pour chaque primitive. */
+static const auto ID_ATTR_NORMALE = attribute_id("normal", ATTR_TYPE_VEC3);
+
 /* ************************************************************************** */
 
 static const char *NOM_SORTIE = "Sortie";
 static const char *AIDE_SORTIE = "Créer un noeud de sortie.";
 
 OperateurSortie::OperateurSortie(Noeud *noeud, const Context &contexte)
-	: Operateur(noeud, contexte)
+	: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 {
 	entrees(1);
 }
@@ -76,7 +84,7 @@ static const char *AIDE_CREATION_BOITE = "Créer une boîte.";
 class OperateurCreationBoite final : public Operateur {
 public:
 	OperateurCreationBoite(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		sorties(1);
 
@@ -149,7 +157,7 @@ public:
 		}
 
 		PolygonList *polys = mesh->polys();
-		polys->resize(6);
+		polys->reserve(6);
 		polys->push_back(glm::uvec4(1, 3, 2, 0));
 		polys->push_back(glm::uvec4(3, 7, 6, 2));
 		polys->push_back(glm::uvec4(7, 5, 4, 6));
@@ -169,7 +177,7 @@ static const char *AIDE_TRANSFORMATION = "Transformer les matrices des primitive
 class OperateurTransformation : public Operateur {
 public:
 	OperateurTransformation(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
@@ -301,7 +309,7 @@ static const char *AIDE_CREATION_TORUS = "Créer un torus.";
 class OperateurCreationTorus : public Operateur {
 public:
 	OperateurCreationTorus(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		sorties(1);
 
@@ -424,7 +432,7 @@ static const char *AIDE_CREATION_GRILLE = "Créer une grille.";
 class OperateurCreationGrille : public Operateur {
 public:
 	OperateurCreationGrille(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		sorties(1);
 
@@ -525,7 +533,7 @@ static const char *AIDE_CREATION_CERCLE = "Créer un cercle.";
 class OperateurCreationCercle : public Operateur {
 public:
 	OperateurCreationCercle(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		sorties(1);
 
@@ -673,7 +681,7 @@ static const char *AIDE_CREATION_TUBE = "Créer un tube.";
 class OperateurCreationTube : public Operateur {
 public:
 	OperateurCreationTube(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		sorties(1);
 
@@ -725,7 +733,7 @@ static const char *AIDE_CREATION_CONE = "Créer un cone.";
 class OperateurCreationCone : public Operateur {
 public:
 	OperateurCreationCone(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		sorties(1);
 
@@ -820,7 +828,7 @@ static const char *AIDE_CREATION_ICOSPHERE = "Crées une icosphère.";
 class OperateurCreationIcoSphere : public Operateur {
 public:
 	OperateurCreationIcoSphere(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		sorties(1);
 
@@ -887,12 +895,19 @@ static const char *AIDE_NORMAL = "Éditer les normales.";
 class OperateurNormal : public Operateur {
 public:
 	OperateurNormal(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
 
 		add_prop("flip", "Flip", property_type::prop_bool);
+
+		EnumProperty prop_enum_ponderation;
+		prop_enum_ponderation.insert("Aire", PONDERATION_AIRE);
+		prop_enum_ponderation.insert("Angle", PONDERATION_ANGLE);
+
+		add_prop("ponderation", "Pondération", property_type::prop_enum);
+		set_prop_enum_values(prop_enum_ponderation);
 	}
 
 	const char *nom_entree(size_t /*index*/) override
@@ -915,21 +930,16 @@ public:
 		entree(0)->requiers_collection(m_collection, contexte, temps);
 
 		const auto flip = eval_bool("flip");
+		const auto ponderation = static_cast<ponderation_normale>(eval_enum("ponderation"));
 
 		for (auto &prim : primitive_iterator(this->m_collection, Mesh::id)) {
 			auto mesh = static_cast<Mesh *>(prim);
-			auto normals = mesh->attribute("normal", ATTR_TYPE_VEC3);
-			auto points = mesh->points();
+			auto normals = mesh->attribute(ID_ATTR_NORMALE);
+			const auto points = mesh->points();
 
 			normals->resize(points->size());
 
-			auto polys = mesh->polys();
-
-			for (size_t i = 0, ie = points->size(); i < ie ; ++i) {
-				normals->vec3(i, glm::vec3(0.0f));
-			}
-
-			calcule_normales(*points, *polys, *normals, flip);
+			calcule_normales(*points, *mesh->polys(), *mesh->adjacence(), *normals, flip, ponderation);
 		}
 	}
 };
@@ -953,13 +963,143 @@ enum {
 	BRUIT_FLUX = 2,
 };
 
+struct ParametresBruit {
+	float taille_inverse = 1.0f;
+	float frequence = 1.0f;
+	float amplitude = 1.0f;
+	float persistence = 1.0f;
+	float lacunarite = 2.0f;
+	int octaves = 1;
+};
+
+/* Adaptateur donnant au bruit simplex la même interface que les autres. */
+struct BruitSimplex3D {
+	void operator()(const glm::vec3 *positions, float *valeurs, size_t nombre) const
+	{
+		bruit_simplex_3d(positions, valeurs, nombre);
+	}
+};
+
+/* Le type de bruit et la direction sont des paramètres de gabarit, afin que la
+ * boucle sur les points ne contienne aucun branchement. Le bruit est évalué
+ * par lots, une octave après l'autre. */
+template <int direction, typename TypeBruit>
+static void deplace_points_bruit(
+		const Context &contexte,
+		PointList &points,
+		const Attribute *normales,
+		const TypeBruit &bruit,
+		const ParametresBruit &params)
+{
+	constexpr size_t TAILLE_BLOC = 256;
+
+	/* Les points ont déjà été détachés : les boucles lisent et écrivent
+	 * directement dans leur mémoire, sans passer par PointList::operator[]. */
+	const auto voies = points.voies();
+	const auto foulee = points.foulee();
+
+	parallel_for_light_items(tbb::blocked_range<size_t>(0, points.size()),
+							 [&](const tbb::blocked_range<size_t> &r)
+	{
+		if (evaluation_annulee(contexte)) {
+			return;
+		}
+
+		glm::vec3 positions[TAILLE_BLOC];
+		float bruits[TAILLE_BLOC];
+		float valeurs[TAILLE_BLOC];
+
+		for (auto debut = r.begin(); debut < r.end(); debut += TAILLE_BLOC) {
+			const auto taille = std::min(TAILLE_BLOC, r.end() - debut);
+
+			std::fill_n(valeurs, taille, 0.0f);
+
+			auto frequence = params.frequence;
+			auto amplitude = params.amplitude;
+
+			for (int j = 0; j < params.octaves; ++j) {
+				for (size_t i = 0; i < taille; ++i) {
+					const auto point = voies + (debut + i) * foulee;
+					positions[i] = glm::vec3((point[0] * params.taille_inverse) * frequence,
+					                         (point[1] * params.taille_inverse) * frequence,
+					                         (point[2] * params.taille_inverse) * frequence);
+				}
+
+				bruit(positions, bruits, taille);
+
+				for (size_t i = 0; i < taille; ++i) {
+					valeurs[i] += amplitude * bruits[i];
+				}
+
+				frequence *= params.lacunarite;
+				amplitude *= params.persistence;
+			}
+
+			for (size_t i = 0; i < taille; ++i) {
+				const auto point = voies + (debut + i) * foulee;
+				const auto valeur = valeurs[i];
+
+				if (direction == DIRECTION_X) {
+					point[0] += valeur;
+				}
+				else if (direction == DIRECTION_Y) {
+					point[1] += valeur;
+				}
+				else if (direction == DIRECTION_Z) {
+					point[2] += valeur;
+				}
+				else if (direction == DIRECTION_NORMALE) {
+					const auto normale = normales->vec3(debut + i);
+					point[0] += valeur * normale.x;
+					point[1] += valeur * normale.y;
+					point[2] += valeur * normale.z;
+				}
+				else {
+					point[0] += valeur;
+					point[1] += valeur;
+					point[2] += valeur;
+				}
+			}
+		}
+	});
+}
+
+template <typename TypeBruit>
+static void deplace_points_bruit(
+		const Context &contexte,
+		int direction,
+		PointList &points,
+		const Attribute *normales,
+		const TypeBruit &bruit,
+		const ParametresBruit &params)
+{
+	switch (direction) {
+		case DIRECTION_X:
+			deplace_points_bruit<DIRECTION_X>(contexte, points, normales, bruit, params);
+			break;
+		case DIRECTION_Y:
+			deplace_points_bruit<DIRECTION_Y>(contexte, points, normales, bruit, params);
+			break;
+		case DIRECTION_Z:
+			deplace_points_bruit<DIRECTION_Z>(contexte, points, normales, bruit, params);
+			break;
+		case DIRECTION_NORMALE:
+			deplace_points_bruit<DIRECTION_NORMALE>(contexte, points, normales, bruit, params);
+			break;
+		default:
+		case DIRECTION_TOUTE:
+			deplace_points_bruit<DIRECTION_TOUTE>(contexte, points, normales, bruit, params);
+			break;
+	}
+}
+
 class OperateurBruit : public Operateur {
 	BruitPerlin3D m_bruit_perlin;
 	BruitFlux3D m_bruit_flux;
 
 public:
 	OperateurBruit(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
@@ -1054,17 +1194,34 @@ public:
 			m_bruit_flux.change_temps(temps_bruit);
 		}
 
+		auto params = ParametresBruit{};
+		params.taille_inverse = taille_inverse;
+		params.frequence = ofrequency;
+		params.amplitude = oamplitude;
+		params.persistence = persistence;
+		params.lacunarite = lacunarity;
+		params.octaves = octaves;
+
+		/* Valide les primitives avant la boucle parallèle, pour que les
+		 * avertissements soient ajoutés depuis un seul thread. */
+		struct Cible {
+			PointList *points;
+			const Attribute *normales;
+		};
+
+		std::vector<Cible> cibles;
+
 		for (auto prim : primitive_iterator(this->m_collection)) {
 			PointList *points;
 
-			Attribute *normales = nullptr;
+			const Attribute *normales = nullptr;
 
 			if (prim->typeID() == Mesh::id) {
 				auto mesh = static_cast<Mesh *>(prim);
 				points = mesh->points();
-				normales = mesh->attribute("normal", ATTR_TYPE_VEC3);
+				normales = mesh->attribute(ID_ATTR_NORMALE);
 
-				if (direction == DIRECTION_NORMALE && (normales == nullptr || normales->size() == 0)) {
+				if (direction == DIRECTION_NORMALE && (normales == nullptr || normales->size() != points->size())) {
 					this->ajoute_avertissement("Absence de normales pour calculer le bruit !");
 					continue;
 				}
@@ -1082,58 +1239,31 @@ public:
 				continue;
 			}
 
-			for (size_t i = 0, e = points->size(); i < e; ++i) {
-				auto &point = (*points)[i];
-				const auto x = point.x * taille_inverse;
-				const auto y = point.y * taille_inverse;
-				const auto z = point.z * taille_inverse;
-				auto valeur = 0.0f;
+			/* Les points sont partagés avec l'entrée : détache-les avant que
+			 * les threads n'y écrivent. */
+			points->detache();
+			prim->tagUpdate();
 
-				auto frequency = ofrequency;
-				auto amplitude = oamplitude;
+			cibles.push_back({ points, normales });
+		}
 
-				for (size_t j = 0; j < octaves; ++j) {
-					if (bruit == BRUIT_SIMPLEX) {
-						valeur += (amplitude * bruit_simplex_3d(x * frequency, y * frequency, z * frequency));
-					}
-					else if (bruit == BRUIT_PERLIN) {
-						valeur += (amplitude * m_bruit_perlin(x * frequency, y * frequency, z * frequency));
-					}
-					else {
-						valeur += (amplitude * m_bruit_flux(x * frequency, y * frequency, z * frequency));
-					}
+		parallel_for_heavy_items(tbb::blocked_range<size_t>(0, cibles.size()),
+								 [&](const tbb::blocked_range<size_t> &r)
+		{
+			for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+				auto &cible = cibles[i];
 
-					frequency *= lacunarity;
-					amplitude *= persistence;
+				if (bruit == BRUIT_SIMPLEX) {
+					deplace_points_bruit(contexte, direction, *cible.points, cible.normales, BruitSimplex3D(), params);
 				}
-
-				switch (direction) {
-					case DIRECTION_X:
-						point.x += valeur;
-						break;
-					case DIRECTION_Y:
-						point.y += valeur;
-						break;
-					case DIRECTION_Z:
-						point.z += valeur;
-						break;
-					default:
-					case DIRECTION_TOUTE:
-						point.x += valeur;
-						point.y += valeur;
-						point.z += valeur;
-						break;
-					case DIRECTION_NORMALE:
-					{
-						const auto normale = normales->vec3(i);
-						point.x += valeur * normale.x;
-						point.y += valeur * normale.y;
-						point.z += valeur * normale.z;
-						break;
-					}
+				else if (bruit == BRUIT_PERLIN) {
+					deplace_points_bruit(contexte, direction, *cible.points, cible.normales, m_bruit_perlin, params);
+				}
+				else {
+					deplace_points_bruit(contexte, direction, *cible.points, cible.normales, m_bruit_flux, params);
 				}
 			}
-		}
+		});
 	}
 };
 
@@ -1155,7 +1285,7 @@ enum {
 class OperateurCouleur : public Operateur {
 public:
 	OperateurCouleur(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
@@ -1222,8 +1352,8 @@ public:
 		const auto &scope = eval_int("scope");
 		const auto &seed = eval_int("seed");
 
-		std::mt19937 rng(19937 + seed);
-		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		const auto generateur = GenerateurCompteur(19937 + seed);
+		auto index_prim = 0ul;
 
 		for (auto prim : primitive_iterator(this->m_collection)) {
 			Attribute *colors;
@@ -1240,27 +1370,39 @@ public:
 				continue;
 			}
 
+			auto couleurs = colors->view<glm::vec3>();
+
 			if (method == COLOR_NODE_UNIQUE) {
 				const auto &color = eval_vec3("color");
 
-				for (size_t i = 0, e = colors->size(); i < e; ++i) {
-					colors->vec3(i, color);
-				}
+				std::fill(couleurs.begin(), couleurs.end(), color);
 			}
 			else if (method == COLOR_NODE_RANDOM) {
+				/* Chaque primitive a son propre générateur, pour que ses
+				 * couleurs ne dépendent pas du nombre de points des autres. */
+				const auto generateur_prim = generateur.derive(index_prim);
+
 				if (scope == COLOR_NODE_VERTEX) {
-					for (size_t i = 0, e = colors->size(); i < e; ++i) {
-						colors->vec3(i, glm::vec3{dist(rng), dist(rng), dist(rng)});
-					}
+					parallel_for_light_items(tbb::blocked_range<size_t>(0, couleurs.size()),
+											 [&](const tbb::blocked_range<size_t> &r)
+					{
+						for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+							couleurs[i] = glm::vec3{generateur_prim.uniforme(i, 0),
+							                        generateur_prim.uniforme(i, 1),
+							                        generateur_prim.uniforme(i, 2)};
+						}
+					});
 				}
 				else if (scope == COLOR_NODE_PRIMITIVE) {
-					const auto &color = glm::vec3{dist(rng), dist(rng), dist(rng)};
+					const auto &color = glm::vec3{generateur.uniforme(index_prim, 0),
+					                              generateur.uniforme(index_prim, 1),
+					                              generateur.uniforme(index_prim, 2)};
 
-					for (size_t i = 0, e = colors->size(); i < e; ++i) {
-						colors->vec3(i, color);
-					}
+					std::fill(couleurs.begin(), couleurs.end(), color);
 				}
 			}
+
+			++index_prim;
 		}
 	}
 };
@@ -1273,7 +1415,7 @@ static const char *AIDE_FUSION_COLLECTION = "Fusionner des collections.";
 class OperateurFusionCollection : public Operateur {
 public:
 	OperateurFusionCollection(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(2);
 		sorties(1);
@@ -1300,15 +1442,16 @@ public:
 
 	void execute(const Context &contexte, double temps) override
 	{
-		entree(0)->requiers_collection(m_collection, contexte, temps);
-
-		auto collection2 = this->entree(1)->requiers_collection(nullptr, contexte, temps);
+		/* Les deux branches sont indépendantes jusqu'ici, exécute-les en
+		 * même temps. */
+		PrimitiveCollection *collections[2] = { m_collection, nullptr };
+		requiers_collections_paralleles(collections, 2, contexte, temps);
 
-		if (collection2 == nullptr) {
+		if (collections[1] == nullptr) {
 			return;
 		}
 
-		m_collection->merge_collection(*collection2);
+		m_collection->merge_collection(*collections[1]);
 	}
 };
 
@@ -1320,7 +1463,7 @@ static const char *AIDE_CREATION_NUAGE_POINT = "Création d'un nuage de point.";
 class OperateurCreationNuagePoint : public Operateur {
 public:
 	OperateurCreationNuagePoint(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		sorties(1);
 
@@ -1362,17 +1505,17 @@ public:
 		const auto &bbox_min = eval_vec3("bbox_min");
 		const auto &bbox_max = eval_vec3("bbox_max");
 
-		std::uniform_real_distribution<float> dist_x(bbox_min[0], bbox_max[0]);
-		std::uniform_real_distribution<float> dist_y(bbox_min[1], bbox_max[1]);
-		std::uniform_real_distribution<float> dist_z(bbox_min[2], bbox_max[2]);
-		std::mt19937 rng_x(19937);
-		std::mt19937 rng_y(19937 + 1);
-		std::mt19937 rng_z(19937 + 2);
+		const auto generateur = GenerateurCompteur(19937);
 
-		for (size_t i = 0; i < point_count; ++i) {
-			const auto &point = glm::vec3(dist_x(rng_x), dist_y(rng_y), dist_z(rng_z));
-			(*point_list)[i] = point;
-		}
+		parallel_for_light_items(tbb::blocked_range<size_t>(0, point_list->size()),
+								 [&](const tbb::blocked_range<size_t> &r)
+		{
+			for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+				(*point_list)[i] = glm::vec3(generateur.uniforme(i, 0, bbox_min[0], bbox_max[0]),
+				                             generateur.uniforme(i, 1, bbox_min[1], bbox_max[1]),
+				                             generateur.uniforme(i, 2, bbox_min[2], bbox_max[2]));
+			}
+		});
 
 		points->tagUpdate();
 	}
@@ -1386,7 +1529,7 @@ static const char *AIDE_CREATION_ATTRIBUT = "Création d'un attribut.";
 class OperateurCreationAttribut : public Operateur {
 public:
 	OperateurCreationAttribut(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
@@ -1470,7 +1613,7 @@ static const char *AIDE_SUPPRESSION_ATTRIBUT = "Suppression d'un attribut.";
 class OperateurSuppressionAttribut : public Operateur {
 public:
 	OperateurSuppressionAttribut(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
@@ -1540,10 +1683,64 @@ enum {
 	DIST_DISCRETE,
 };
 
+/* Remplis chacune des composantes des éléments de la vue avec les valeurs
+ * du générateur, appelé avec l'index de l'élément et celui de la composante.
+ * Les éléments sont remplis en parallèle. Les types non-numériques sont
+ * ignorés. */
+template <typename T, typename Generateur>
+static void remplis_composantes(AttributeView<T> /*vue*/, const Generateur &/*generateur*/)
+{}
+
+template <typename Generateur>
+static void remplis_composantes(AttributeView<float> vue, const Generateur &generateur)
+{
+	parallel_for_light_items(tbb::blocked_range<size_t>(0, vue.size()),
+							 [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			vue[i] = generateur(i, 0);
+		}
+	});
+}
+
+template <typename Vecteur, typename Generateur>
+static void remplis_vecteurs(AttributeView<Vecteur> vue, const Generateur &generateur)
+{
+	constexpr auto composantes = sizeof(Vecteur) / sizeof(float);
+
+	parallel_for_light_items(tbb::blocked_range<size_t>(0, vue.size()),
+							 [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			for (size_t c = 0; c < composantes; ++c) {
+				vue[i][c] = generateur(i, c);
+			}
+		}
+	});
+}
+
+template <typename Generateur>
+static void remplis_composantes(AttributeView<glm::vec2> vue, const Generateur &generateur)
+{
+	remplis_vecteurs(vue, generateur);
+}
+
+template <typename Generateur>
+static void remplis_composantes(AttributeView<glm::vec3> vue, const Generateur &generateur)
+{
+	remplis_vecteurs(vue, generateur);
+}
+
+template <typename Generateur>
+static void remplis_composantes(AttributeView<glm::vec4> vue, const Generateur &generateur)
+{
+	remplis_vecteurs(vue, generateur);
+}
+
 class OperateurRandomisationAttribut : public Operateur {
 public:
 	OperateurRandomisationAttribut(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
@@ -1638,11 +1835,16 @@ public:
 		auto mean = eval_float("mean");
 		auto stddev = eval_float("stddev");
 
-		std::mt19937 rng(19993754);
+		const auto generateur = GenerateurCompteur(19993754);
+		auto index_prim = 0ul;
 
-		if (attribute_type != ATTR_TYPE_VEC3) {
+		if (attribute_type != ATTR_TYPE_FLOAT
+		    && attribute_type != ATTR_TYPE_VEC2
+		    && attribute_type != ATTR_TYPE_VEC3
+		    && attribute_type != ATTR_TYPE_VEC4)
+		{
 			std::stringstream ss;
-			ss << "Only 3D Vector attributes are supported for now!";
+			ss << "Only float and vector attributes are supported for now!";
 
 			this->ajoute_avertissement(ss.str());
 			return;
@@ -1651,6 +1853,10 @@ public:
 		for (Primitive *prim : primitive_iterator(m_collection)) {
 			auto attribute = prim->attribute(name, attribute_type);
 
+			/* Chaque primitive a son propre générateur, pour que ses valeurs
+			 * ne dépendent pas de la taille des autres. */
+			const auto generateur_prim = generateur.derive(index_prim++);
+
 			if (!attribute) {
 				std::stringstream ss;
 				ss << prim->name() << " does not have an attribute named \"" << name
@@ -1660,33 +1866,34 @@ public:
 				continue;
 			}
 
+			auto remplis = [&](auto &&generateur_valeur)
+			{
+				visit_attribute(*attribute, [&](auto vue)
+				{
+					remplis_composantes(vue, generateur_valeur);
+				});
+			};
+
 			switch (distribution) {
 				case DIST_CONSTANT:
 				{
-					for (size_t i = 0; i < attribute->size(); ++i) {
-						attribute->vec3(i, glm::vec3{value, value, value});
-					}
-
+					remplis([&](size_t, size_t) { return value; });
 					break;
 				}
 				case DIST_UNIFORM:
 				{
-					std::uniform_real_distribution<float> dist(min_value, max_value);
-
-					for (size_t i = 0; i < attribute->size(); ++i) {
-						attribute->vec3(i, glm::vec3{dist(rng), dist(rng), dist(rng)});
-					}
-
+					remplis([&](size_t i, size_t c)
+					{
+						return generateur_prim.uniforme(i, c, min_value, max_value);
+					});
 					break;
 				}
 				case DIST_GAUSSIAN:
 				{
-					std::normal_distribution<float> dist(mean, stddev);
-
-					for (size_t i = 0; i < attribute->size(); ++i) {
-						attribute->vec3(i, glm::vec3{dist(rng), dist(rng), dist(rng)});
-					}
-
+					remplis([&](size_t i, size_t c)
+					{
+						return generateur_prim.normale(i, c, mean, stddev);
+					});
 					break;
 				}
 			}
@@ -1696,50 +1903,6 @@ public:
 
 /* ************************************************************************** */
 
-struct Triangle {
-	glm::vec3 v0, v1, v2;
-};
-
-std::vector<Triangle> convertis_maillage_triangles(const Mesh *maillage_entree)
-{
-	std::vector<Triangle> triangles;
-	const auto points = maillage_entree->points();
-	const auto polygones = maillage_entree->polys();
-
-	/* Convertis le maillage en triangles. */
-	auto nombre_triangles = 0ul;
-
-	for (auto i = 0ul; i < polygones->size(); ++i) {
-		const auto polygone = (*polygones)[i];
-
-		nombre_triangles += ((polygone[3] == INVALID_INDEX) ? 1 : 2);
-	}
-
-	triangles.reserve(nombre_triangles);
-
-	for (auto i = 0ul; i < polygones->size(); ++i) {
-		const auto polygone = (*polygones)[i];
-
-		Triangle triangle;
-		triangle.v0 = (*points)[polygone[0]];
-		triangle.v1 = (*points)[polygone[1]];
-		triangle.v2 = (*points)[polygone[2]];
-
-		triangles.push_back(triangle);
-
-		if (polygone[3] != INVALID_INDEX) {
-			Triangle triangle2;
-			triangle2.v0 = (*points)[polygone[0]];
-			triangle2.v1 = (*points)[polygone[2]];
-			triangle2.v2 = (*points)[polygone[3]];
-
-			triangles.push_back(triangle2);
-		}
-	}
-
-	return triangles;
-}
-
 static const char *NOM_CREATION_SEGMENTS = "Création courbes";
 static const char *AIDE_CREATION_SEGMENTS = "Création de courbes.";
 
@@ -1756,7 +1919,7 @@ enum {
 class OperateurCreationCourbes : public Operateur {
 public:
 	OperateurCreationCourbes(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
@@ -1846,7 +2009,7 @@ public:
 		}
 
 		const auto input_mesh = static_cast<Mesh *>(iter.get());
-		const auto input_points = input_mesh->points();
+		const PointList *input_points = input_mesh->points();
 
 		const auto segment_number = eval_int("segments");
 		const auto segment_normal = eval_vec3("normale");
@@ -1865,7 +2028,7 @@ public:
 			Attribute *normales = nullptr;
 
 			if (direction == DIRECTION_COURBE_NORMALE) {
-				normales = input_mesh->attribute("normal", ATTR_TYPE_VEC3);
+				normales = input_mesh->attribute(ID_ATTR_NORMALE);
 
 				if (normales == nullptr || normales->size() == 0) {
 					this->ajoute_avertissement("Il n'y a pas de données de normales sur les vertex d'entrées !");
@@ -1911,73 +2074,81 @@ public:
 			}
 		}
 		else if (methode == CREER_COURBES_POLYS) {
-			auto triangles = convertis_maillage_triangles(input_mesh);
+			const auto triangles = VueTriangles(*input_mesh->points(), *input_mesh->polys());
 
-			const auto nombre_courbes = eval_int("nombre_courbes");
-			const auto nombre_polys = triangles.size();
+			const auto nombre_courbes = static_cast<size_t>(eval_int("nombre_courbes"));
+			const auto nombre_polys = triangles.taille();
+			const auto points_par_courbe = static_cast<size_t>(segment_number + 1);
 
-			output_edges->reserve((nombre_courbes * segment_number) * nombre_polys);
-			output_points->reserve(total_points);
+			total_points = nombre_polys * nombre_courbes * points_par_courbe;
 
-			total_points = nombre_polys * nombre_courbes * (segment_number + 1);
+			output_edges->resize((nombre_courbes * segment_number) * nombre_polys);
+			output_points->resize(total_points);
 
 			const auto graine = eval_int("graine");
-
-			std::mt19937 rng(19937 + graine);
-			std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-
-			auto head = 0;
-
-			glm::vec3 normale;
-
-			for (const Triangle &triangle : triangles) {
-				const auto v0 = triangle.v0;
-				const auto v1 = triangle.v1;
-				const auto v2 = triangle.v2;
-
-				const auto e0 = v1 - v0;
-				const auto e1 = v2 - v0;
-
-				switch (direction) {
-					default:
-					case DIRECTION_COURBE_NORMALE:
-					{
-						/* Calcul la normale du polygone. */
-						normale = glm::normalize(normale_triangle(v0, v1, v2));
-						break;
-					}
-					case DIRECTION_COURBE_PERSONNALISEE:
-					{
-						normale = segment_normal;
-						break;
+			const auto generateur = GenerateurCompteur(19937 + graine);
+
+			/* La courbe j du triangle i est la courbe i * nombre_courbes + j : sa
+			 * place parmi les points et les arêtes est connue d'avance, donc les
+			 * triangles sont traités en parallèle. */
+			parallel_for(tbb::blocked_range<size_t>(0, nombre_polys),
+						 [&](const tbb::blocked_range<size_t> &plage)
+			{
+				triangles.pour_chaque(plage, [&](size_t i, const Triangle &triangle)
+				{
+					const auto generateur_triangle = generateur.derive(i);
+
+					const auto v0 = triangle.v0;
+					const auto v1 = triangle.v1;
+					const auto v2 = triangle.v2;
+
+					const auto e0 = v1 - v0;
+					const auto e1 = v2 - v0;
+
+					glm::vec3 normale;
+
+					switch (direction) {
+						default:
+						case DIRECTION_COURBE_NORMALE:
+						{
+							/* Calcul la normale du polygone. */
+							normale = glm::normalize(normale_triangle(v0, v1, v2));
+							break;
+						}
+						case DIRECTION_COURBE_PERSONNALISEE:
+						{
+							normale = segment_normal;
+							break;
+						}
 					}
-				}
 
-				for (size_t j = 0; j < nombre_courbes; ++j) {
-					/* Génère des coordonnées barycentriques aléatoires. */
-					auto r = dist(rng);
-					auto s = dist(rng);
+					for (size_t j = 0; j < nombre_courbes; ++j) {
+						/* Génère des coordonnées barycentriques aléatoires. */
+						auto r = generateur_triangle.uniforme(j, 0);
+						auto s = generateur_triangle.uniforme(j, 1);
 
-					if (r + s >= 1.0f) {
-						r = 1.0f - r;
-						s = 1.0f - s;
-					}
-
-					auto pos = v0 + r * e0 + s * e1;
+						if (r + s >= 1.0f) {
+							r = 1.0f - r;
+							s = 1.0f - s;
+						}
 
-					output_points->push_back(pos);
-					++num_points;
+						const auto courbe = i * nombre_courbes + j;
+						auto index_point = static_cast<unsigned int>(courbe * points_par_courbe);
+						auto index_arete = courbe * segment_number;
 
-					for (int k = 0; k < segment_number; ++k, ++num_points) {
-						pos += (segment_size * normale);
-						output_points->push_back(pos);
+						auto pos = v0 + r * e0 + s * e1;
+						(*output_points)[index_point] = pos;
 
-						output_edges->push_back(glm::uvec2{head, ++head});
+						for (int k = 0; k < segment_number; ++k, ++index_point) {
+							pos += (segment_size * normale);
+							(*output_points)[index_point + 1] = pos;
+							(*output_edges)[index_arete++] = glm::uvec2{index_point, index_point + 1};
+						}
 					}
+				});
+			});
 
-					++head;
-				}
-			}
+			num_points = total_points;
 		}
 
 		if (num_points != total_points) {
@@ -2061,7 +2232,7 @@ static const char *AIDE_COMMUTATEUR = "Change la direction de l'évaluation du"
 class OperateurCommutateur : public Operateur {
 public:
 	OperateurCommutateur(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(2);
 		sorties(1);
@@ -2103,10 +2274,45 @@ public:
 static const char *NOM_DISPERSION_POINTS = "Dispersion Points";
 static const char *AIDE_DISPERSION_POINTS = "Disperse des points sur une surface.";
 
+enum {
+	DISPERSION_PAR_POLYGONE = 0,
+	DISPERSION_DENSITE = 1,
+};
+
+/**
+ * Génère les points [debut, debut + nombre[ de la sortie sur le triangle. Le
+ * générateur est propre au triangle, les points ne dépendent donc pas de
+ * l'ordre dans lequel les triangles sont traités.
+ */
+static void disperse_points_triangle(
+		const Triangle &triangle,
+		const GenerateurCompteur &generateur,
+		PointList &points,
+		size_t debut,
+		size_t nombre)
+{
+	const auto v0 = triangle.v0;
+	const auto e0 = triangle.v1 - v0;
+	const auto e1 = triangle.v2 - v0;
+
+	for (size_t j = 0; j < nombre; ++j) {
+		/* Génère des coordonnées barycentriques aléatoires. */
+		auto r = generateur.uniforme(j, 0);
+		auto s = generateur.uniforme(j, 1);
+
+		if (r + s >= 1.0f) {
+			r = 1.0f - r;
+			s = 1.0f - s;
+		}
+
+		points[debut + j] = v0 + r * e0 + s * e1;
+	}
+}
+
 class OperateurDispersionPoints : public Operateur {
 public:
 	OperateurDispersionPoints(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
@@ -2121,6 +2327,30 @@ public:
 		set_prop_min_max(1, 1000);
 		set_prop_default_value_int(100);
 		set_prop_tooltip("Nombre de points par polygone.");
+
+		EnumProperty prop_enum_mode;
+		prop_enum_mode.insert("Par polygone", DISPERSION_PAR_POLYGONE);
+		prop_enum_mode.insert("Densité", DISPERSION_DENSITE);
+
+		add_prop("mode", "Mode", property_type::prop_enum);
+		set_prop_enum_values(prop_enum_mode);
+		set_prop_tooltip("Disperse un nombre fixe de points par polygone, ou un"
+		                 " nombre de points proportionnel à l'aire des polygones.");
+
+		add_prop("densite", "Densité", property_type::prop_float);
+		set_prop_min_max(0.0f, 10000.0f);
+		set_prop_default_value_float(100.0f);
+		set_prop_tooltip("Nombre de points par unité d'aire.");
+	}
+
+	bool update_properties() override
+	{
+		const auto mode = eval_enum("mode");
+
+		set_prop_visible("nombre_points_polys", mode == DISPERSION_PAR_POLYGONE);
+		set_prop_visible("densite", mode == DISPERSION_DENSITE);
+
+		return true;
 	}
 
 	const char *nom_entree(size_t /*index*/) override
@@ -2151,44 +2381,110 @@ public:
 
 		const auto maillage_entree = static_cast<Mesh *>(iter.get());
 
-		auto triangles = convertis_maillage_triangles(maillage_entree);
+		const auto triangles = VueTriangles(*maillage_entree->points(), *maillage_entree->polys());
 
 		auto nuage_points = static_cast<PrimPoints *>(m_collection->build("PrimPoints"));
 		auto points_sorties = nuage_points->points();
 
-		const auto nombre_points_polys = eval_int("nombre_points_polys");
-		const auto nombre_points = triangles.size() * nombre_points_polys;
+		const auto graine = eval_int("graine");
+		const auto generateur = GenerateurCompteur(19937 + graine);
 
-		points_sorties->reserve(nombre_points);
+		if (eval_enum("mode") == DISPERSION_DENSITE) {
+			disperse_densite(contexte, triangles, generateur, *points_sorties);
+		}
+		else {
+			disperse_par_polygone(contexte, triangles, generateur, *points_sorties);
+		}
+	}
 
-		const auto graine = eval_int("graine");
+private:
+	void disperse_par_polygone(
+			const Context &contexte,
+			const VueTriangles &triangles,
+			const GenerateurCompteur &generateur,
+			PointList &points_sorties)
+	{
+		const auto nombre_points_polys = static_cast<size_t>(eval_int("nombre_points_polys"));
 
-		std::mt19937 rng(19937 + graine);
-		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		points_sorties.resize(triangles.taille() * nombre_points_polys);
 
-		for (const Triangle &triangle : triangles) {
-			const auto v0 = triangle.v0;
-			const auto v1 = triangle.v1;
-			const auto v2 = triangle.v2;
+		/* Les points d'un triangle ne dépendent que de son index et de celui
+		 * du point : les triangles sont traités en parallèle. */
+		parallel_for(tbb::blocked_range<size_t>(0, triangles.taille()),
+					 [&](const tbb::blocked_range<size_t> &plage)
+		{
+			if (evaluation_annulee(contexte)) {
+				return;
+			}
 
-			const auto e0 = v1 - v0;
-			const auto e1 = v2 - v0;
+			triangles.pour_chaque(plage, [&](size_t i, const Triangle &triangle)
+			{
+				disperse_points_triangle(triangle, generateur.derive(i), points_sorties,
+				                         i * nombre_points_polys, nombre_points_polys);
+			});
+		});
+	}
 
-			for (size_t j = 0; j < nombre_points_polys; ++j) {
-				/* Génère des coordonnées barycentriques aléatoires. */
-				auto r = dist(rng);
-				auto s = dist(rng);
+	void disperse_densite(
+			const Context &contexte,
+			const VueTriangles &triangles,
+			const GenerateurCompteur &generateur,
+			PointList &points_sorties)
+	{
+		const auto densite = static_cast<double>(eval_float("densite"));
+		const auto nombre_triangles = triangles.taille();
 
-				if (r + s >= 1.0f) {
-					r = 1.0f - r;
-					s = 1.0f - s;
-				}
+		/* Fonction de répartition des aires : aires[i] est l'aire cumulée des
+		 * triangles qui précèdent i, aires[nombre_triangles] l'aire totale.
+		 * Les sommes sont faites en double pour que les millions de petits
+		 * triangles d'un maillage de production ne se perdent pas dans
+		 * l'arrondi. */
+		auto aires = std::vector<double>(nombre_triangles + 1, 0.0);
 
-				auto pos = v0 + r * e0 + s * e1;
+		parallel_for_light_items(tbb::blocked_range<size_t>(0, nombre_triangles),
+		                         [&](const tbb::blocked_range<size_t> &plage)
+		{
+			triangles.pour_chaque(plage, [&](size_t i, const Triangle &triangle)
+			{
+				const auto normale = glm::cross(triangle.v1 - triangle.v0,
+				                                triangle.v2 - triangle.v0);
+
+				aires[i] = 0.5 * static_cast<double>(glm::length(normale));
+			});
+		});
+
+		somme_prefixe_exclusive(aires.data(), aires.size());
+
+		/* Le triangle i reçoit les points [arrondi(aires[i] * densite),
+		 * arrondi(aires[i + 1] * densite)[ : le nombre de points de chaque
+		 * triangle est proportionnel à son aire, les erreurs d'arrondi ne
+		 * s'accumulent pas, et la taille exacte de la sortie est connue avant
+		 * de générer le moindre point. */
+		const auto debut_triangle = [&](size_t i)
+		{
+			return static_cast<size_t>(std::llround(aires[i] * densite));
+		};
 
-				points_sorties->push_back(pos);
+		points_sorties.resize(debut_triangle(nombre_triangles));
+
+		/* Le travail d'un triangle dépend de son aire : laisse TBB découper
+		 * la plage selon la charge plutôt que d'imposer un grain. */
+		parallel_for(tbb::blocked_range<size_t>(0, nombre_triangles),
+					 [&](const tbb::blocked_range<size_t> &plage)
+		{
+			if (evaluation_annulee(contexte)) {
+				return;
 			}
-		}
+
+			triangles.pour_chaque(plage, [&](size_t i, const Triangle &triangle)
+			{
+				const auto debut = debut_triangle(i);
+				const auto fin = debut_triangle(i + 1);
+
+				disperse_points_triangle(triangle, generateur.derive(i), points_sorties,
+				                         debut, fin - debut);
+			});
+		});
 	}
 };
 
@@ -2200,7 +2496,7 @@ static const char *AIDE_ = "";
 class OperateurModele : public Operateur {
 public:
 	OperateurModele(Noeud *noeud, const Context &contexte)
-		: Operateur(noeud, contexte)
+		: Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
 	{
 		entrees(1);
 		sorties(1);
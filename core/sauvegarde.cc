@@ -28,6 +28,7 @@
 #include <sstream>
 
 #include <kamikaze/operateur.h>
+#include <kamikaze/trace.h>
 
 #include "interne/tinyxml2.h"
 
@@ -109,6 +110,8 @@ static void sauvegarde_proprietes(
 
 erreur_fichier sauvegarde_projet(const filesystem::path &chemin, const Main &main, const Scene *scene)
 {
+	PorteeTrace trace("fichier", "Sauvegarde projet");
+
 	tinyxml2::XMLDocument doc;
 	doc.InsertFirstChild(doc.NewDeclaration());
 
@@ -386,6 +389,8 @@ erreur_fichier ouvre_projet(const filesystem::path &chemin, const Main &main, co
 		return erreur_fichier::NON_TROUVE;
 	}
 
+	PorteeTrace trace("fichier", "Ouverture projet");
+
 	tinyxml2::XMLDocument doc;
 	doc.LoadFile(chemin.c_str());
 
@@ -468,7 +473,8 @@ erreur_fichier ouvre_projet(const filesystem::path &chemin, const Main &main, co
 		objet->updateMatrix();
 	}
 
-	scene->updateForNewFrame(contexte);
+	/* Les objets statiques ne dépendent pas du temps, évalue-les tous. */
+	scene->evalAllObjects(contexte);
 
 	return erreur_fichier::AUCUNE_ERREUR;
 }
@@ -61,6 +61,8 @@ void Scene::addObject(SceneNode *node)
 	m_nodes.push_back(SceneNodePtr(node));
 	m_active_node = node;
 
+	static_cast<Object *>(node)->met_a_jour_lecteur_cache();
+
 	m_depsgraph.create_node(node);
 
 	notify_listeners(event_type::object | event_type::added);
@@ -125,6 +127,10 @@ void Scene::tagObjectUpdate()
 
 	object->updateMatrix();
 
+	/* Reading a bake makes the object depend on time. */
+	object->met_a_jour_lecteur_cache();
+	m_depsgraph.update_time_dependency(object);
+
 	if (object->collection()) {
 		for (auto &prim : object->collection()->primitives()) {
 			prim->tagUpdate();
@@ -164,6 +170,11 @@ void Scene::evalObjectDag(const Context &context, SceneNode *node)
 	m_depsgraph.evaluate(context, node);
 }
 
+void Scene::evalAllObjects(const Context &context)
+{
+	m_depsgraph.evaluate_all(context);
+}
+
 void Scene::connect(const Context &context, SceneNode *node_from, SceneNode *node_to)
 {
 	auto from_ob = static_cast<Object *>(node_from);
@@ -228,6 +239,9 @@ void Scene::supprime_tout()
 	}
 
 	m_nodes.clear();
+
+	/* The cached frames belong to the removed objects. */
+	m_depsgraph.frame_cache()->vide();
 }
 
 int Scene::startFrame() const
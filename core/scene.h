@@ -95,6 +95,8 @@ public:
 
 	void evalObjectDag(const Context &context, SceneNode *node);
 
+	void evalAllObjects(const Context &context);
+
 	void connect(const Context &context, SceneNode *node_from, SceneNode *node_to);
 	void disconnect(const Context &context, SceneNode *node_from, SceneNode *node_to);
 
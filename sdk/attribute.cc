@@ -24,43 +24,106 @@
 
 #include "attribute.h"
 
-template <typename Container>
-void copy(const Container &from, Container &to)
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "outils/tableau_partagé.h"
+
+/* ************************************************************************** */
+
+class TableIdentifiants {
+	/* Une table par type d'attribut, pour ne pas avoir à construire de clé. */
+	std::unordered_map<std::string, AttributeID> m_tables[ATTR_TYPE_MAT4 + 1];
+	AttributeID m_prochain_id = 0;
+	mutable std::shared_mutex m_mutex;
+
+public:
+	AttributeID trouve(const std::string &nom, AttributeType type) const
+	{
+		if (type < 0 || type > ATTR_TYPE_MAT4) {
+			return INVALID_ATTRIBUTE_ID;
+		}
+
+		std::shared_lock<std::shared_mutex> verrou(m_mutex);
+
+		const auto &table = m_tables[type];
+		const auto iter = table.find(nom);
+
+		return (iter != table.end()) ? iter->second : INVALID_ATTRIBUTE_ID;
+	}
+
+	AttributeID interne(const std::string &nom, AttributeType type)
+	{
+		auto id = trouve(nom, type);
+
+		if (id != INVALID_ATTRIBUTE_ID || type < 0 || type > ATTR_TYPE_MAT4) {
+			return id;
+		}
+
+		std::unique_lock<std::shared_mutex> verrou(m_mutex);
+
+		/* Un autre thread a pu ajouter le nom entre temps. */
+		const auto paire = m_tables[type].insert({nom, m_prochain_id});
+
+		if (paire.second) {
+			++m_prochain_id;
+		}
+
+		return paire.first->second;
+	}
+};
+
+static TableIdentifiants &table_identifiants()
+{
+	static TableIdentifiants table;
+	return table;
+}
+
+AttributeID attribute_id(const std::string &name, AttributeType type)
 {
-	std::copy(from->begin(), from->end(), to->begin());
+	return table_identifiants().interne(name, type);
 }
 
+AttributeID find_attribute_id(const std::string &name, AttributeType type)
+{
+	return table_identifiants().trouve(name, type);
+}
+
+/* ************************************************************************** */
+
 Attribute::Attribute(const std::string &name, AttributeType type, size_t size)
     : m_name(name)
     , m_type(type)
+    , m_id(attribute_id(name, type))
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			m_data.char_list = new std::vector<char>(size);
+			m_donnees = std::make_shared<std::vector<char>>(size);
 			break;
 		case ATTR_TYPE_INT:
-			m_data.int_list = new std::vector<int>(size);
+			m_donnees = std::make_shared<std::vector<int>>(size);
 			break;
 		case ATTR_TYPE_FLOAT:
-			m_data.float_list = new std::vector<float>(size);
+			m_donnees = std::make_shared<std::vector<float>>(size);
 			break;
 		case ATTR_TYPE_STRING:
-			m_data.string_list = new std::vector<std::string>(size);
+			m_donnees = std::make_shared<std::vector<std::string>>(size);
 			break;
 		case ATTR_TYPE_VEC2:
-			m_data.vec2_list = new std::vector<glm::vec2>(size);
+			m_donnees = std::make_shared<std::vector<glm::vec2>>(size);
 			break;
 		case ATTR_TYPE_VEC3:
-			m_data.vec3_list = new std::vector<glm::vec3>(size);
+			m_donnees = std::make_shared<std::vector<glm::vec3>>(size);
 			break;
 		case ATTR_TYPE_VEC4:
-			m_data.vec4_list = new std::vector<glm::vec4>(size);
+			m_donnees = std::make_shared<std::vector<glm::vec4>>(size);
 			break;
 		case ATTR_TYPE_MAT3:
-			m_data.mat3_list = new std::vector<glm::mat3>(size);
+			m_donnees = std::make_shared<std::vector<glm::mat3>>(size);
 			break;
 		case ATTR_TYPE_MAT4:
-			m_data.mat4_list = new std::vector<glm::mat4>(size);
+			m_donnees = std::make_shared<std::vector<glm::mat4>>(size);
 			break;
 		default:
 			break;
@@ -68,214 +131,244 @@ Attribute::Attribute(const std::string &name, AttributeType type, size_t size)
 }
 
 Attribute::Attribute(const Attribute &rhs)
-    : Attribute(rhs.name(), rhs.type(), rhs.size())
+    : m_donnees(rhs.m_donnees)
+    , m_name(rhs.m_name)
+    , m_type(rhs.m_type)
+    , m_id(rhs.m_id)
+{}
+
+Attribute::~Attribute() = default;
+
+template <typename T>
+std::vector<T> *Attribute::liste()
+{
+	/* Copie sur écriture : duplique le stockage s'il est partagé. */
+	if (m_donnees.use_count() > 1) {
+		const auto partage = static_cast<const std::vector<T> *>(m_donnees.get());
+		compte_octets_dupliques(partage->size() * sizeof(T));
+		m_donnees = std::make_shared<std::vector<T>>(*partage);
+	}
+
+	return static_cast<std::vector<T> *>(m_donnees.get());
+}
+
+template <typename T>
+const std::vector<T> *Attribute::liste() const
+{
+	return static_cast<const std::vector<T> *>(m_donnees.get());
+}
+
+AttributeType Attribute::type() const
+{
+	return m_type;
+}
+
+std::string Attribute::name() const
+{
+	return m_name;
+}
+
+AttributeID Attribute::id() const
+{
+	return m_id;
+}
+
+void Attribute::reserve(size_t n)
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			copy(rhs.m_data.char_list, m_data.char_list);
+			liste<char>()->reserve(n);
 			break;
 		case ATTR_TYPE_INT:
-			copy(rhs.m_data.int_list, m_data.int_list);
+			liste<int>()->reserve(n);
 			break;
 		case ATTR_TYPE_FLOAT:
-			copy(rhs.m_data.float_list, m_data.float_list);
+			liste<float>()->reserve(n);
 			break;
 		case ATTR_TYPE_STRING:
-			copy(rhs.m_data.string_list, m_data.string_list);
+			liste<std::string>()->reserve(n);
 			break;
 		case ATTR_TYPE_VEC2:
-			copy(rhs.m_data.vec2_list, m_data.vec2_list);
+			liste<glm::vec2>()->reserve(n);
 			break;
 		case ATTR_TYPE_VEC3:
-			copy(rhs.m_data.vec3_list, m_data.vec3_list);
+			liste<glm::vec3>()->reserve(n);
 			break;
 		case ATTR_TYPE_VEC4:
-			copy(rhs.m_data.vec4_list, m_data.vec4_list);
+			liste<glm::vec4>()->reserve(n);
 			break;
 		case ATTR_TYPE_MAT3:
-			copy(rhs.m_data.mat3_list, m_data.mat3_list);
+			liste<glm::mat3>()->reserve(n);
 			break;
 		case ATTR_TYPE_MAT4:
-			copy(rhs.m_data.mat4_list, m_data.mat4_list);
+			liste<glm::mat4>()->reserve(n);
 			break;
 		default:
 			break;
 	}
 }
 
-Attribute::~Attribute()
+void Attribute::resize(size_t n)
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			delete m_data.char_list;
+			liste<char>()->resize(n);
 			break;
 		case ATTR_TYPE_INT:
-			delete m_data.int_list;
+			liste<int>()->resize(n);
 			break;
 		case ATTR_TYPE_FLOAT:
-			delete m_data.float_list;
+			liste<float>()->resize(n);
 			break;
 		case ATTR_TYPE_STRING:
-			delete m_data.string_list;
+			liste<std::string>()->resize(n);
 			break;
 		case ATTR_TYPE_VEC2:
-			delete m_data.vec2_list;
+			liste<glm::vec2>()->resize(n);
 			break;
 		case ATTR_TYPE_VEC3:
-			delete m_data.vec3_list;
+			liste<glm::vec3>()->resize(n);
 			break;
 		case ATTR_TYPE_VEC4:
-			delete m_data.vec4_list;
+			liste<glm::vec4>()->resize(n);
 			break;
 		case ATTR_TYPE_MAT3:
-			delete m_data.mat3_list;
+			liste<glm::mat3>()->resize(n);
 			break;
 		case ATTR_TYPE_MAT4:
-			delete m_data.mat4_list;
+			liste<glm::mat4>()->resize(n);
 			break;
 		default:
 			break;
 	}
 }
 
-AttributeType Attribute::type() const
-{
-	return m_type;
-}
-
-std::string Attribute::name() const
+size_t Attribute::size() const
 {
-	return m_name;
+	switch (m_type) {
+		case ATTR_TYPE_BYTE:
+			return liste<char>()->size();
+		case ATTR_TYPE_INT:
+			return liste<int>()->size();
+		case ATTR_TYPE_FLOAT:
+			return liste<float>()->size();
+		case ATTR_TYPE_STRING:
+			return liste<std::string>()->size();
+		case ATTR_TYPE_VEC2:
+			return liste<glm::vec2>()->size();
+		case ATTR_TYPE_VEC3:
+			return liste<glm::vec3>()->size();
+		case ATTR_TYPE_VEC4:
+			return liste<glm::vec4>()->size();
+		case ATTR_TYPE_MAT3:
+			return liste<glm::mat3>()->size();
+		case ATTR_TYPE_MAT4:
+			return liste<glm::mat4>()->size();
+		default:
+			return 0;
+	}
 }
 
-void Attribute::reserve(size_t n)
+void Attribute::clear()
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			m_data.char_list->reserve(n);
+			liste<char>()->clear();
 			break;
 		case ATTR_TYPE_INT:
-			m_data.int_list->reserve(n);
+			liste<int>()->clear();
 			break;
 		case ATTR_TYPE_FLOAT:
-			m_data.float_list->reserve(n);
+			liste<float>()->clear();
 			break;
 		case ATTR_TYPE_STRING:
-			m_data.string_list->reserve(n);
+			liste<std::string>()->clear();
 			break;
 		case ATTR_TYPE_VEC2:
-			m_data.vec2_list->reserve(n);
+			liste<glm::vec2>()->clear();
 			break;
 		case ATTR_TYPE_VEC3:
-			m_data.vec3_list->reserve(n);
+			liste<glm::vec3>()->clear();
 			break;
 		case ATTR_TYPE_VEC4:
-			m_data.vec4_list->reserve(n);
+			liste<glm::vec4>()->clear();
 			break;
 		case ATTR_TYPE_MAT3:
-			m_data.mat3_list->reserve(n);
+			liste<glm::mat3>()->clear();
 			break;
 		case ATTR_TYPE_MAT4:
-			m_data.mat4_list->reserve(n);
+			liste<glm::mat4>()->clear();
 			break;
 		default:
 			break;
 	}
 }
 
-void Attribute::resize(size_t n)
+void Attribute::detache()
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			m_data.char_list->resize(n);
+			liste<char>();
 			break;
 		case ATTR_TYPE_INT:
-			m_data.int_list->resize(n);
+			liste<int>();
 			break;
 		case ATTR_TYPE_FLOAT:
-			m_data.float_list->resize(n);
+			liste<float>();
 			break;
 		case ATTR_TYPE_STRING:
-			m_data.string_list->resize(n);
+			liste<std::string>();
 			break;
 		case ATTR_TYPE_VEC2:
-			m_data.vec2_list->resize(n);
+			liste<glm::vec2>();
 			break;
 		case ATTR_TYPE_VEC3:
-			m_data.vec3_list->resize(n);
+			liste<glm::vec3>();
 			break;
 		case ATTR_TYPE_VEC4:
-			m_data.vec4_list->resize(n);
+			liste<glm::vec4>();
 			break;
 		case ATTR_TYPE_MAT3:
-			m_data.mat3_list->resize(n);
+			liste<glm::mat3>();
 			break;
 		case ATTR_TYPE_MAT4:
-			m_data.mat4_list->resize(n);
+			liste<glm::mat4>();
 			break;
 		default:
 			break;
 	}
 }
 
-size_t Attribute::size() const
+void *Attribute::mutable_data()
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			return m_data.char_list->size();
+			return liste<char>()->data();
 		case ATTR_TYPE_INT:
-			return m_data.int_list->size();
+			return liste<int>()->data();
 		case ATTR_TYPE_FLOAT:
-			return m_data.float_list->size();
+			return liste<float>()->data();
 		case ATTR_TYPE_STRING:
-			return m_data.string_list->size();
+			return liste<std::string>()->data();
 		case ATTR_TYPE_VEC2:
-			return m_data.vec2_list->size();
+			return liste<glm::vec2>()->data();
 		case ATTR_TYPE_VEC3:
-			return m_data.vec3_list->size();
+			return liste<glm::vec3>()->data();
 		case ATTR_TYPE_VEC4:
-			return m_data.vec4_list->size();
+			return liste<glm::vec4>()->data();
 		case ATTR_TYPE_MAT3:
-			return m_data.mat3_list->size();
+			return liste<glm::mat3>()->data();
 		case ATTR_TYPE_MAT4:
-			return m_data.mat4_list->size();
+			return liste<glm::mat4>()->data();
 		default:
-			return 0;
+			return nullptr;
 	}
 }
 
-void Attribute::clear()
+void Attribute::check_type(AttributeType type) const
 {
-	switch (m_type) {
-		case ATTR_TYPE_BYTE:
-			m_data.char_list->clear();
-			break;
-		case ATTR_TYPE_INT:
-			m_data.int_list->clear();
-			break;
-		case ATTR_TYPE_FLOAT:
-			m_data.float_list->clear();
-			break;
-		case ATTR_TYPE_STRING:
-			m_data.string_list->clear();
-			break;
-		case ATTR_TYPE_VEC2:
-			m_data.vec2_list->clear();
-			break;
-		case ATTR_TYPE_VEC3:
-			m_data.vec3_list->clear();
-			break;
-		case ATTR_TYPE_VEC4:
-			m_data.vec4_list->clear();
-			break;
-		case ATTR_TYPE_MAT3:
-			m_data.mat3_list->clear();
-			break;
-		case ATTR_TYPE_MAT4:
-			m_data.mat4_list->clear();
-			break;
-		default:
-			break;
+	if (type != m_type) {
+		throw std::runtime_error("Le type demandé ne correspond pas au type de l'attribut '" + m_name + "'");
 	}
 }
 
@@ -283,23 +376,23 @@ const void *Attribute::data() const
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			return &(*(m_data.char_list))[0];
+			return liste<char>()->data();
 		case ATTR_TYPE_INT:
-			return &(*(m_data.int_list))[0];
+			return liste<int>()->data();
 		case ATTR_TYPE_FLOAT:
-			return &(*(m_data.float_list))[0];
+			return liste<float>()->data();
 		case ATTR_TYPE_STRING:
-			return &(*(m_data.string_list))[0];
+			return liste<std::string>()->data();
 		case ATTR_TYPE_VEC2:
-			return &(*(m_data.vec2_list))[0][0];
+			return liste<glm::vec2>()->data();
 		case ATTR_TYPE_VEC3:
-			return &(*(m_data.vec3_list))[0][0];
+			return liste<glm::vec3>()->data();
 		case ATTR_TYPE_VEC4:
-			return &(*(m_data.vec4_list))[0][0];
+			return liste<glm::vec4>()->data();
 		case ATTR_TYPE_MAT3:
-			return &(*(m_data.mat3_list))[0][0];
+			return liste<glm::mat3>()->data();
 		case ATTR_TYPE_MAT4:
-			return &(*(m_data.mat4_list))[0][0];
+			return liste<glm::mat4>()->data();
 		default:
 			return nullptr;
 	}
@@ -309,23 +402,23 @@ size_t Attribute::byte_size() const
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			return m_data.char_list->size() * sizeof(char);
+			return liste<char>()->size() * sizeof(char);
 		case ATTR_TYPE_INT:
-			return m_data.int_list->size() * sizeof(int);
+			return liste<int>()->size() * sizeof(int);
 		case ATTR_TYPE_FLOAT:
-			return m_data.float_list->size() * sizeof(float);
+			return liste<float>()->size() * sizeof(float);
 		case ATTR_TYPE_STRING:
-			return m_data.string_list->size() * sizeof(std::string);
+			return liste<std::string>()->size() * sizeof(std::string);
 		case ATTR_TYPE_VEC2:
-			return m_data.vec2_list->size() * sizeof(glm::vec2);
+			return liste<glm::vec2>()->size() * sizeof(glm::vec2);
 		case ATTR_TYPE_VEC3:
-			return m_data.vec3_list->size() * sizeof(glm::vec3);
+			return liste<glm::vec3>()->size() * sizeof(glm::vec3);
 		case ATTR_TYPE_VEC4:
-			return m_data.vec4_list->size() * sizeof(glm::vec4);
+			return liste<glm::vec4>()->size() * sizeof(glm::vec4);
 		case ATTR_TYPE_MAT3:
-			return m_data.mat3_list->size() * sizeof(glm::mat3);
+			return liste<glm::mat3>()->size() * sizeof(glm::mat3);
 		case ATTR_TYPE_MAT4:
-			return m_data.mat4_list->size() * sizeof(glm::mat4);
+			return liste<glm::mat4>()->size() * sizeof(glm::mat4);
 		default:
 			return 0;
 	}
@@ -333,90 +426,90 @@ size_t Attribute::byte_size() const
 
 void Attribute::byte(size_t n, char b)
 {
-	(*(m_data.char_list))[n] = b;
+	(*(liste<char>()))[n] = b;
 }
 
 char Attribute::byte(size_t n) const
 {
-	return (*(m_data.char_list))[n];
+	return (*(liste<char>()))[n];
 }
 
 void Attribute::integer(size_t n, int i)
 {
-	(*(m_data.int_list))[n] = i;
+	(*(liste<int>()))[n] = i;
 }
 
 int Attribute::integer(size_t n) const
 {
-	return (*(m_data.int_list))[n];
+	return (*(liste<int>()))[n];
 }
 
 void Attribute::float_(size_t n, float f)
 {
-	(*(m_data.float_list))[n] = f;
+	(*(liste<float>()))[n] = f;
 }
 
 int Attribute::float_(size_t n) const
 {
-	return (*(m_data.float_list))[n];
+	return (*(liste<float>()))[n];
 }
 
 void Attribute::vec2(size_t n, const glm::vec2 &v)
 {
-	(*(m_data.vec2_list))[n] = v;
+	(*(liste<glm::vec2>()))[n] = v;
 }
 
 const glm::vec2 &Attribute::vec2(size_t n) const
 {
-	return (*(m_data.vec2_list))[n];
+	return (*(liste<glm::vec2>()))[n];
 }
 
 void Attribute::vec3(size_t n, const glm::vec3 &v)
 {
-	(*(m_data.vec3_list))[n] = v;
+	(*(liste<glm::vec3>()))[n] = v;
 }
 
 const glm::vec3 &Attribute::vec3(size_t n) const
 {
-	return (*(m_data.vec3_list))[n];
+	return (*(liste<glm::vec3>()))[n];
 }
 
 void Attribute::vec4(size_t n, const glm::vec4 &v)
 {
-	(*(m_data.vec4_list))[n] = v;
+	(*(liste<glm::vec4>()))[n] = v;
 }
 
 const glm::vec4 &Attribute::vec4(size_t n) const
 {
-	return (*(m_data.vec4_list))[n];
+	return (*(liste<glm::vec4>()))[n];
 }
 
 void Attribute::mat3(size_t n, const glm::mat3 &m)
 {
-	(*(m_data.mat3_list))[n] = m;
+	(*(liste<glm::mat3>()))[n] = m;
 }
 
 const glm::mat3 &Attribute::mat3(size_t n) const
 {
-	return (*(m_data.mat3_list))[n];
+	return (*(liste<glm::mat3>()))[n];
 }
 
 void Attribute::mat4(size_t n, const glm::mat4 &m)
 {
-	(*(m_data.mat4_list))[n] = m;
+	(*(liste<glm::mat4>()))[n] = m;
 }
 
 const glm::mat4 &Attribute::mat4(size_t n) const
 {
-	return (*(m_data.mat4_list))[n];
+	return (*(liste<glm::mat4>()))[n];
 }
 
 void Attribute::stdstring(size_t n, const std::string &str)
 {
-	(*(m_data.string_list))[n] = str;
+	(*(liste<std::string>()))[n] = str;
 }
 
 const std::string &Attribute::stdstring(size_t n) const
 {
-	return (*(m_data.string_list))[n];
+	return (*(liste<std::string>()))[n];
 }
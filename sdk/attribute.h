@@ -25,6 +25,8 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -41,21 +43,140 @@ enum AttributeType {
 	ATTR_TYPE_MAT4,
 };
 
+/**
+ * Identifiant d'un couple (nom, type) d'attribut. Les noms sont internés dans
+ * une table commune à tout le processus : deux attributs de même nom et de
+ * même type ont le même identifiant, quelle que soit la primitive qui les
+ * porte. Les identifiants sont denses et commencent à zéro, ils peuvent donc
+ * servir d'index dans un tableau.
+ */
+using AttributeID = unsigned int;
+
+static constexpr auto INVALID_ATTRIBUTE_ID = static_cast<AttributeID>(-1);
+
+/**
+ * Retourne l'identifiant du couple (nom, type), en l'ajoutant à la table s'il
+ * n'y est pas encore. Peut être appelé depuis plusieurs threads.
+ */
+AttributeID attribute_id(const std::string &name, AttributeType type);
+
+/**
+ * Retourne l'identifiant du couple (nom, type), ou INVALID_ATTRIBUTE_ID s'il
+ * n'a jamais été interné. Ne modifie pas la table.
+ */
+AttributeID find_attribute_id(const std::string &name, AttributeType type);
+
+/**
+ * Correspondance entre les types C++ et les types d'attributs.
+ */
+template <typename T>
+struct attribute_type_of;
+
+#define DEFINI_TYPE_ATTRIBUT(type_cpp, type_attribut) \
+	template <> \
+	struct attribute_type_of<type_cpp> { \
+		static constexpr AttributeType value = type_attribut; \
+	}
+
+DEFINI_TYPE_ATTRIBUT(char, ATTR_TYPE_BYTE);
+DEFINI_TYPE_ATTRIBUT(int, ATTR_TYPE_INT);
+DEFINI_TYPE_ATTRIBUT(float, ATTR_TYPE_FLOAT);
+DEFINI_TYPE_ATTRIBUT(std::string, ATTR_TYPE_STRING);
+DEFINI_TYPE_ATTRIBUT(glm::vec2, ATTR_TYPE_VEC2);
+DEFINI_TYPE_ATTRIBUT(glm::vec3, ATTR_TYPE_VEC3);
+DEFINI_TYPE_ATTRIBUT(glm::vec4, ATTR_TYPE_VEC4);
+DEFINI_TYPE_ATTRIBUT(glm::mat3, ATTR_TYPE_MAT3);
+DEFINI_TYPE_ATTRIBUT(glm::mat4, ATTR_TYPE_MAT4);
+
+#undef DEFINI_TYPE_ATTRIBUT
+
+/**
+ * Vue typée sur les données contiguës d'un attribut. Le type est vérifié une
+ * seule fois, lors de la création de la vue ; les accès se résument ensuite à
+ * de l'arithmétique de pointeurs.
+ *
+ * Une vue est invalidée par tout redimensionnement de l'attribut.
+ */
+template <typename T>
+class AttributeView {
+	T *m_data = nullptr;
+	size_t m_size = 0;
+
+public:
+	AttributeView() = default;
+
+	AttributeView(T *data, size_t size)
+	    : m_data(data)
+	    , m_size(size)
+	{}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	bool empty() const
+	{
+		return m_size == 0;
+	}
+
+	T *data() const
+	{
+		return m_data;
+	}
+
+	T &operator[](size_t i) const
+	{
+		return m_data[i];
+	}
+
+	T *begin() const
+	{
+		return m_data;
+	}
+
+	T *end() const
+	{
+		return m_data + m_size;
+	}
+
+	/**
+	 * Retourne la sous-vue des éléments [debut, fin[.
+	 */
+	AttributeView slice(size_t debut, size_t fin) const
+	{
+		return AttributeView(m_data + debut, fin - debut);
+	}
+
+	/**
+	 * Retourne la sous-vue correspondant à une plage, par exemple une
+	 * tbb::blocked_range<size_t> reçue dans un parallel_for.
+	 */
+	template <typename RangeType>
+	AttributeView slice(const RangeType &range) const
+	{
+		return slice(range.begin(), range.end());
+	}
+};
+
 class Attribute {
-	union {
-		std::vector<char> *char_list;
-		std::vector<int> *int_list;
-		std::vector<float> *float_list;
-		std::vector<std::string> *string_list;
-		std::vector<glm::vec2> *vec2_list;
-		std::vector<glm::vec3> *vec3_list;
-		std::vector<glm::vec4> *vec4_list;
-		std::vector<glm::mat3> *mat3_list;
-		std::vector<glm::mat4> *mat4_list;
-	} m_data;
+	/* Le stockage (un std::vector du type de l'attribut) est partagé entre les
+	 * copies de l'attribut, et n'est dupliqué qu'au premier accès en écriture. */
+	std::shared_ptr<void> m_donnees{};
 
 	std::string m_name;
 	AttributeType m_type;
+	AttributeID m_id;
+
+	template <typename T>
+	std::vector<T> *liste();
+
+	template <typename T>
+	const std::vector<T> *liste() const;
+
+	void *mutable_data();
+
+	void check_type(AttributeType type) const;
 
 public:
 	Attribute(const Attribute &rhs);
@@ -64,17 +185,45 @@ public:
 
 	AttributeType type() const;
 	std::string name() const;
+	AttributeID id() const;
 
 	void reserve(size_t n);
 	void resize(size_t n);
 
 	void clear();
 
+	/**
+	 * Duplique le stockage de l'attribut s'il est partagé avec une autre copie.
+	 * Il faut appeler cette méthode avant d'écrire dans l'attribut depuis
+	 * plusieurs threads.
+	 */
+	void detache();
+
 	const void *data() const;
 
 	size_t byte_size() const;
 	size_t size() const;
 
+	/**
+	 * Retourne une vue typée sur les données de l'attribut. Le stockage est
+	 * détaché une fois pour toutes, la vue peut donc être utilisée depuis
+	 * plusieurs threads. Lance une std::runtime_error si T ne correspond pas
+	 * au type de l'attribut.
+	 */
+	template <typename T>
+	AttributeView<T> view()
+	{
+		check_type(attribute_type_of<T>::value);
+		return AttributeView<T>(static_cast<T *>(mutable_data()), size());
+	}
+
+	template <typename T>
+	AttributeView<const T> view() const
+	{
+		check_type(attribute_type_of<T>::value);
+		return AttributeView<const T>(static_cast<const T *>(data()), size());
+	}
+
 	/**
 	 * @brief byte Set a byte in the attribute list.
 	 * @param n The position to write the byte in the list.
@@ -113,3 +262,66 @@ public:
 	void stdstring(size_t n, const std::string &str);
 	const std::string &stdstring(size_t n) const;
 };
+
+/**
+ * Appelle le visiteur avec une vue sur les données de l'attribut, typée selon
+ * le type de celui-ci. Le visiteur doit donc accepter une AttributeView de
+ * chacun des types d'attributs, et retourner le même type pour chacun d'eux.
+ */
+template <typename Visitor>
+auto visit_attribute(Attribute &attribute, Visitor &&visitor)
+{
+	switch (attribute.type()) {
+		case ATTR_TYPE_BYTE:
+			return visitor(attribute.view<char>());
+		case ATTR_TYPE_INT:
+			return visitor(attribute.view<int>());
+		case ATTR_TYPE_FLOAT:
+			return visitor(attribute.view<float>());
+		case ATTR_TYPE_STRING:
+			return visitor(attribute.view<std::string>());
+		case ATTR_TYPE_VEC2:
+			return visitor(attribute.view<glm::vec2>());
+		case ATTR_TYPE_VEC3:
+			return visitor(attribute.view<glm::vec3>());
+		case ATTR_TYPE_VEC4:
+			return visitor(attribute.view<glm::vec4>());
+		case ATTR_TYPE_MAT3:
+			return visitor(attribute.view<glm::mat3>());
+		case ATTR_TYPE_MAT4:
+			return visitor(attribute.view<glm::mat4>());
+		default:
+			break;
+	}
+
+	throw std::runtime_error("Attribut '" + attribute.name() + "' de type invalide");
+}
+
+template <typename Visitor>
+auto visit_attribute(const Attribute &attribute, Visitor &&visitor)
+{
+	switch (attribute.type()) {
+		case ATTR_TYPE_BYTE:
+			return visitor(attribute.view<char>());
+		case ATTR_TYPE_INT:
+			return visitor(attribute.view<int>());
+		case ATTR_TYPE_FLOAT:
+			return visitor(attribute.view<float>());
+		case ATTR_TYPE_STRING:
+			return visitor(attribute.view<std::string>());
+		case ATTR_TYPE_VEC2:
+			return visitor(attribute.view<glm::vec2>());
+		case ATTR_TYPE_VEC3:
+			return visitor(attribute.view<glm::vec3>());
+		case ATTR_TYPE_VEC4:
+			return visitor(attribute.view<glm::vec4>());
+		case ATTR_TYPE_MAT3:
+			return visitor(attribute.view<glm::mat3>());
+		case ATTR_TYPE_MAT4:
+			return visitor(attribute.view<glm::mat4>());
+		default:
+			break;
+	}
+
+	throw std::runtime_error("Attribut '" + attribute.name() + "' de type invalide");
+}
@@ -24,7 +24,10 @@
 
 #include "bruit.h"
 
+#include <algorithm>
+#include <climits>
 #include <cmath>
+#include <cstring>
 
 #include "outils/interpolation.h"
 #include "outils/mathématiques.h"
@@ -132,7 +135,9 @@ float BruitPerlin3D::operator()(const glm::vec3 &x) const { return (*this)(x[0],
 
 unsigned int BruitPerlin3D::index_hash(int i, int j, int k) const
 {
-	return m_perm[(m_perm[(m_perm[i % N] + j) % N] + k) % N];
+	/* N est une puissance de deux : le masque donne un index positif même pour
+	 * les coordonnées négatives, contrairement au modulo. */
+	return m_perm[(m_perm[(m_perm[i & (N - 1)] + j) & (N - 1)] + k) & (N - 1)];
 }
 
 /* ************************************************************************** */
@@ -171,7 +176,7 @@ void BruitFlux3D::change_temps(float temps)
 
 namespace simplex {
 
-static int perm[512] = {
+static const int perm[512] = {
 	151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
 	140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
 	247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
@@ -215,13 +220,13 @@ static int fastfloor(float x)
 	return (x < xi) ? xi - 1 : xi;
 }
 
-static float grad3[12][3] = {
+static const float grad3[12][3] = {
 	{  1,  1,  0 }, { -1,  1,  0 }, {  1, -1,  0 }, { -1, -1,  0 },
 	{  1,  0,  1 }, { -1,  0,  1 }, {  1,  0, -1 }, { -1,  0, -1 },
 	{  0,  1,  1 }, {  0, -1,  1 }, {  0,  1, -1 }, {  0, -1, -1 }
 };
 
-static float dot(float g[3], double x, double y, double z)
+static float dot(const float g[3], float x, float y, float z)
 {
 	return g[0] * x + g[1] * y + g[2] * z;
 }
@@ -366,3 +371,327 @@ float bruit_simplex_3d(float xin, float yin, float zin)
 	 * The result is scaled to stay just inside [-1,1] */
 	return 32.0f * (n0 + n1 + n2 + n3);
 }
+
+/* ************************************************************************** */
+
+/* Évaluation par lots : les positions sont transposées en voies x, y, z de
+ * TAILLE_LOT éléments, traitées avec les vecteurs de GCC. Le compilateur les
+ * traduit selon le jeu d'instructions de la fonction appelante, d'où les
+ * noyaux toujours mis en ligne. Les accès aux tables se font voie par voie.
+ *
+ * Les calculs sont faits dans le même ordre que les versions ponctuelles. */
+
+static constexpr size_t TAILLE_LOT = 8;
+
+typedef float voie_flottants __attribute__((vector_size(TAILLE_LOT * sizeof(float))));
+typedef int voie_entiers __attribute__((vector_size(TAILLE_LOT * sizeof(int))));
+
+#define TOUJOURS_EN_LIGNE inline __attribute__((always_inline))
+
+/* Équivalent de fastfloor() : les comparaisons donnent -1 dans les voies
+ * vraies. */
+#define PLANCHER_VOIES(sortie, valeur) \
+	voie_entiers sortie = __builtin_convertvector(valeur, voie_entiers); \
+	sortie += ((valeur) < __builtin_convertvector(sortie, voie_flottants))
+
+static TOUJOURS_EN_LIGNE void simplex_lot(
+		const float *xs,
+		const float *ys,
+		const float *zs,
+		float *valeurs)
+{
+	using namespace simplex;
+
+	voie_flottants xin, yin, zin;
+	std::memcpy(&xin, xs, sizeof(voie_flottants));
+	std::memcpy(&yin, ys, sizeof(voie_flottants));
+	std::memcpy(&zin, zs, sizeof(voie_flottants));
+
+	const voie_flottants zero = {};
+
+	const voie_flottants s = (xin + yin + zin) * F3;
+	const voie_flottants xs_ = xin + s;
+	const voie_flottants ys_ = yin + s;
+	const voie_flottants zs_ = zin + s;
+	PLANCHER_VOIES(i, xs_);
+	PLANCHER_VOIES(j, ys_);
+	PLANCHER_VOIES(k, zs_);
+
+	const voie_flottants t = __builtin_convertvector(i + j + k, voie_flottants) * G3;
+	const voie_flottants x0 = xin - (__builtin_convertvector(i, voie_flottants) - t);
+	const voie_flottants y0 = yin - (__builtin_convertvector(j, voie_flottants) - t);
+	const voie_flottants z0 = zin - (__builtin_convertvector(k, voie_flottants) - t);
+
+	/* Même choix de tétraèdre que bruit_simplex_3d(), par comparaisons. */
+	const voie_entiers i1 = ((x0 >= y0) & (x0 >= z0)) & 1;
+	const voie_entiers j1 = ((x0 < y0) & (y0 >= z0)) & 1;
+	const voie_entiers k1 = 1 - i1 - j1;
+	const voie_entiers i2 = ((x0 >= y0) | (x0 >= z0)) & 1;
+	const voie_entiers j2 = ((x0 < y0) | (y0 >= z0)) & 1;
+	const voie_entiers k2 = 2 - i2 - j2;
+
+	const voie_flottants x1 = x0 - __builtin_convertvector(i1, voie_flottants) + G3;
+	const voie_flottants y1 = y0 - __builtin_convertvector(j1, voie_flottants) + G3;
+	const voie_flottants z1 = z0 - __builtin_convertvector(k1, voie_flottants) + G3;
+
+	const voie_flottants x2 = x0 - __builtin_convertvector(i2, voie_flottants) + 2.0f * G3;
+	const voie_flottants y2 = y0 - __builtin_convertvector(j2, voie_flottants) + 2.0f * G3;
+	const voie_flottants z2 = z0 - __builtin_convertvector(k2, voie_flottants) + 2.0f * G3;
+
+	const voie_flottants x3 = x0 - 1.0f + 3.0f * G3;
+	const voie_flottants y3 = y0 - 1.0f + 3.0f * G3;
+	const voie_flottants z3 = z0 - 1.0f + 3.0f * G3;
+
+	const voie_entiers ii = i & 255;
+	const voie_entiers jj = j & 255;
+	const voie_entiers kk = k & 255;
+
+	/* Gradients des quatre coins, lus voie par voie. */
+	voie_flottants gx[4], gy[4], gz[4];
+
+	for (size_t l = 0; l < TAILLE_LOT; ++l) {
+		const int gi[4] = {
+			perm[ii[l] + perm[jj[l] + perm[kk[l]]]] % 12,
+			perm[ii[l] + i1[l] + perm[jj[l] + j1[l] + perm[kk[l] + k1[l]]]] % 12,
+			perm[ii[l] + i2[l] + perm[jj[l] + j2[l] + perm[kk[l] + k2[l]]]] % 12,
+			perm[ii[l] + 1 + perm[jj[l] + 1 + perm[kk[l] + 1]]] % 12,
+		};
+
+		for (int c = 0; c < 4; ++c) {
+			gx[c][l] = grad3[gi[c]][0];
+			gy[c][l] = grad3[gi[c]][1];
+			gz[c][l] = grad3[gi[c]][2];
+		}
+	}
+
+	/* Une contribution négative est annulée en ramenant t à zéro. */
+	voie_flottants t0 = 0.6f - x0 * x0 - y0 * y0 - z0 * z0;
+	t0 = (t0 < 0.0f) ? zero : t0;
+	t0 *= t0;
+	const voie_flottants n0 = t0 * t0 * (gx[0] * x0 + gy[0] * y0 + gz[0] * z0);
+
+	voie_flottants t1 = 0.6f - x1 * x1 - y1 * y1 - z1 * z1;
+	t1 = (t1 < 0.0f) ? zero : t1;
+	t1 *= t1;
+	const voie_flottants n1 = t1 * t1 * (gx[1] * x1 + gy[1] * y1 + gz[1] * z1);
+
+	voie_flottants t2 = 0.6f - x2 * x2 - y2 * y2 - z2 * z2;
+	t2 = (t2 < 0.0f) ? zero : t2;
+	t2 *= t2;
+	const voie_flottants n2 = t2 * t2 * (gx[2] * x2 + gy[2] * y2 + gz[2] * z2);
+
+	voie_flottants t3 = 0.6f - x3 * x3 - y3 * y3 - z3 * z3;
+	t3 = (t3 < 0.0f) ? zero : t3;
+	t3 *= t3;
+	const voie_flottants n3 = t3 * t3 * (gx[3] * x3 + gy[3] * y3 + gz[3] * z3);
+
+	const voie_flottants resultat = 32.0f * (n0 + n1 + n2 + n3);
+	std::memcpy(valeurs, &resultat, sizeof(voie_flottants));
+}
+
+/* Tables d'un BruitPerlin3D, passées aux noyaux par lots. */
+struct TablesPerlin {
+	const int *perm;
+	const float *base;
+	unsigned int n;
+};
+
+static TOUJOURS_EN_LIGNE void perlin_lot(
+		const TablesPerlin &tables,
+		const float *xs,
+		const float *ys,
+		const float *zs,
+		float *valeurs)
+{
+	voie_flottants x, y, z;
+	std::memcpy(&x, xs, sizeof(voie_flottants));
+	std::memcpy(&y, ys, sizeof(voie_flottants));
+	std::memcpy(&z, zs, sizeof(voie_flottants));
+
+	PLANCHER_VOIES(i, x);
+	PLANCHER_VOIES(j, y);
+	PLANCHER_VOIES(k, z);
+
+	const voie_flottants fx = x - __builtin_convertvector(i, voie_flottants);
+	const voie_flottants fy = y - __builtin_convertvector(j, voie_flottants);
+	const voie_flottants fz = z - __builtin_convertvector(k, voie_flottants);
+
+	const voie_flottants sx = fx * fx * fx * (10 - fx * (15 - fx * 6));
+	const voie_flottants sy = fy * fy * fy * (10 - fy * (15 - fy * 6));
+	const voie_flottants sz = fz * fz * fz * (10 - fz * (15 - fz * 6));
+
+	/* Vecteurs de base des huit coins de la cellule, lus voie par voie ; le
+	 * coin c est décalé de (c & 1, (c >> 1) & 1, c >> 2). */
+	const auto masque = static_cast<int>(tables.n - 1);
+	voie_flottants bx[8], by[8], bz[8];
+
+	for (size_t l = 0; l < TAILLE_LOT; ++l) {
+		for (int c = 0; c < 8; ++c) {
+			const auto ic = i[l] + (c & 1);
+			const auto jc = j[l] + ((c >> 1) & 1);
+			const auto kc = k[l] + (c >> 2);
+
+			const auto index = tables.perm[(tables.perm[(tables.perm[ic & masque] + jc) & masque] + kc) & masque];
+			const auto base = &tables.base[3 * index];
+
+			bx[c][l] = base[0];
+			by[c][l] = base[1];
+			bz[c][l] = base[2];
+		}
+	}
+
+	const voie_flottants gx = fx - 1.0f;
+	const voie_flottants gy = fy - 1.0f;
+	const voie_flottants gz = fz - 1.0f;
+
+	const voie_flottants v000 = fx * bx[0] + fy * by[0] + fz * bz[0];
+	const voie_flottants v100 = gx * bx[1] + fy * by[1] + fz * bz[1];
+	const voie_flottants v010 = fx * bx[2] + gy * by[2] + fz * bz[2];
+	const voie_flottants v110 = gx * bx[3] + gy * by[3] + fz * bz[3];
+	const voie_flottants v001 = fx * bx[4] + fy * by[4] + gz * bz[4];
+	const voie_flottants v101 = gx * bx[5] + fy * by[5] + gz * bz[5];
+	const voie_flottants v011 = fx * bx[6] + gy * by[6] + gz * bz[6];
+	const voie_flottants v111 = gx * bx[7] + gy * by[7] + gz * bz[7];
+
+	/* interp_trilineaire(), développée. */
+	const voie_flottants v00 = (1.0f - sx) * v000 + sx * v100;
+	const voie_flottants v10 = (1.0f - sx) * v010 + sx * v110;
+	const voie_flottants v01 = (1.0f - sx) * v001 + sx * v101;
+	const voie_flottants v11 = (1.0f - sx) * v011 + sx * v111;
+
+	const voie_flottants v0 = (1.0f - sy) * v00 + sy * v10;
+	const voie_flottants v1 = (1.0f - sy) * v01 + sy * v11;
+
+	const voie_flottants resultat = (1.0f - sz) * v0 + sz * v1;
+	std::memcpy(valeurs, &resultat, sizeof(voie_flottants));
+}
+
+#undef PLANCHER_VOIES
+
+struct NoyauSimplex {
+	TOUJOURS_EN_LIGNE void operator()(const float *xs, const float *ys, const float *zs, float *vs) const
+	{
+		simplex_lot(xs, ys, zs, vs);
+	}
+};
+
+struct NoyauPerlin {
+	TablesPerlin tables;
+
+	TOUJOURS_EN_LIGNE void operator()(const float *xs, const float *ys, const float *zs, float *vs) const
+	{
+		perlin_lot(tables, xs, ys, zs, vs);
+	}
+};
+
+/* Parcourt les positions par lots de TAILLE_LOT, le dernier lot étant complété
+ * par des zéros. */
+template <typename Noyau>
+static TOUJOURS_EN_LIGNE void evalue_par_lots(
+		const Noyau &noyau,
+		const glm::vec3 *positions,
+		float *valeurs,
+		size_t nombre)
+{
+	float xs[TAILLE_LOT], ys[TAILLE_LOT], zs[TAILLE_LOT], vs[TAILLE_LOT];
+
+	for (size_t debut = 0; debut < nombre; debut += TAILLE_LOT) {
+		const auto taille = std::min(TAILLE_LOT, nombre - debut);
+
+		for (size_t l = 0; l < TAILLE_LOT; ++l) {
+			const auto p = (l < taille) ? positions[debut + l] : glm::vec3(0.0f);
+			xs[l] = p.x;
+			ys[l] = p.y;
+			zs[l] = p.z;
+		}
+
+		noyau(xs, ys, zs, vs);
+
+		std::copy(vs, vs + taille, valeurs + debut);
+	}
+}
+
+/* Chaque noyau est compilé une fois par jeu d'instructions ; les versions
+ * AVX2 et SSE4.2 ne sont appelées que si le processeur les supporte. */
+
+using type_lots_simplex = void(*)(const NoyauSimplex &, const glm::vec3 *, float *, size_t);
+using type_lots_perlin = void(*)(const NoyauPerlin &, const glm::vec3 *, float *, size_t);
+
+#define DEFINI_NOYAUX_LOTS(suffixe, attribut_cible) \
+	attribut_cible static void lots_simplex_##suffixe( \
+			const NoyauSimplex &noyau, const glm::vec3 *positions, float *valeurs, size_t nombre) \
+	{ \
+		evalue_par_lots(noyau, positions, valeurs, nombre); \
+	} \
+	attribut_cible static void lots_perlin_##suffixe( \
+			const NoyauPerlin &noyau, const glm::vec3 *positions, float *valeurs, size_t nombre) \
+	{ \
+		evalue_par_lots(noyau, positions, valeurs, nombre); \
+	}
+
+DEFINI_NOYAUX_LOTS(portable, )
+
+#if defined(__x86_64__) || defined(__i386__)
+DEFINI_NOYAUX_LOTS(sse42, __attribute__((target("sse4.2"))))
+DEFINI_NOYAUX_LOTS(avx2, __attribute__((target("avx2"))))
+#endif
+
+#undef DEFINI_NOYAUX_LOTS
+#undef TOUJOURS_EN_LIGNE
+
+enum jeu_instructions {
+	JEU_PORTABLE,
+	JEU_SSE42,
+	JEU_AVX2,
+};
+
+static jeu_instructions jeu_instructions_processeur()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		return JEU_AVX2;
+	}
+
+	if (__builtin_cpu_supports("sse4.2")) {
+		return JEU_SSE42;
+	}
+#endif
+
+	return JEU_PORTABLE;
+}
+
+template <typename TypeFonction>
+static TypeFonction choisis_noyau(TypeFonction portable, TypeFonction sse42, TypeFonction avx2)
+{
+	switch (jeu_instructions_processeur()) {
+		case JEU_AVX2:
+			return avx2;
+		case JEU_SSE42:
+			return sse42;
+		default:
+		case JEU_PORTABLE:
+			return portable;
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#	define NOYAUX_LOTS(nom) nom##_portable, nom##_sse42, nom##_avx2
+#else
+#	define NOYAUX_LOTS(nom) nom##_portable, nom##_portable, nom##_portable
+#endif
+
+void bruit_simplex_3d(const glm::vec3 *positions, float *valeurs, size_t nombre)
+{
+	static const auto lots = choisis_noyau<type_lots_simplex>(NOYAUX_LOTS(lots_simplex));
+	lots(NoyauSimplex{}, positions, valeurs, nombre);
+}
+
+void BruitPerlin3D::operator()(const glm::vec3 *positions, float *valeurs, size_t nombre) const
+{
+	static const auto lots = choisis_noyau<type_lots_perlin>(NOYAUX_LOTS(lots_perlin));
+	lots(NoyauPerlin{ TablesPerlin{ m_perm, &m_basis[0][0], N } }, positions, valeurs, nombre);
+}
+
+#undef NOYAUX_LOTS
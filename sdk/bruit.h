@@ -24,8 +24,17 @@
 
 #pragma once
 
+#include <cstddef>
 #include <glm/glm.hpp>
 
+/* Les fonctions prenant un tableau de positions évaluent le bruit par lots de
+ * huit : elles choisissent à l'exécution un chemin AVX2 ou SSE4.2 selon le
+ * processeur, et sinon un chemin portable. Les opérations sont les mêmes que
+ * celles des versions ponctuelles, dans le même ordre ; les résultats peuvent
+ * toutefois différer d'au plus TOLERANCE_BRUIT_LOT si le compilateur fusionne
+ * des multiplications et des additions (-march=native, etc.). */
+static constexpr auto TOLERANCE_BRUIT_LOT = 1e-5f;
+
 class BruitPerlin3D {
 protected:
 	static const unsigned int N = 128;
@@ -41,6 +50,8 @@ public:
 
 	float operator()(const glm::vec3 &x) const;
 
+	void operator()(const glm::vec3 *positions, float *valeurs, size_t nombre) const;
+
 	unsigned int index_hash(int i, int j, int k) const;
 };
 
@@ -58,3 +69,5 @@ public:
 };
 
 float bruit_simplex_3d(float x, float y, float z);
+
+void bruit_simplex_3d(const glm::vec3 *positions, float *valeurs, size_t nombre);
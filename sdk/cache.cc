@@ -0,0 +1,171 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+
+#include "cache.h"
+
+#include "outils/empreinte.h"
+#include "primitive.h"
+
+CacheResultats::Entree::~Entree() = default;
+
+CacheResultats::CacheResultats(size_t budget)
+    : m_budget(budget)
+{}
+
+CacheResultats::~CacheResultats() = default;
+
+void CacheResultats::budget(size_t octets)
+{
+	std::unique_lock<std::mutex> verrou(m_mutex);
+	m_budget = octets;
+	supprime_entrees_en_trop();
+}
+
+size_t CacheResultats::budget() const
+{
+	std::unique_lock<std::mutex> verrou(m_mutex);
+	return m_budget;
+}
+
+bool CacheResultats::cherche(
+		uint64_t empreinte,
+		uint64_t verification,
+		PrimitiveCollection &collection,
+		std::vector<std::string> &avertissements)
+{
+	if (empreinte == EMPREINTE_INVALIDE) {
+		return false;
+	}
+
+	std::unique_lock<std::mutex> verrou(m_mutex);
+
+	auto iter = m_table.find(empreinte);
+
+	/* Une entrée dont la vérification diffère est celle d'une autre
+	 * configuration, dont l'empreinte est en collision avec celle-ci. */
+	if (iter == m_table.end() || iter->second->verification != verification) {
+		++m_echecs;
+		return false;
+	}
+
+	++m_succes;
+
+	/* Déplace l'entrée en tête de liste, les itérateurs restent valides. */
+	m_entrees.splice(m_entrees.begin(), m_entrees, iter->second);
+
+	const auto &entree = *iter->second;
+	collection.free_all();
+	collection.copy_collection(*entree.collection);
+	avertissements = entree.avertissements;
+
+	return true;
+}
+
+void CacheResultats::ajoute(
+		uint64_t empreinte,
+		uint64_t verification,
+		const PrimitiveCollection &collection,
+		const std::vector<std::string> &avertissements)
+{
+	if (empreinte == EMPREINTE_INVALIDE) {
+		return;
+	}
+
+	const auto octets = collection.taille_octets();
+
+	std::unique_lock<std::mutex> verrou(m_mutex);
+
+	if (octets > m_budget || m_table.find(empreinte) != m_table.end()) {
+		return;
+	}
+
+	Entree entree;
+	entree.empreinte = empreinte;
+	entree.verification = verification;
+	entree.collection.reset(new PrimitiveCollection(collection.factory()));
+	entree.collection->copy_collection(collection);
+	entree.avertissements = avertissements;
+	entree.octets = octets;
+
+	m_entrees.push_front(std::move(entree));
+	m_table[empreinte] = m_entrees.begin();
+	m_octets += octets;
+
+	supprime_entrees_en_trop();
+}
+
+void CacheResultats::vide()
+{
+	std::unique_lock<std::mutex> verrou(m_mutex);
+
+	m_table.clear();
+	m_entrees.clear();
+	m_octets = 0;
+}
+
+StatistiquesCache CacheResultats::statistiques() const
+{
+	std::unique_lock<std::mutex> verrou(m_mutex);
+
+	StatistiquesCache stats;
+	stats.succes = m_succes;
+	stats.echecs = m_echecs;
+	stats.evictions = m_evictions;
+	stats.nombre_entrees = m_entrees.size();
+	stats.octets = m_octets;
+	stats.budget = m_budget;
+
+	return stats;
+}
+
+void CacheResultats::reinitialise_statistiques()
+{
+	std::unique_lock<std::mutex> verrou(m_mutex);
+
+	m_succes = 0;
+	m_echecs = 0;
+	m_evictions = 0;
+}
+
+void CacheResultats::supprime_entrees_en_trop()
+{
+	while (m_octets > m_budget && !m_entrees.empty()) {
+		const auto &entree = m_entrees.back();
+
+		m_octets -= entree.octets;
+		m_table.erase(entree.empreinte);
+		m_entrees.pop_back();
+
+		++m_evictions;
+	}
+}
+
+/* ************************************************************************** */
+
+CacheResultats &cache_resultats()
+{
+	static CacheResultats cache;
+	return cache;
+}
@@ -0,0 +1,147 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class PrimitiveCollection;
+
+struct StatistiquesCache {
+	size_t succes = 0;
+	size_t echecs = 0;
+	size_t evictions = 0;
+	size_t nombre_entrees = 0;
+	size_t octets = 0;
+	size_t budget = 0;
+};
+
+/**
+ * Cache des collections produites par les opérateurs, indexées par l'empreinte
+ * de l'opérateur (voir Operateur::empreinte()). Quand le budget mémoire est
+ * dépassé, les entrées les moins récemment utilisées sont supprimées.
+ *
+ * Chaque entrée garde aussi une empreinte de vérification, calculée sur les
+ * mêmes valeurs depuis GRAINE_VERIFICATION, qui doit correspondre pour que
+ * l'entrée soit trouvée : deux configurations dont les empreintes sur 64 bits
+ * sont en collision ne partagent pas leurs résultats, sauf si leurs
+ * vérifications le sont aussi, ce qui revient à une collision sur 128 bits.
+ *
+ * Les collections sont gardées sous forme de copies dont les tampons sont
+ * partagés avec les originaux (copie sur écriture) : mettre un résultat en
+ * cache ou l'en sortir ne copie pas la géométrie.
+ *
+ * Toutes les méthodes peuvent être appelées depuis plusieurs threads.
+ */
+class CacheResultats {
+	struct Entree {
+		uint64_t empreinte = 0;
+		uint64_t verification = 0;
+		std::unique_ptr<PrimitiveCollection> collection{};
+		std::vector<std::string> avertissements{};
+		size_t octets = 0;
+
+		Entree() = default;
+		~Entree();
+
+		Entree(Entree &&) = default;
+		Entree &operator=(Entree &&) = default;
+	};
+
+	/* Les entrées, de la plus récemment utilisée à la plus ancienne. */
+	std::list<Entree> m_entrees{};
+	std::unordered_map<uint64_t, std::list<Entree>::iterator> m_table{};
+
+	size_t m_budget = 0;
+	size_t m_octets = 0;
+	size_t m_succes = 0;
+	size_t m_echecs = 0;
+	size_t m_evictions = 0;
+
+	mutable std::mutex m_mutex{};
+
+public:
+	static constexpr size_t BUDGET_DEFAUT = 1ul << 30;
+
+	explicit CacheResultats(size_t budget = BUDGET_DEFAUT);
+
+	~CacheResultats();
+
+	CacheResultats(const CacheResultats &) = delete;
+	CacheResultats &operator=(const CacheResultats &) = delete;
+
+	/**
+	 * Change le budget mémoire du cache, en octets, et supprime les entrées
+	 * en trop. Un budget nul désactive le cache.
+	 */
+	void budget(size_t octets);
+
+	size_t budget() const;
+
+	/**
+	 * Si une entrée correspond à l'empreinte et à sa vérification, remplace
+	 * le contenu de la collection passée en paramètre par une copie de celle
+	 * de l'entrée, et les avertissements par ceux de l'entrée, puis retourne
+	 * vrai. Une empreinte invalide n'est jamais trouvée, et n'est pas comptée
+	 * dans les statistiques.
+	 */
+	bool cherche(uint64_t empreinte,
+	             uint64_t verification,
+	             PrimitiveCollection &collection,
+	             std::vector<std::string> &avertissements);
+
+	/**
+	 * Met en cache une copie de la collection sous l'empreinte et la
+	 * vérification données. Les empreintes invalides, les empreintes déjà
+	 * présentes et les collections plus grandes que le budget sont ignorées.
+	 */
+	void ajoute(uint64_t empreinte,
+	            uint64_t verification,
+	            const PrimitiveCollection &collection,
+	            const std::vector<std::string> &avertissements);
+
+	/**
+	 * Supprime toutes les entrées du cache.
+	 */
+	void vide();
+
+	StatistiquesCache statistiques() const;
+
+	void reinitialise_statistiques();
+
+private:
+	void supprime_entrees_en_trop();
+};
+
+/**
+ * Retourne le cache utilisé par execute_operateur().
+ */
+CacheResultats &cache_resultats();
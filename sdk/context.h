@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <glm/glm.hpp>
 
 #include "primitive.h"
@@ -49,6 +50,31 @@ struct EvaluationContext {
 	char time_direction;
 };
 
+/**
+ * Jeton signalant qu'une évaluation en cours n'est plus nécessaire, par exemple
+ * parce que l'utilisateur a modifié le graphe depuis son lancement : son
+ * résultat serait remplacé par celui de l'évaluation suivante.
+ */
+class JetonAnnulation {
+	std::atomic<bool> m_annule{false};
+
+public:
+	void annule()
+	{
+		m_annule = true;
+	}
+
+	void reinitialise()
+	{
+		m_annule = false;
+	}
+
+	bool est_annule() const
+	{
+		return m_annule;
+	}
+};
+
 struct Context {
 	EvaluationContext *eval_ctx;
 	Scene *scene;
@@ -56,8 +82,22 @@ struct Context {
 	UsineOperateur *usine_operateur;
 	MainWindow *main_window;
 	WidgetBase *active_widget;
+
+	/** Jeton de l'évaluation en cours, nul si elle ne peut être annulée. */
+	const JetonAnnulation *annulation = nullptr;
 };
 
+/**
+ * Retourne si l'évaluation en cours a été annulée. Les opérateurs dont
+ * l'exécution est longue devraient l'appeler régulièrement, y compris dans
+ * leurs boucles parallèles, et s'arrêter au plus tôt si c'est le cas : leur
+ * résultat incomplet n'est ni gardé en cache, ni utilisé.
+ */
+inline bool evaluation_annulee(const Context &contexte)
+{
+	return contexte.annulation != nullptr && contexte.annulation->est_annule();
+}
+
 class ViewerContext {
 	glm::mat4 m_model_view;
 	glm::mat4 m_projection;
@@ -24,52 +24,175 @@
 
 #include "geomlists.h"
 
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+PointList::PointList(disposition_points disposition)
+    : m_disposition(disposition)
+{}
+
 void PointList::push_back(const glm::vec3 &point)
 {
-	m_points.push_back(point);
+	if (m_disposition == DISPOSITION_VOIES_ALIGNEES) {
+		m_voies.ajoute(VoiePoint{point, 0.0f});
+		return;
+	}
+
+	m_points.ajoute(point);
 }
 
 void PointList::push_back(glm::vec3 &&point)
 {
-	m_points.emplace_back(std::move(point));
+	push_back(static_cast<const glm::vec3 &>(point));
 }
 
 void PointList::reserve(size_t n)
 {
+	if (m_disposition == DISPOSITION_VOIES_ALIGNEES) {
+		m_voies.reserve(n);
+		return;
+	}
+
 	m_points.reserve(n);
 }
 
 void PointList::resize(size_t n)
 {
-	m_points.resize(n);
+	if (m_disposition == DISPOSITION_VOIES_ALIGNEES) {
+		m_voies.redimensionne(n);
+		return;
+	}
+
+	m_points.redimensionne(n);
 }
 
 size_t PointList::size() const
 {
-	return m_points.size();
+	if (m_disposition == DISPOSITION_VOIES_ALIGNEES) {
+		return m_voies.taille();
+	}
+
+	return m_points.taille();
 }
 
 size_t PointList::byte_size() const
 {
-	return m_points.size() * sizeof(glm::vec3);
+	if (m_disposition == DISPOSITION_VOIES_ALIGNEES) {
+		return m_voies.taille_octets();
+	}
+
+	return m_points.taille_octets();
 }
 
-const void *PointList::data() const
+void PointList::detache()
+{
+	m_points.detache();
+	m_voies.detache();
+}
+
+disposition_points PointList::disposition() const
+{
+	return m_disposition;
+}
+
+void PointList::disposition(disposition_points disposition)
 {
-	if (m_points.empty()) {
+	if (disposition == m_disposition) {
+		return;
+	}
+
+	if (disposition == DISPOSITION_VOIES_ALIGNEES) {
+		const auto &points = m_points;
+		m_voies.redimensionne(points.taille());
+
+		auto voies = m_voies.donnees();
+
+		for (size_t i = 0, ie = points.taille(); i < ie; ++i) {
+			voies[i].pos = points[i];
+		}
+
+		m_points = TableauPartage<glm::vec3>();
+	}
+	else {
+		const auto &voies = m_voies;
+		m_points.redimensionne(voies.taille());
+
+		auto points = m_points.donnees();
+
+		for (size_t i = 0, ie = voies.taille(); i < ie; ++i) {
+			points[i] = voies[i].pos;
+		}
+
+		m_voies = TableauPartage<VoiePoint>();
+	}
+
+	m_disposition = disposition;
+}
+
+size_t PointList::foulee() const
+{
+	return (m_disposition == DISPOSITION_VOIES_ALIGNEES) ? 4 : 3;
+}
+
+const float *PointList::voies() const
+{
+	if (size() == 0) {
 		return nullptr;
 	}
 
-	return (&m_points[0][0]);
+	return &(*this)[0][0];
+}
+
+float *PointList::voies()
+{
+	if (size() == 0) {
+		return nullptr;
+	}
+
+	return &(*this)[0][0];
+}
+
+const void *PointList::data() const
+{
+	return voies();
+}
+
+void PointList::partage_externe(
+		disposition_points disposition,
+		const void *donnees,
+		size_t n,
+		std::shared_ptr<const void> proprietaire)
+{
+	m_disposition = disposition;
+
+	if (disposition == DISPOSITION_VOIES_ALIGNEES) {
+		m_voies = TableauPartage<VoiePoint>::externe(
+		              static_cast<const VoiePoint *>(donnees), n, std::move(proprietaire));
+		m_points = TableauPartage<glm::vec3>();
+	}
+	else {
+		m_points = TableauPartage<glm::vec3>::externe(
+		               static_cast<const glm::vec3 *>(donnees), n, std::move(proprietaire));
+		m_voies = TableauPartage<VoiePoint>();
+	}
 }
 
 glm::vec3 &PointList::operator[](size_t i)
 {
+	if (m_disposition == DISPOSITION_VOIES_ALIGNEES) {
+		return m_voies[i].pos;
+	}
+
 	return m_points[i];
 }
 
 const glm::vec3 &PointList::operator[](size_t i) const
 {
+	if (m_disposition == DISPOSITION_VOIES_ALIGNEES) {
+		return m_voies[i].pos;
+	}
+
 	return m_points[i];
 }
 
@@ -77,12 +200,12 @@ const glm::vec3 &PointList::operator[](size_t i) const
 
 void EdgeList::push_back(const glm::uvec2 &edge)
 {
-	m_edge.push_back(edge);
+	m_edge.ajoute(edge);
 }
 
 void EdgeList::push_back(glm::uvec2 &&edge)
 {
-	m_edge.push_back(edge);
+	m_edge.ajoute(edge);
 }
 
 void EdgeList::reserve(size_t n)
@@ -92,26 +215,39 @@ void EdgeList::reserve(size_t n)
 
 void EdgeList::resize(size_t n)
 {
-	m_edge.resize(n);
+	m_edge.redimensionne(n);
 }
 
 size_t EdgeList::size() const
 {
-	return m_edge.size();
+	return m_edge.taille();
 }
 
 size_t EdgeList::byte_size() const
 {
-	return m_edge.size() * sizeof(glm::uvec2);
+	return m_edge.taille() * sizeof(glm::uvec2);
+}
+
+void EdgeList::detache()
+{
+	m_edge.detache();
 }
 
 const void *EdgeList::data() const
 {
-	if (m_edge.empty()) {
+	if (m_edge.est_vide()) {
 		return nullptr;
 	}
 
-	return (&m_edge[0][0]);
+	return m_edge.donnees();
+}
+
+void EdgeList::partage_externe(
+		const glm::uvec2 *donnees,
+		size_t n,
+		std::shared_ptr<const void> proprietaire)
+{
+	m_edge = TableauPartage<glm::uvec2>::externe(donnees, n, std::move(proprietaire));
 }
 
 glm::uvec2 &EdgeList::operator[](size_t i)
@@ -126,51 +262,249 @@ const glm::uvec2 &EdgeList::operator[](size_t i) const
 
 /* ************************************************************************** */
 
+void PolygonList::ajoute_polygone(const unsigned int *index, size_t n)
+{
+	/* nombre_triangles() et les vues sur les triangles comptent n - 2
+	 * triangles par polygone. */
+	assert(n >= 2);
+
+	if (n < 2) {
+		return;
+	}
+
+	if (m_nombre_polygones == 0 && m_uniforme) {
+		m_sommets_par_polygone = static_cast<unsigned int>(n);
+	}
+
+	if (m_uniforme && n != m_sommets_par_polygone) {
+		stocke_decalages();
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		m_index.ajoute(index[i]);
+	}
+
+	if (!m_uniforme) {
+		m_decalages.ajoute(static_cast<unsigned int>(m_index.taille()));
+	}
+
+	++m_nombre_polygones;
+}
+
 void PolygonList::push_back(const glm::uvec4 &poly)
 {
-	m_polys.push_back(poly);
+	const unsigned int index[4] = { poly[0], poly[1], poly[2], poly[3] };
+	ajoute_polygone(index, (poly[3] == INVALID_INDEX) ? 3 : 4);
 }
 
 void PolygonList::push_back(glm::uvec4 &&poly)
 {
-	m_polys.emplace_back(std::move(poly));
+	push_back(static_cast<const glm::uvec4 &>(poly));
 }
 
 void PolygonList::reserve(size_t n)
 {
-	m_polys.reserve(n);
+	reserve(n, n * 4);
 }
 
-void PolygonList::resize(size_t n)
+void PolygonList::reserve(size_t nombre_polygones, size_t nombre_index)
 {
-	m_polys.resize(n);
+	m_index.reserve(nombre_index);
+
+	if (!m_uniforme) {
+		m_decalages.reserve(nombre_polygones + 1);
+	}
+}
+
+void PolygonList::resize(size_t n, unsigned int sommets)
+{
+	if (n <= m_nombre_polygones) {
+		m_index.redimensionne(debut(n));
+
+		if (!m_uniforme) {
+			m_decalages.redimensionne(n + 1);
+		}
+
+		m_nombre_polygones = n;
+		return;
+	}
+
+	const auto index = std::vector<unsigned int>(sommets, 0);
+	const auto ajouts = n - m_nombre_polygones;
+
+	reserve(n, m_index.taille() + ajouts * sommets);
+
+	for (size_t i = 0; i < ajouts; ++i) {
+		ajoute_polygone(index.data(), sommets);
+	}
+}
+
+void PolygonList::remplace_polygone(size_t i, const unsigned int *index, size_t n)
+{
+	assert(i < m_nombre_polygones);
+	assert(n >= 2);
+
+	const auto ancien = nombre_sommets(i);
+
+	if (n != ancien) {
+		if (m_uniforme) {
+			stocke_decalages();
+		}
+
+		/* Déplace les index des polygones suivants. */
+		const auto fin = debut(i + 1);
+		const auto taille = m_index.taille();
+
+		if (n > ancien) {
+			m_index.redimensionne(taille + n - ancien);
+
+			auto donnees = m_index.donnees();
+			std::copy_backward(donnees + fin, donnees + taille, donnees + taille + n - ancien);
+		}
+		else {
+			auto donnees = m_index.donnees();
+			std::copy(donnees + fin, donnees + taille, donnees + fin - (ancien - n));
+
+			m_index.redimensionne(taille - (ancien - n));
+		}
+
+		/* L'arithmétique non signée donne le bon décalage même si le polygone
+		 * a rétréci. */
+		auto decalages = m_decalages.donnees();
+
+		for (size_t j = i + 1; j <= m_nombre_polygones; ++j) {
+			decalages[j] = static_cast<unsigned int>(decalages[j] + n - ancien);
+		}
+	}
+
+	std::copy(index, index + n, m_index.donnees() + debut(i));
+}
+
+void PolygonList::stocke_decalages()
+{
+	m_decalages.redimensionne(m_nombre_polygones + 1);
+
+	for (size_t i = 0; i <= m_nombre_polygones; ++i) {
+		m_decalages[i] = static_cast<unsigned int>(i * m_sommets_par_polygone);
+	}
+
+	m_uniforme = false;
+	m_sommets_par_polygone = 0;
 }
 
 size_t PolygonList::size() const
 {
-	return m_polys.size();
+	return m_nombre_polygones;
 }
 
 size_t PolygonList::byte_size() const
 {
-	return m_polys.size() * sizeof(glm::ivec4);
+	return m_index.taille_octets() + m_decalages.taille_octets();
+}
+
+void PolygonList::detache()
+{
+	m_index.detache();
+	m_decalages.detache();
+}
+
+size_t PolygonList::nombre_index() const
+{
+	return m_index.taille();
+}
+
+size_t PolygonList::nombre_triangles() const
+{
+	return m_index.taille() - 2 * m_nombre_polygones;
+}
+
+bool PolygonList::est_uniforme() const
+{
+	return m_uniforme;
+}
+
+unsigned int PolygonList::sommets_par_polygone() const
+{
+	return m_sommets_par_polygone;
 }
 
 const void *PolygonList::data() const
 {
-	if (m_polys.empty()) {
-		return nullptr;
+	return m_index.donnees();
+}
+
+const unsigned int *PolygonList::decalages() const
+{
+	return m_uniforme ? nullptr : m_decalages.donnees();
+}
+
+void PolygonList::partage_externe(
+		const unsigned int *index,
+		size_t nombre_index,
+		const unsigned int *decalages,
+		size_t nombre_polygones,
+		unsigned int sommets_par_polygone,
+		std::shared_ptr<const void> proprietaire)
+{
+	m_index = TableauPartage<unsigned int>::externe(index, nombre_index, proprietaire);
+	m_nombre_polygones = nombre_polygones;
+	m_uniforme = (decalages == nullptr);
+
+	if (m_uniforme) {
+		m_decalages = TableauPartage<unsigned int>();
+		m_sommets_par_polygone = sommets_par_polygone;
+	}
+	else {
+		m_decalages = TableauPartage<unsigned int>::externe(
+		                  decalages, nombre_polygones + 1, std::move(proprietaire));
+		m_sommets_par_polygone = 0;
 	}
+}
+
+glm::uvec4 PolygonList::operator[](size_t i) const
+{
+	const auto index = sommets(i);
+	const auto n = nombre_sommets(i);
+
+	auto poly = glm::uvec4(INVALID_INDEX);
+
+	for (size_t j = 0; j < std::min(n, size_t(4)); ++j) {
+		poly[j] = index[j];
+	}
+
+	return poly;
+}
+
+ReferencePolygone PolygonList::operator[](size_t i)
+{
+	return ReferencePolygone(*this, i);
+}
+
+/* ************************************************************************** */
+
+ReferencePolygone::ReferencePolygone(PolygonList &liste, size_t polygone)
+    : m_liste(liste)
+    , m_polygone(polygone)
+{}
 
-	return (&m_polys[0][0]);
+ReferencePolygone &ReferencePolygone::operator=(const glm::uvec4 &poly)
+{
+	const unsigned int index[4] = { poly[0], poly[1], poly[2], poly[3] };
+	m_liste.remplace_polygone(m_polygone, index, (poly[3] == INVALID_INDEX) ? 3 : 4);
+	return *this;
+}
+
+ReferencePolygone &ReferencePolygone::operator=(const ReferencePolygone &autre)
+{
+	return *this = static_cast<glm::uvec4>(autre);
 }
 
-glm::uvec4 &PolygonList::operator[](size_t i)
+ReferencePolygone::operator glm::uvec4() const
 {
-	return m_polys[i];
+	return static_cast<const PolygonList &>(m_liste)[m_polygone];
 }
 
-const glm::uvec4 &PolygonList::operator[](size_t i) const
+unsigned int ReferencePolygone::operator[](size_t i) const
 {
-	return m_polys[i];
+	return static_cast<glm::uvec4>(*this)[i];
 }
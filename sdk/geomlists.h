@@ -25,14 +25,41 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <vector>
+#include <limits>
+
+#include "outils/tableau_partagé.h"
+
+/**
+ * Disposition en mémoire des points d'une PointList.
+ *
+ * DISPOSITION_AOS : vecteurs de 3 flottants contigus (12 octets par point),
+ *                   c'est la disposition par défaut.
+ * DISPOSITION_VOIES_ALIGNEES : vecteurs de 3 flottants complétés à 16 octets
+ *                              sur un stockage aligné sur 64 octets, afin que
+ *                              les boucles sur les points puissent être
+ *                              vectorisées.
+ */
+enum disposition_points {
+	DISPOSITION_AOS = 0,
+	DISPOSITION_VOIES_ALIGNEES = 1,
+};
 
 class PointList {
-	std::vector<glm::vec3> m_points{};
+	/* Point complété à 16 octets, pour la disposition en voies alignées. */
+	struct VoiePoint {
+		glm::vec3 pos;
+		float bourrage;
+	};
+
+	TableauPartage<glm::vec3> m_points{};
+	TableauPartage<VoiePoint> m_voies{};
+	disposition_points m_disposition = DISPOSITION_AOS;
 
 public:
 	PointList() = default;
 
+	explicit PointList(disposition_points disposition);
+
 	void push_back(const glm::vec3 &point);
 	void push_back(glm::vec3 &&point);
 
@@ -44,8 +71,47 @@ public:
 
 	size_t byte_size() const;
 
+	/**
+	 * Le stockage est partagé entre les copies de la liste, et n'est dupliqué
+	 * qu'au premier accès non-constant. Il faut appeler cette méthode avant
+	 * d'écrire dans la liste depuis plusieurs threads.
+	 */
+	void detache();
+
+	disposition_points disposition() const;
+
+	/**
+	 * Change la disposition en mémoire des points, en convertissant les
+	 * points existants.
+	 */
+	void disposition(disposition_points disposition);
+
+	/**
+	 * Retourne le nombre de flottants séparant deux points consécutifs dans
+	 * le tampon retourné par voies() : 3 ou 4 selon la disposition.
+	 */
+	size_t foulee() const;
+
+	/**
+	 * Retourne un pointeur vers la composante X du premier point. Les
+	 * composantes du point i se trouvent à voies()[i * foulee() + 0, 1, 2].
+	 * En disposition DISPOSITION_VOIES_ALIGNEES le pointeur est aligné sur 64
+	 * octets. La version non-constante détache le stockage.
+	 */
+	const float *voies() const;
+	float *voies();
+
 	const void *data() const;
 
+	/**
+	 * Remplace les points par les n points, disposés selon disposition, lus à
+	 * l'adresse donnees sans être copiés ; voir TableauPartage::externe().
+	 */
+	void partage_externe(disposition_points disposition,
+	                     const void *donnees,
+	                     size_t n,
+	                     std::shared_ptr<const void> proprietaire);
+
 	glm::vec3 &operator[](size_t i);
 	const glm::vec3 &operator[](size_t i) const;
 };
@@ -53,7 +119,7 @@ public:
 /* ************************************************************************** */
 
 class EdgeList {
-	std::vector<glm::uvec2> m_edge{};
+	TableauPartage<glm::uvec2> m_edge{};
 
 public:
 	EdgeList() = default;
@@ -69,8 +135,14 @@ public:
 
 	size_t byte_size() const;
 
+	void detache();
+
 	const void *data() const;
 
+	void partage_externe(const glm::uvec2 *donnees,
+	                     size_t n,
+	                     std::shared_ptr<const void> proprietaire);
+
 	glm::uvec2 &operator[](size_t i);
 	const glm::uvec2 &operator[](size_t i) const;
 };
@@ -83,27 +155,169 @@ public:
  */
 static constexpr auto INVALID_INDEX = std::numeric_limits<unsigned int>::max();
 
+class PolygonList;
+
+/**
+ * Référence vers un polygone d'une PolygonList, retournée par son opérateur []
+ * non constant : elle se lit et s'écrit comme le glm::uvec4 de l'ancienne
+ * représentation. L'écriture remplace les sommets du polygone, voir
+ * PolygonList::remplace_polygone().
+ */
+class ReferencePolygone {
+	PolygonList &m_liste;
+	size_t m_polygone;
+
+public:
+	ReferencePolygone(PolygonList &liste, size_t polygone);
+
+	ReferencePolygone &operator=(const glm::uvec4 &poly);
+
+	ReferencePolygone &operator=(const ReferencePolygone &autre);
+
+	operator glm::uvec4() const;
+
+	unsigned int operator[](size_t i) const;
+};
+
+/**
+ * Liste de polygones stockée en lignes compressées : les index des sommets de
+ * tous les polygones sont mis bout à bout, et le polygone i utilise les index
+ * [debut(i), debut(i + 1)[. Les polygones peuvent donc avoir un nombre
+ * quelconque de sommets.
+ *
+ * Tant que tous les polygones ont le même nombre de sommets, les décalages ne
+ * sont pas stockés mais calculés (debut(i) = i * sommets_par_polygone()) : un
+ * maillage de triangles n'utilise alors que trois index par polygone.
+ *
+ * Les méthodes prenant ou retournant des glm::uvec4 sont conservées pour la
+ * compatibilité avec l'ancienne représentation, où les triangles avaient leur
+ * quatrième index à INVALID_INDEX.
+ */
 class PolygonList {
-	std::vector<glm::uvec4> m_polys{};
+	TableauPartage<unsigned int> m_index{};
+	TableauPartage<unsigned int> m_decalages{};
+	size_t m_nombre_polygones = 0;
+	unsigned int m_sommets_par_polygone = 0;
+	bool m_uniforme = true;
 
 public:
 	PolygonList() = default;
 
+	/**
+	 * Ajoute un polygone de n sommets, n >= 2 (un segment a deux sommets).
+	 * Les polygones de moins de deux sommets sont ignorés.
+	 */
+	void ajoute_polygone(const unsigned int *index, size_t n);
+
+	/**
+	 * Ajoute un triangle, ou un quadrilatère si poly[3] != INVALID_INDEX.
+	 */
 	void push_back(const glm::uvec4 &poly);
 
 	void push_back(glm::uvec4 &&poly);
 
+	/**
+	 * Réserve la mémoire pour n polygones de quatre sommets au plus.
+	 */
 	void reserve(size_t n);
 
-	void resize(size_t n);
+	void reserve(size_t nombre_polygones, size_t nombre_index);
+
+	/**
+	 * Change le nombre de polygones. Les polygones ajoutés ont le nombre de
+	 * sommets donné, tous d'index 0, et doivent être remplacés ensuite ; par
+	 * défaut ce sont des quadrilatères, comme dans l'ancienne représentation.
+	 */
+	void resize(size_t n, unsigned int sommets = 4);
+
+	/**
+	 * Remplace les sommets du polygone i par les n donnés, n >= 2. Si le
+	 * nombre de sommets change, les index des polygones suivants sont
+	 * déplacés : pour construire une liste, préférer ajoute_polygone(), ou
+	 * resize() avec le nombre de sommets des polygones à venir.
+	 */
+	void remplace_polygone(size_t i, const unsigned int *index, size_t n);
 
 	size_t size() const;
 
 	size_t byte_size() const;
 
+	void detache();
+
+	/**
+	 * Retourne le nombre total d'index, tous polygones confondus.
+	 */
+	size_t nombre_index() const;
+
+	/**
+	 * Retourne le nombre de triangles obtenus en triangulant tous les
+	 * polygones en éventail.
+	 */
+	size_t nombre_triangles() const;
+
+	/**
+	 * Retourne vrai si tous les polygones ont le même nombre de sommets.
+	 */
+	bool est_uniforme() const;
+
+	unsigned int sommets_par_polygone() const;
+
+	size_t debut(size_t i) const
+	{
+		return m_uniforme ? i * m_sommets_par_polygone : m_decalages[i];
+	}
+
+	size_t nombre_sommets(size_t i) const
+	{
+		return debut(i + 1) - debut(i);
+	}
+
+	/**
+	 * Retourne un pointeur vers les index des sommets du polygone i.
+	 */
+	const unsigned int *sommets(size_t i) const
+	{
+		return m_index.donnees() + debut(i);
+	}
+
+	/**
+	 * Retourne les index bout à bout de tous les polygones.
+	 */
 	const void *data() const;
 
-	glm::uvec4 &operator[](size_t i);
-
-	const glm::uvec4 &operator[](size_t i) const;
+	/**
+	 * Retourne les size() + 1 décalages des polygones, ou nullptr si la liste
+	 * est uniforme.
+	 */
+	const unsigned int *decalages() const;
+
+	/**
+	 * Remplace les polygones par ceux décrits par les index et décalages
+	 * donnés, lus sans être copiés ; voir TableauPartage::externe(). Si
+	 * decalages est nul, tous les polygones ont sommets_par_polygone sommets.
+	 */
+	void partage_externe(const unsigned int *index,
+	                     size_t nombre_index,
+	                     const unsigned int *decalages,
+	                     size_t nombre_polygones,
+	                     unsigned int sommets_par_polygone,
+	                     std::shared_ptr<const void> proprietaire);
+
+	/**
+	 * Retourne les quatre premiers index du polygone i ; ceux qui manquent,
+	 * par exemple le quatrième d'un triangle, valent INVALID_INDEX. N'a de
+	 * sens que pour des polygones de quatre sommets au plus.
+	 */
+	glm::uvec4 operator[](size_t i) const;
+
+	/**
+	 * Retourne une référence vers le polygone i, qui s'écrit comme un
+	 * glm::uvec4 : un triangle a son quatrième index à INVALID_INDEX.
+	 */
+	ReferencePolygone operator[](size_t i);
+
+private:
+	/* Stocke les décalages des polygones, pour qu'ils puissent avoir des
+	 * nombres de sommets différents. */
+	void stocke_decalages();
 };
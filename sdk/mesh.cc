@@ -29,12 +29,16 @@
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "outils/adjacence.h"
 #include "outils/géométrie.h"
 #include "outils/parallélisme.h"
 
 #include "context.h"
 #include "renderbuffer.h"
 
+static const auto ID_ATTR_NORMALE = attribute_id("normal", ATTR_TYPE_VEC3);
+static const auto ID_ATTR_COULEUR = attribute_id("color", ATTR_TYPE_VEC3);
+
 /* ************************************************************************** */
 
 static RenderBuffer *create_surface_buffer()
@@ -78,23 +82,16 @@ Mesh::Mesh()
 
 Mesh::Mesh(const Mesh &other)
     : Primitive(other)
+    , m_point_list(other.m_point_list)
+    , m_poly_list(other.m_poly_list)
     , m_renderbuffer(nullptr)
 {
-	/* Copy points. */
-	auto points = other.points();
-	m_point_list.resize(points->size());
-
-	for (auto i = 0ul; i < points->size(); ++i) {
-		m_point_list[i] = (*points)[i];
-	}
-
-	/* Copy points. */
-	auto polys = other.polys();
-	m_poly_list.resize(polys->size());
-
-	for (auto i = 0ul; i < polys->size(); ++i) {
-		m_poly_list[i] = (*polys)[i];
-	}
+	/* La copie a la même version que l'original : l'adjacence, immuable, peut
+	 * être partagée. */
+	std::lock_guard<std::mutex> lock(other.m_mutex_adjacence);
+	m_adjacence = other.m_adjacence;
+	m_version_adjacence = other.m_version_adjacence;
+	m_index_adjacence = other.m_index_adjacence;
 }
 
 Mesh::~Mesh()
@@ -122,6 +119,27 @@ const PolygonList *Mesh::polys() const
 	return &m_poly_list;
 }
 
+std::shared_ptr<const AdjacenceMaillage> Mesh::adjacence() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex_adjacence);
+
+	/* Le nombre d'index est aussi vérifié, au cas où les polygones auraient
+	 * été modifiés sans appeler tagUpdate(). */
+	if (m_adjacence == nullptr
+	    || m_version_adjacence != m_version
+	    || m_index_adjacence != m_poly_list.nombre_index())
+	{
+		auto adjacence = std::make_shared<AdjacenceMaillage>();
+		construit_adjacence(m_poly_list, m_point_list.size(), *adjacence);
+
+		m_adjacence = std::move(adjacence);
+		m_version_adjacence = m_version;
+		m_index_adjacence = m_poly_list.nombre_index();
+	}
+
+	return m_adjacence;
+}
+
 void Mesh::update()
 {
 	if (m_need_update) {
@@ -134,10 +152,17 @@ void Mesh::update()
 
 Primitive *Mesh::copy() const
 {
-	auto mesh = new Mesh(*this);
-	mesh->tagUpdate();
+	return new Mesh(*this);
+}
 
-	return mesh;
+size_t Mesh::taille_octets() const
+{
+	return Primitive::taille_octets() + m_point_list.byte_size() + m_poly_list.byte_size();
+}
+
+size_t Mesh::nombre_points() const
+{
+	return m_point_list.size();
 }
 
 size_t Mesh::typeID() const
@@ -194,23 +219,7 @@ void Mesh::prepareRenderData()
 	}
 
 	auto indices = std::vector<unsigned int>{};
-	indices.reserve(this->polys()->size());
-
-	auto polys = this->polys();
-
-	for (auto i = 0ul, ie = polys->size(); i < ie; ++i) {
-		const auto &quad = (*polys)[i];
-
-		indices.push_back(quad[0]);
-		indices.push_back(quad[1]);
-		indices.push_back(quad[2]);
-
-		if (quad[3] != INVALID_INDEX) {
-			indices.push_back(quad[0]);
-			indices.push_back(quad[2]);
-			indices.push_back(quad[3]);
-		}
-	}
+	triangule_polygones(m_poly_list, indices);
 
 	m_renderbuffer->can_outline(true);
 
@@ -219,24 +228,23 @@ void Mesh::prepareRenderData()
 	                                  m_point_list.byte_size(),
 	                                  &indices[0],
 	                                  indices.size() * sizeof(GLuint),
-	                                  indices.size());
+	                                  indices.size(),
+	                                  m_point_list.foulee());
 
-	auto normals = this->attribute("normal", ATTR_TYPE_VEC3);
+	auto normals = this->attribute(ID_ATTR_NORMALE);
 
 	if (normals != nullptr) {
 		if (normals->size() != this->points()->size()) {
-			auto normals = this->attribute("normal", ATTR_TYPE_VEC3);
+			auto normals = this->attribute(ID_ATTR_NORMALE);
 			normals->resize(this->points()->size());
 
-			auto polys = this->polys();
-
-			calcule_normales(m_point_list, *polys, *normals, false);
+			calcule_normales(m_point_list, m_poly_list, *this->adjacence(), *normals, false);
 		}
 
 		m_renderbuffer->set_normal_buffer("normal", normals->data(), normals->byte_size());
 	}
 
-	auto colors = this->attribute("color", ATTR_TYPE_VEC3);
+	auto colors = this->attribute(ID_ATTR_COULEUR);
 
 	if (colors != nullptr) {
 		m_renderbuffer->set_color_buffer("vertex_color", colors->data(), colors->byte_size());
@@ -247,9 +255,8 @@ void Mesh::prepareRenderData()
 
 void Mesh::computeBBox(glm::vec3 &min, glm::vec3 &max)
 {
-	calcule_boite_delimitation(m_point_list, m_min, m_max);
+	met_a_jour_boite_delimitation(m_point_list);
 
 	min = m_min;
 	max = m_max;
-	m_dimensions = m_max - m_min;
 }
@@ -24,11 +24,15 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+
 #include "attribute.h"
 #include "geomlists.h"
 #include "primitive.h"
 
 class RenderBuffer;
+struct AdjacenceMaillage;
 
 class Mesh : public Primitive {
 	PointList m_point_list = {};
@@ -36,6 +40,13 @@ class Mesh : public Primitive {
 
 	RenderBuffer *m_renderbuffer = nullptr;
 
+	/* Adjacence construite à la demande, et la version de la primitive pour
+	 * laquelle elle a été construite. */
+	mutable std::shared_ptr<const AdjacenceMaillage> m_adjacence{};
+	mutable unsigned long m_version_adjacence = 0;
+	mutable size_t m_index_adjacence = 0;
+	mutable std::mutex m_mutex_adjacence{};
+
 public:
 	Mesh();
 	Mesh(const Mesh &other);
@@ -65,6 +76,15 @@ public:
 	 */
 	const PolygonList *polys() const;
 
+	/**
+	 * Retourne l'adjacence des polygones de ce maillage, construite au premier
+	 * appel puis gardée en cache jusqu'au prochain appel de tagUpdate().
+	 *
+	 * Le pointeur retourné reste valide même si le cache est reconstruit entre
+	 * temps. Cette méthode peut être appelée depuis plusieurs threads.
+	 */
+	std::shared_ptr<const AdjacenceMaillage> adjacence() const;
+
 	void update() override;
 
 	void render(const ViewerContext &context) override;
@@ -75,6 +95,10 @@ public:
 
 	Primitive *copy() const override;
 
+	size_t taille_octets() const override;
+
+	size_t nombre_points() const override;
+
 	static size_t id;
 	size_t typeID() const override;
 };
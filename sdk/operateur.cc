@@ -24,11 +24,101 @@
 
 #include "operateur.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
 #include <tbb/tick_count.h>
 
+#include "cache.h"
 #include "context.h"
 #include "noeud.h"
+#include "outils/empreinte.h"
+#include "outils/tableau_partagé.h"
 #include "primitive.h"
+#include "trace.h"
+
+/* ************************************************************************** */
+
+/* Temps passé, et éléments reçus, par le thread dans les entrées de l'opérateur
+ * qu'il exécute : le temps est soustrait de celui de l'opérateur, pour qu'il ne
+ * comprenne pas l'exécution des opérateurs en amont. */
+struct MesureAmont {
+	double temps = 0.0;
+	size_t points = 0;
+	size_t primitives = 0;
+};
+
+static thread_local MesureAmont mesure_amont;
+
+/* Commence une nouvelle mesure, et rétablit celle de l'appelant à la fin de
+ * la portée. Le compteur d'octets dupliqués du thread est repris de la même
+ * façon : les copies sont celles de l'opérateur lui-même, celles des
+ * opérateurs en amont étant comptées dans leur propre mesure. */
+class PorteeMesureAmont {
+	MesureAmont m_mesure_appelant;
+	size_t m_octets_appelant;
+
+public:
+	PorteeMesureAmont()
+	    : m_mesure_appelant(mesure_amont)
+	    , m_octets_appelant(octets_dupliques_thread())
+	{
+		mesure_amont = MesureAmont{};
+		octets_dupliques_thread() = 0;
+	}
+
+	~PorteeMesureAmont()
+	{
+		mesure_amont = m_mesure_appelant;
+		octets_dupliques_thread() = m_octets_appelant;
+	}
+};
+
+/* ************************************************************************** */
+
+/* Les empreintes calculées pendant une PorteeEmpreintes, avec et sans le
+ * paramètre configuration. */
+struct MemoireEmpreintes {
+	std::mutex verrou{};
+	std::unordered_map<const Operateur *, EmpreintesOperateur> empreintes[2]{};
+};
+
+static thread_local MemoireEmpreintes *memoire_empreintes = nullptr;
+
+PorteeEmpreintes::PorteeEmpreintes()
+{
+	if (memoire_empreintes == nullptr) {
+		m_memoire.reset(new MemoireEmpreintes);
+		memoire_empreintes = m_memoire.get();
+	}
+}
+
+PorteeEmpreintes::~PorteeEmpreintes()
+{
+	if (m_memoire != nullptr) {
+		memoire_empreintes = nullptr;
+	}
+}
+
+/* Utilise la mémoire donnée sur le thread, et rétablit celle du thread à la
+ * fin de la portée. */
+class PartageMemoireEmpreintes {
+	MemoireEmpreintes *m_memoire_thread;
+
+public:
+	explicit PartageMemoireEmpreintes(MemoireEmpreintes *memoire)
+	    : m_memoire_thread(memoire_empreintes)
+	{
+		memoire_empreintes = memoire;
+	}
+
+	~PartageMemoireEmpreintes()
+	{
+		memoire_empreintes = m_memoire_thread;
+	}
+};
 
 /* ************************************************************************** */
 
@@ -38,10 +128,40 @@ void execute_operateur(Operateur *operateur, const Context &contexte, double tem
 		return;
 	}
 
+	if (evaluation_annulee(contexte)) {
+		return;
+	}
+
+	PorteeTrace trace("operateur", operateur->nom());
+	PorteeMesureAmont portee_mesure;
+	PorteeEmpreintes portee_empreintes;
+
 	operateur->supprime_avertissements();
 
 	auto t0 = tbb::tick_count::now();
 
+	auto &cache = cache_resultats();
+	const auto empreintes = operateur->calcule_empreinte(false);
+	auto collection = operateur->collection();
+
+	/* Le résultat d'une configuration déjà évaluée est repris du cache, sans
+	 * exécuter ni l'opérateur ni ceux en amont. */
+	if (collection != nullptr) {
+		auto avertissements = std::vector<std::string>{};
+
+		if (cache.cherche(empreintes.empreinte, empreintes.verification, *collection, avertissements)) {
+			for (const auto &avertissement : avertissements) {
+				operateur->ajoute_avertissement(avertissement);
+			}
+
+			const auto delta = (tbb::tick_count::now() - t0).seconds();
+
+			operateur->besoin_execution(false);
+			operateur->enregistre_succes_cache(delta);
+			return;
+		}
+	}
+
 	try {
 		operateur->execute(contexte, temps);
 	}
@@ -49,26 +169,37 @@ void execute_operateur(Operateur *operateur, const Context &contexte, double tem
 		operateur->ajoute_avertissement(e.what());
 	}
 
-	auto t1 = tbb::tick_count::now();
-	auto delta = (t1 - t0).seconds();
-
-	operateur->incremente_nombre_execution();
-
-	operateur->temps_agrege(delta);
-
-	/* Pour calculer le temps d'exécution de l'opérateur, on soustrait le temps
-	 * d'exécution agrégé des noeuds en amont de celui du neoud courant. */
-	auto temps_agrege_parent = 0.0;
+	operateur->besoin_execution(false);
 
-	for (int i = 0; i < operateur->entrees(); ++i) {
-		auto entree = operateur->entree(i);
+	/* Le résultat est incomplet : il n'est pas gardé, et l'opérateur sera
+	 * exécuté à nouveau par la prochaine évaluation. L'indicateur est remis
+	 * après avoir été effacé, pour ne pas perdre une modification faite
+	 * pendant l'exécution. */
+	if (evaluation_annulee(contexte)) {
+		operateur->besoin_execution(true);
+		return;
+	}
 
-		temps_agrege_parent += entree->temps_execution_parent();
+	/* L'opérateur peut avoir remplacé sa collection. */
+	if (operateur->collection() != nullptr) {
+		cache.ajoute(empreintes.empreinte, empreintes.verification, *operateur->collection(), operateur->avertissements());
 	}
 
-	operateur->temps_execution(delta - temps_agrege_parent);
+	auto t1 = tbb::tick_count::now();
+	auto delta = (t1 - t0).seconds();
+
+	/* Pour calculer le temps d'exécution de l'opérateur, on soustrait le temps
+	 * passé dans ses entrées. Soustraire le temps agrégé des noeuds en amont
+	 * donnait des temps négatifs quand les branches sont exécutées en
+	 * parallèle, ou quand leur résultat est repris d'un tampon. */
+	const auto temps_exclusif = std::max(0.0, delta - mesure_amont.temps);
 
-	operateur->besoin_execution(false);
+	operateur->enregistre_execution(temps_exclusif,
+	                                delta,
+	                                mesure_amont.points,
+	                                mesure_amont.primitives,
+	                                octets_dupliques_thread(),
+	                                operateur->collection());
 }
 
 /* ************************************************************************** */
@@ -84,22 +215,47 @@ PrimitiveCollection *EntreeOperateur::requiers_collection(PrimitiveCollection *c
 	}
 
 	auto operateur = m_prise->lien->parent->operateur();
+	const auto debut = tbb::tick_count::now();
+
+	/* Une autre branche peut requérir le même opérateur en même temps : la
+	 * première l'exécute, les autres attendent puis trouvent son résultat en
+	 * tampon. Le verrou couvre aussi le transfert de la collection, qui décide
+	 * si le résultat est gardé en tampon. */
+	std::lock_guard<std::mutex> verrou(operateur->m_verrou_execution);
 
-	execute_operateur(operateur, contexte, temps);
+	/* En attendant ses propres tâches, ce thread ne doit pas en prendre une
+	 * autre qui demanderait un verrou qu'il détient déjà. */
+	tbb::this_task_arena::isolate([&]()
+	{
+		execute_operateur(operateur, contexte, temps);
+	});
 
 	auto collection_operateur = operateur->collection();
 
+	/* L'attente et l'exécution de l'opérateur en amont ne comptent pas dans le
+	 * temps de l'opérateur qui requiert la collection. */
+	mesure_amont.temps += (tbb::tick_count::now() - debut).seconds();
+
 	if (collection_operateur == nullptr) {
 		return nullptr;
 	}
 
+	for (const auto prim : collection_operateur->primitives()) {
+		if (prim != nullptr) {
+			mesure_amont.points += prim->nombre_points();
+			mesure_amont.primitives += 1;
+		}
+	}
+
 	if (collection == nullptr) {
 		return collection_operateur;
 	}
 
-	/* S'il y a plusieurs liens, copie la collection afin d'éviter tout conflit. */
+	/* S'il y a plusieurs liens, copie la collection afin d'éviter tout conflit.
+	 * Les tampons des primitives copiées restent partagés avec ceux de
+	 * l'opérateur jusqu'à ce qu'une des branches les modifie. */
 	if (m_prise->lien->liens.size() > 1) {
-		collection_operateur->copy_collection(*collection);
+		collection->copy_collection(*collection_operateur);
 		operateur->a_tampon(true);
 	}
 	else {
@@ -125,9 +281,24 @@ bool EntreeOperateur::est_connectee() const
 	return (m_prise != nullptr && m_prise->lien != nullptr);
 }
 
+uint64_t EntreeOperateur::empreinte(bool configuration) const
+{
+	return empreintes(configuration).empreinte;
+}
+
+EmpreintesOperateur EntreeOperateur::empreintes(bool configuration) const
+{
+	if (!est_connectee()) {
+		return EmpreintesOperateur{};
+	}
+
+	return m_prise->lien->parent->operateur()->calcule_empreinte(configuration);
+}
+
 /* ************************************************************************** */
 
-Operateur::Operateur(Noeud *noeud, const Context &contexte)
+Operateur::Operateur(Noeud *noeud, const Context &contexte, resultat_operateur resultat)
+    : m_resultat(resultat)
 {
 	noeud->operateur(this);
 	m_collection = new PrimitiveCollection(contexte.primitive_factory);
@@ -143,6 +314,140 @@ type_operateur Operateur::type() const
 	return type_operateur::STATIC;
 }
 
+bool Operateur::resultat_deterministe() const
+{
+	return m_resultat == RESULTAT_DETERMINISTE;
+}
+
+uint64_t Operateur::empreinte()
+{
+	return calcule_empreinte(false).empreinte;
+}
+
+uint64_t Operateur::empreinte_configuration()
+{
+	return calcule_empreinte(true).empreinte;
+}
+
+void Operateur::requiers_collections_paralleles(
+		PrimitiveCollection **collections,
+		size_t nombre,
+		const Context &contexte,
+		double temps)
+{
+	auto mesures = std::vector<MesureAmont>(nombre);
+	const auto debut = tbb::tick_count::now();
+	const auto memoire = memoire_empreintes;
+
+	tbb::task_group taches;
+
+	for (size_t i = 0; i < nombre; ++i) {
+		taches.run([this, collections, i, &contexte, temps, &mesures, memoire]()
+		{
+			/* La branche peut être exécutée par ce thread, ou par un thread
+			 * occupé à autre chose : sa mesure est faite à part. */
+			PorteeMesureAmont portee_mesure;
+			PartageMemoireEmpreintes partage_empreintes(memoire);
+			collections[i] = entree(i)->requiers_collection(collections[i], contexte, temps);
+			mesures[i] = mesure_amont;
+		});
+	}
+
+	taches.wait();
+
+	/* Les branches sont exécutées en même temps : c'est la durée de leur
+	 * ensemble qui est passée en amont, pas la somme de leurs durées. */
+	mesure_amont.temps += (tbb::tick_count::now() - debut).seconds();
+
+	for (const auto &mesure : mesures) {
+		mesure_amont.points += mesure.points;
+		mesure_amont.primitives += mesure.primitives;
+	}
+}
+
+EmpreintesOperateur Operateur::calcule_empreinte(bool configuration)
+{
+	const auto memoire = memoire_empreintes;
+
+	if (memoire == nullptr) {
+		return hache(configuration);
+	}
+
+	auto &empreintes = memoire->empreintes[configuration];
+
+	{
+		std::unique_lock<std::mutex> verrou(memoire->verrou);
+		const auto iter = empreintes.find(this);
+
+		if (iter != empreintes.end()) {
+			return iter->second;
+		}
+	}
+
+	/* Le verrou n'est pas gardé pendant le calcul, qui demande les empreintes
+	 * en amont : deux branches parallèles peuvent calculer la même empreinte,
+	 * avec le même résultat. */
+	const auto resultat = hache(configuration);
+
+	std::unique_lock<std::mutex> verrou(memoire->verrou);
+	empreintes[this] = resultat;
+
+	return resultat;
+}
+
+EmpreintesOperateur Operateur::hache(bool configuration)
+{
+	const auto invalides = EmpreintesOperateur{};
+
+	if (!resultat_deterministe()) {
+		return invalides;
+	}
+
+	if (!configuration) {
+		if (type() == type_operateur::DYNAMIQUE) {
+			return invalides;
+		}
+
+		/* Le contenu des fichiers peut changer sans que le chemin ne change,
+		 * et un opérateur écrivant un fichier doit être exécuté pour
+		 * l'écrire. */
+		for (const Property &prop : props()) {
+			if (prop.type == property_type::prop_input_file || prop.type == property_type::prop_output_file) {
+				return invalides;
+			}
+		}
+	}
+
+	const auto nom_operateur = std::string(nom());
+
+	auto resultat = EmpreintesOperateur{};
+	resultat.empreinte = combine_empreinte(EMPREINTE_INVALIDE, nom_operateur);
+	resultat.empreinte = combine_empreinte(resultat.empreinte, empreinte_proprietes());
+	resultat.verification = combine_empreinte(GRAINE_VERIFICATION, nom_operateur);
+	resultat.verification = combine_empreinte(resultat.verification, empreinte_proprietes(GRAINE_VERIFICATION));
+
+	/* Les empreintes en amont sont gardées par la PorteeEmpreintes courante,
+	 * s'il y en a une. */
+	for (const auto &entree : m_donnees_entree) {
+		if (!entree.est_connectee()) {
+			resultat.empreinte = combine_empreinte(resultat.empreinte, EMPREINTE_INVALIDE);
+			resultat.verification = combine_empreinte(resultat.verification, EMPREINTE_INVALIDE);
+			continue;
+		}
+
+		const auto amont = entree.empreintes(configuration);
+
+		if (amont.empreinte == EMPREINTE_INVALIDE) {
+			return invalides;
+		}
+
+		resultat.empreinte = combine_empreinte(resultat.empreinte, amont.empreinte);
+		resultat.verification = combine_empreinte(resultat.verification, amont.verification);
+	}
+
+	return resultat;
+}
+
 EntreeOperateur *Operateur::entree(size_t index)
 {
 	if (index >= m_donnees_entree.size()) {
@@ -202,44 +507,152 @@ void Operateur::besoin_execution(bool ouinon)
 
 double Operateur::temps_agrege() const
 {
-	return m_temps_agrege;
+	std::unique_lock<std::mutex> verrou(m_verrou_statistiques);
+	return m_statistiques.temps_agrege_dernier;
 }
 
-void Operateur::temps_agrege(double temps)
+double Operateur::temps_execution() const
 {
-	m_min_temps_agrege = std::min(m_temps_agrege, temps);
-	m_temps_agrege = temps;
+	std::unique_lock<std::mutex> verrou(m_verrou_statistiques);
+	return m_statistiques.temps_dernier;
 }
 
-double Operateur::temps_execution() const
+double Operateur::min_temps_agrege() const
 {
-	return m_temps_execution;
+	std::unique_lock<std::mutex> verrou(m_verrou_statistiques);
+	return m_statistiques.temps_agrege_min;
 }
 
-void Operateur::temps_execution(double temps)
+double Operateur::min_temps_execution() const
 {
-	m_min_temps_execution = std::min(m_temps_execution, temps);
-	m_temps_execution = temps;
+	std::unique_lock<std::mutex> verrou(m_verrou_statistiques);
+	return m_statistiques.temps_min;
 }
 
-double Operateur::min_temps_agrege() const
+int Operateur::nombre_executions() const
 {
-	return m_min_temps_agrege;
+	std::unique_lock<std::mutex> verrou(m_verrou_statistiques);
+	return static_cast<int>(m_statistiques.nombre_executions);
 }
 
-double Operateur::min_temps_execution() const
+/* Percentile par la méthode du rang le plus proche, les échantillons étant
+ * triés. */
+static double percentile(const std::vector<double> &echantillons, double p)
 {
-	return m_min_temps_execution;
+	const auto rang = static_cast<size_t>(std::ceil(p * static_cast<double>(echantillons.size())));
+	return echantillons[std::max(rang, 1ul) - 1];
 }
 
-int Operateur::nombre_executions() const
+StatistiquesOperateur Operateur::statistiques() const
+{
+	std::unique_lock<std::mutex> verrou(m_verrou_statistiques);
+
+	auto statistiques = m_statistiques;
+	auto echantillons = m_echantillons;
+
+	verrou.unlock();
+
+	if (!echantillons.empty()) {
+		std::sort(echantillons.begin(), echantillons.end());
+
+		statistiques.temps_median = percentile(echantillons, 0.5);
+		statistiques.temps_p95 = percentile(echantillons, 0.95);
+	}
+
+	return statistiques;
+}
+
+void Operateur::reinitialise_statistiques()
+{
+	std::unique_lock<std::mutex> verrou(m_verrou_statistiques);
+
+	m_statistiques = StatistiquesOperateur{};
+	m_echantillons.clear();
+	m_prochain_echantillon = 0;
+}
+
+/* Le temps agrégé est celui de toutes les évaluations, y compris celles dont
+ * le résultat est repris du cache. */
+static void enregistre_temps_agrege(StatistiquesOperateur &statistiques, double temps)
 {
-	return m_nombre_executions;
+	if (statistiques.nombre_executions + statistiques.succes_cache == 0) {
+		statistiques.temps_agrege_min = temps;
+	}
+	else {
+		statistiques.temps_agrege_min = std::min(statistiques.temps_agrege_min, temps);
+	}
+
+	statistiques.temps_agrege_dernier = temps;
+}
+
+void Operateur::enregistre_execution(
+		double temps,
+		double temps_agrege,
+		size_t points_entree,
+		size_t primitives_entree,
+		size_t octets_dupliques,
+		const PrimitiveCollection *sortie)
+{
+	auto points_sortie = 0ul;
+	auto primitives_sortie = 0ul;
+	auto octets = 0ul;
+
+	if (sortie != nullptr) {
+		for (const auto prim : sortie->primitives()) {
+			if (prim != nullptr) {
+				points_sortie += prim->nombre_points();
+				primitives_sortie += 1;
+			}
+		}
+
+		octets = sortie->taille_octets();
+	}
+
+	std::unique_lock<std::mutex> verrou(m_verrou_statistiques);
+
+	auto &statistiques = m_statistiques;
+
+	enregistre_temps_agrege(statistiques, temps_agrege);
+
+	if (statistiques.nombre_executions == 0) {
+		statistiques.temps_min = temps;
+		statistiques.temps_max = temps;
+	}
+	else {
+		statistiques.temps_min = std::min(statistiques.temps_min, temps);
+		statistiques.temps_max = std::max(statistiques.temps_max, temps);
+	}
+
+	statistiques.nombre_executions += 1;
+	statistiques.temps_dernier = temps;
+	statistiques.temps_total += temps;
+	statistiques.points_entree += points_entree;
+	statistiques.primitives_entree += primitives_entree;
+	statistiques.points_sortie += points_sortie;
+	statistiques.primitives_sortie += primitives_sortie;
+	statistiques.octets_sortie += octets;
+	statistiques.points_dernier = points_sortie;
+	statistiques.primitives_dernier = primitives_sortie;
+	statistiques.octets_dernier = octets;
+	statistiques.octets_max = std::max(statistiques.octets_max, octets);
+	statistiques.octets_dupliques += octets_dupliques;
+	statistiques.octets_dupliques_dernier = octets_dupliques;
+
+	if (m_echantillons.size() < StatistiquesOperateur::NOMBRE_ECHANTILLONS) {
+		m_echantillons.push_back(temps);
+	}
+	else {
+		m_echantillons[m_prochain_echantillon] = temps;
+	}
+
+	m_prochain_echantillon = (m_prochain_echantillon + 1) % StatistiquesOperateur::NOMBRE_ECHANTILLONS;
 }
 
-void Operateur::incremente_nombre_execution()
+void Operateur::enregistre_succes_cache(double temps_agrege)
 {
-	m_nombre_executions += 1;
+	std::unique_lock<std::mutex> verrou(m_verrou_statistiques);
+	enregistre_temps_agrege(m_statistiques, temps_agrege);
+	m_statistiques.succes_cache += 1;
 }
 
 void Operateur::ajoute_avertissement(const std::string &avertissement)
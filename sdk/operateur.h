@@ -25,9 +25,13 @@
 #pragma once
 
 #include "persona.h"
+#include "outils/empreinte.h"
 
+#include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 class Context;
 class PrimitiveCollection;
@@ -50,12 +54,26 @@ void nouvel_operateur_kamikaze(UsineOperateur *usine);
 
 /* ************************************************************************** */
 
+/**
+ * L'empreinte d'un opérateur, et une seconde empreinte des mêmes valeurs
+ * calculée depuis GRAINE_VERIFICATION, qui la vérifie dans le cache de
+ * résultats.
+ */
+struct EmpreintesOperateur {
+	uint64_t empreinte = EMPREINTE_INVALIDE;
+	uint64_t verification = EMPREINTE_INVALIDE;
+};
+
 /**
  * Enveloppe autour d'une PriseEntree pour restreindre l'interface de celle-ci.
  */
 class EntreeOperateur {
 	PriseEntree *m_prise = nullptr;
 
+	friend class Operateur;
+
+	EmpreintesOperateur empreintes(bool configuration) const;
+
 public:
 	EntreeOperateur() = default;
 
@@ -81,6 +99,13 @@ public:
 	 */
 	double temps_execution_parent() const;
 
+	/**
+	 * Retourne l'empreinte, ou l'empreinte de configuration si le paramètre
+	 * est vrai, de l'opérateur connecté à la prise, ou EMPREINTE_INVALIDE si
+	 * la prise n'est pas connectée.
+	 */
+	uint64_t empreinte(bool configuration = false) const;
+
 	/**
 	 * Retourne si oui ou non la prise est connectée.
 	 */
@@ -100,6 +125,92 @@ enum type_operateur {
 	DYNAMIQUE = 1,
 };
 
+/**
+ * Résultat d'un opérateur :
+ * - RESULTAT_VARIABLE : le résultat peut dépendre d'autre chose que des
+ *                       propriétés, des entrées et du temps, par exemple de
+ *                       fichiers, de la scène ou d'un état gardé d'une
+ *                       exécution à l'autre.
+ * - RESULTAT_DETERMINISTE : le résultat ne dépend que des propriétés, des
+ *                           entrées et, pour les opérateurs DYNAMIQUE, du
+ *                           temps ; il peut être gardé en cache.
+ */
+enum resultat_operateur {
+	RESULTAT_VARIABLE     = 0,
+	RESULTAT_DETERMINISTE = 1,
+};
+
+/* ************************************************************************** */
+
+/**
+ * Statistiques des exécutions d'un opérateur depuis leur dernière
+ * réinitialisation. Les temps sont exclusifs : ils ne comprennent pas
+ * l'exécution des opérateurs en amont. Les percentiles portent sur les
+ * NOMBRE_ECHANTILLONS dernières exécutions.
+ */
+struct StatistiquesOperateur {
+	static constexpr size_t NOMBRE_ECHANTILLONS = 256;
+
+	/* Exécutions de l'opérateur, et résultats repris du cache à la place. Les
+	 * exécutions annulées ne sont pas comptées. */
+	size_t nombre_executions = 0;
+	size_t succes_cache = 0;
+
+	/* Temps d'exécution en secondes. */
+	double temps_dernier = 0.0;
+	double temps_median = 0.0;
+	double temps_p95 = 0.0;
+	double temps_min = 0.0;
+	double temps_max = 0.0;
+	double temps_total = 0.0;
+
+	/* Temps d'exécution agrégés en secondes, qui comprennent les opérateurs
+	 * en amont, de la dernière évaluation et de la plus rapide ; les
+	 * résultats repris du cache sont comptés. */
+	double temps_agrege_dernier = 0.0;
+	double temps_agrege_min = 0.0;
+
+	/* Éléments reçus des entrées et produits, sur toutes les exécutions. */
+	size_t points_entree = 0;
+	size_t primitives_entree = 0;
+	size_t points_sortie = 0;
+	size_t primitives_sortie = 0;
+
+	/* Éléments produits par la dernière exécution. */
+	size_t points_dernier = 0;
+	size_t primitives_dernier = 0;
+
+	/* Taille des données produites, sur toutes les exécutions et pour la
+	 * dernière ; les tampons partagés avec les entrées sont comptés. */
+	size_t octets_sortie = 0;
+	size_t octets_dernier = 0;
+	size_t octets_max = 0;
+
+	/* Octets dupliqués par la copie sur écriture des tampons partagés avec
+	 * les entrées, le cache ou un précalcul, sur toutes les exécutions et pour
+	 * la dernière. */
+	size_t octets_dupliques = 0;
+	size_t octets_dupliques_dernier = 0;
+
+	/**
+	 * Retourne la part des évaluations servies par le cache.
+	 */
+	double taux_succes_cache() const
+	{
+		const auto total = succes_cache + nombre_executions;
+		return (total == 0) ? 0.0 : static_cast<double>(succes_cache) / static_cast<double>(total);
+	}
+
+	/**
+	 * Retourne le nombre d'éléments traités par seconde, par exemple
+	 * debit(points_sortie).
+	 */
+	double debit(size_t elements) const
+	{
+		return (temps_total > 0.0) ? static_cast<double>(elements) / temps_total : 0.0;
+	}
+};
+
 /**
  * L'Operateur enveloppe la logique de manipulation des Primitives. Chaque
  * opérateur se trouve dans son propre noeud. C'est à travers l'opérateur que le
@@ -113,19 +224,47 @@ class Operateur : public Persona {
 	int m_nombre_sorties = 0;
 	bool m_besoin_execution = true;
 	bool m_a_tampon = false;
+	resultat_operateur m_resultat = RESULTAT_VARIABLE;
 
 	std::vector<EntreeOperateur> m_donnees_entree{};
 	std::vector<std::string> m_avertissements{};
 
-	double m_temps_execution = 0.0;
-	double m_temps_agrege = 0.0;
-	double m_min_temps_execution = std::numeric_limits<double>::max();
-	double m_min_temps_agrege = std::numeric_limits<double>::max();
-
-	int m_nombre_executions = 0;
+	/* Statistiques, et temps des dernières exécutions dans un tampon
+	 * circulaire. Le verrou les protège des lectures faites par l'interface
+	 * pendant une évaluation. */
+	StatistiquesOperateur m_statistiques{};
+	std::vector<double> m_echantillons{};
+	size_t m_prochain_echantillon = 0;
+	mutable std::mutex m_verrou_statistiques{};
 
 	std::string m_chemin_icone{};
 
+	/* Pris par l'entrée qui exécute l'opérateur et récupère sa collection,
+	 * pour que les branches évaluées en parallèle n'exécutent qu'une fois un
+	 * opérateur qu'elles ont en commun. */
+	std::mutex m_verrou_execution{};
+
+	friend class EntreeOperateur;
+	friend void execute_operateur(Operateur *operateur, const Context &contexte, double temps);
+
+	/* Retourne les empreintes gardées par la PorteeEmpreintes courante, ou
+	 * les calcule avec hache(). */
+	EmpreintesOperateur calcule_empreinte(bool configuration);
+
+	EmpreintesOperateur hache(bool configuration);
+
+	/* Ajoute aux statistiques une exécution, avec son temps exclusif et son
+	 * temps agrégé, les éléments reçus des entrées et la collection produite,
+	 * ou un résultat repris du cache. */
+	void enregistre_execution(double temps,
+	                          double temps_agrege,
+	                          size_t points_entree,
+	                          size_t primitives_entree,
+	                          size_t octets_dupliques,
+	                          const PrimitiveCollection *sortie);
+
+	void enregistre_succes_cache(double temps_agrege);
+
 protected:
 	PrimitiveCollection *m_collection = nullptr;
 
@@ -135,8 +274,10 @@ public:
 
 	/**
 	 * Constuit un opérateur dont le noeud passé en paramètre en est le parent.
+	 * Les opérateurs dont le résultat est RESULTAT_DETERMINISTE le déclarent
+	 * ici pour que leurs résultats soient gardés en cache.
 	 */
-	Operateur(Noeud *noeud, const Context &contexte);
+	Operateur(Noeud *noeud, const Context &contexte, resultat_operateur resultat = RESULTAT_VARIABLE);
 
 	/**
 	 * Détruit l'opérateur. Le destruteur détruit également la collection
@@ -149,6 +290,38 @@ public:
 	 */
 	virtual type_operateur type() const;
 
+	/**
+	 * Retourne vrai si le résultat de cet opérateur ne dépend que de ses
+	 * propriétés, de ses entrées et, s'il est DYNAMIQUE, du temps : il peut
+	 * alors être gardé en cache. Retourne vrai si l'opérateur a été construit
+	 * avec RESULTAT_DETERMINISTE, et faux par défaut, car un opérateur peut
+	 * lire le temps, la scène ou tout autre état sans le déclarer. Un
+	 * opérateur gardant un état d'une exécution à l'autre, comme une
+	 * simulation, n'est pas déterministe.
+	 */
+	virtual bool resultat_deterministe() const;
+
+	/**
+	 * Retourne une empreinte de tout ce dont le résultat de cet opérateur
+	 * dépend : son nom, les valeurs de ses propriétés, et les empreintes des
+	 * opérateurs en amont. Deux évaluations avec la même empreinte donnent la
+	 * même collection, qui peut donc être reprise du cache de résultats.
+	 *
+	 * Retourne EMPREINTE_INVALIDE si le résultat ne dépend pas que de ces
+	 * informations : opérateurs dynamiques, opérateurs lisant ou écrivant des
+	 * fichiers, opérateurs dont le résultat n'est pas déclaré déterministe, et
+	 * tout ce qui se trouve en aval de ceux-ci.
+	 */
+	uint64_t empreinte();
+
+	/**
+	 * Retourne une empreinte des mêmes informations que empreinte(), mais
+	 * qui est toujours valide : elle identifie la configuration du graphe en
+	 * amont de cet opérateur, sans garantir que le résultat n'en dépende que
+	 * (il peut par exemple dépendre du temps).
+	 */
+	uint64_t empreinte_configuration();
+
 	/**
 	 * Retourne l'entrée se trouvent à l'index donné en paramètre.
 	 */
@@ -194,6 +367,19 @@ public:
 	 */
 	virtual void execute(const Context &contexte, double temps) = 0;
 
+	/**
+	 * Requiers en parallèle les collections des nombre premières entrées :
+	 * les branches en amont de celles-ci sont exécutées en même temps, et un
+	 * opérateur commun à plusieurs branches n'est exécuté qu'une fois.
+	 * collections[i] est passée à requiers_collection() de l'entrée i, et
+	 * remplacée par la collection retournée.
+	 */
+	void requiers_collections_paralleles(
+			PrimitiveCollection **collections,
+			size_t nombre,
+			const Context &contexte,
+			double temps);
+
 	/**
 	 * Retourne la collection de cet opérateur.
 	 */
@@ -211,48 +397,47 @@ public:
 	void besoin_execution(bool ouinon);
 
 	/**
-	 * Retourne le temps d'exécution agrégé de l'opérateur. Le temps d'exécution
-	 * agrégé est le temps d'exécution du graphe depuis la racine jusqu'au noeud
-	 * parent de l'opérateur.
+	 * Retourne le temps d'exécution agrégé de la dernière évaluation de
+	 * l'opérateur, c'est-à-dire le temps d'exécution du graphe depuis la
+	 * racine jusqu'au noeud parent de l'opérateur : voir
+	 * StatistiquesOperateur::temps_agrege_dernier.
 	 */
 	double temps_agrege() const;
 
 	/**
-	 * Met à jour le temps d'exécution agrégé de l'opérateur selon la valeur
-	 * passée en paramètre.
-	 */
-	void temps_agrege(double temps);
-
-	/**
-	 * Retourne le temps d'exécution de l'opérateur.
+	 * Retourne le temps d'exécution de la dernière exécution de l'opérateur :
+	 * voir StatistiquesOperateur::temps_dernier.
 	 */
 	double temps_execution() const;
 
 	/**
-	 * Met à jour le temps d'exécution de l'opérateur selon la valeur passée en
-	 * paramètre.
-	 */
-	void temps_execution(double temps);
-
-	/**
-	 * Retourne le temps d'exécution agrégé minimumde l'opérateur.
+	 * Retourne le temps d'exécution agrégé minimum de l'opérateur : voir
+	 * StatistiquesOperateur::temps_agrege_min.
 	 */
 	double min_temps_agrege() const;
 
 	/**
-	 * Retourne le temps d'exécution minimum de l'opérateur.
+	 * Retourne le temps d'exécution minimum de l'opérateur : voir
+	 * StatistiquesOperateur::temps_min.
 	 */
 	double min_temps_execution() const;
 
 	/**
-	 * Retourne le nombre de fois que l'opérateur a été exécuté.
+	 * Retourne le nombre de fois que l'opérateur a été exécuté : voir
+	 * StatistiquesOperateur::nombre_executions.
 	 */
 	int nombre_executions() const;
 
 	/**
-	 * Incrémente de 1 le nombre de fois que l'opérateur a été exécuté.
+	 * Retourne les statistiques des exécutions de l'opérateur.
 	 */
-	void incremente_nombre_execution();
+	StatistiquesOperateur statistiques() const;
+
+	/**
+	 * Remet les statistiques à zéro, par exemple au début d'une session de
+	 * mesures.
+	 */
+	void reinitialise_statistiques();
 
 	/**
 	 * Ajoute un avertissement à la liste d'avertissements de cet opérateur.
@@ -314,6 +499,32 @@ void execute_operateur(Operateur *operateur, const Context &contexte, double tem
 
 /* ************************************************************************** */
 
+struct MemoireEmpreintes;
+
+/**
+ * Garde les empreintes des opérateurs calculées pendant sa portée, pour que
+ * chacune ne soit calculée qu'une fois par évaluation, et non par chaque
+ * opérateur en aval : sans elle, l'empreinte d'un opérateur parcourt tout le
+ * graphe en amont, chaque chemin d'un losange étant parcouru à part.
+ *
+ * Les propriétés et les liens des graphes ne doivent pas changer pendant la
+ * portée. execute_operateur() en ouvre une si aucune ne l'est déjà sur le
+ * thread ; une portée ouverte alors qu'une autre l'est utilise celle-ci, y
+ * compris sur les threads exécutant les branches parallèles.
+ */
+class PorteeEmpreintes {
+	std::unique_ptr<MemoireEmpreintes> m_memoire;
+
+public:
+	PorteeEmpreintes();
+	~PorteeEmpreintes();
+
+	PorteeEmpreintes(const PorteeEmpreintes &) = delete;
+	PorteeEmpreintes &operator=(const PorteeEmpreintes &) = delete;
+};
+
+/* ************************************************************************** */
+
 /**
  * Cette classe contient les informations pour un opérateur.
  */
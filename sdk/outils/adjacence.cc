@@ -0,0 +1,230 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "adjacence.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <tbb/parallel_sort.h>
+
+#include "../geomlists.h"
+
+#include "parallélisme.h"
+
+using plage = tbb::blocked_range<size_t>;
+
+/* Clé d'une arête non-orientée, le plus petit index dans les bits de poids
+ * fort, et identifiant de la demi-arête qui la parcourt. */
+struct CleArete {
+	uint64_t cle;
+	unsigned int demi_arete;
+
+	bool operator<(const CleArete &autre) const
+	{
+		return (cle < autre.cle) || (cle == autre.cle && demi_arete < autre.demi_arete);
+	}
+};
+
+static void construit_sommets_polygones(
+		const PolygonList &polygones,
+		size_t nombre_points,
+		AdjacenceMaillage &adjacence)
+{
+	/* Première passe : compte le nombre de polygones par sommet. Les index
+	 * hors de [0, nombre_points[ sont ignorés, dans les deux passes, plutôt
+	 * que d'écrire hors des compteurs. */
+	auto compteurs = std::unique_ptr<std::atomic<unsigned int>[]>(
+	                     new std::atomic<unsigned int>[nombre_points + 1]);
+
+	parallel_for_light_items(plage(0, nombre_points + 1), [&](const plage &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			compteurs[i].store(0, std::memory_order_relaxed);
+		}
+	});
+
+	parallel_for_light_items(plage(0, polygones.size()), [&](const plage &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			const auto sommets = polygones.sommets(i);
+
+			for (size_t j = 0, je = polygones.nombre_sommets(i); j < je; ++j) {
+				assert(sommets[j] < nombre_points);
+
+				if (sommets[j] >= nombre_points) {
+					continue;
+				}
+
+				compteurs[sommets[j]].fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	});
+
+	auto &debuts = adjacence.debuts_sommets;
+	debuts.resize(nombre_points + 1);
+
+	parallel_for_light_items(plage(0, nombre_points + 1), [&](const plage &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			debuts[i] = compteurs[i].load(std::memory_order_relaxed);
+		}
+	});
+
+	somme_prefixe_exclusive(debuts.data(), debuts.size());
+
+	/* Deuxième passe : range les polygones à la place de chaque sommet. */
+	parallel_for_light_items(plage(0, nombre_points), [&](const plage &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			compteurs[i].store(debuts[i], std::memory_order_relaxed);
+		}
+	});
+
+	auto &polygones_sommets = adjacence.polygones_sommets;
+	polygones_sommets.resize(debuts.back());
+
+	parallel_for_light_items(plage(0, polygones.size()), [&](const plage &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			const auto sommets = polygones.sommets(i);
+
+			for (size_t j = 0, je = polygones.nombre_sommets(i); j < je; ++j) {
+				if (sommets[j] >= nombre_points) {
+					continue;
+				}
+
+				const auto place = compteurs[sommets[j]].fetch_add(1, std::memory_order_relaxed);
+				polygones_sommets[place] = static_cast<unsigned int>(i);
+			}
+		}
+	});
+
+	/* L'ordre de rangement dépend de l'ordonnancement des threads : trie les
+	 * polygones de chaque sommet pour avoir un résultat déterministe. */
+	parallel_for_light_items(plage(0, nombre_points), [&](const plage &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			std::sort(polygones_sommets.data() + debuts[i], polygones_sommets.data() + debuts[i + 1]);
+		}
+	});
+}
+
+static void construit_aretes(
+		const PolygonList &polygones,
+		AdjacenceMaillage &adjacence)
+{
+	const auto nombre_demi_aretes = polygones.nombre_index();
+
+	auto &polygones_demi_aretes = adjacence.polygones_demi_aretes;
+	polygones_demi_aretes.resize(nombre_demi_aretes);
+
+	auto cles = std::vector<CleArete>(nombre_demi_aretes);
+
+	parallel_for_light_items(plage(0, polygones.size()), [&](const plage &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			const auto debut = polygones.debut(i);
+			const auto sommets = polygones.sommets(i);
+			const auto nombre_sommets = polygones.nombre_sommets(i);
+
+			for (size_t j = 0; j < nombre_sommets; ++j) {
+				const auto v0 = static_cast<uint64_t>(sommets[j]);
+				const auto v1 = static_cast<uint64_t>(sommets[(j + 1) % nombre_sommets]);
+				const auto demi_arete = debut + j;
+
+				cles[demi_arete].cle = (std::min(v0, v1) << 32) | std::max(v0, v1);
+				cles[demi_arete].demi_arete = static_cast<unsigned int>(demi_arete);
+				polygones_demi_aretes[demi_arete] = static_cast<unsigned int>(i);
+			}
+		}
+	});
+
+	tbb::parallel_sort(cles.begin(), cles.end());
+
+	/* Les demi-arêtes d'une même arête sont maintenant contiguës : marque le
+	 * début de chaque groupe, et numérote les arêtes par somme préfixe. */
+	auto numeros = std::vector<unsigned int>(nombre_demi_aretes + 1, 0);
+
+	parallel_for_light_items(plage(0, nombre_demi_aretes), [&](const plage &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			numeros[i] = (i == 0 || cles[i].cle != cles[i - 1].cle) ? 1 : 0;
+		}
+	});
+
+	const auto nombre_aretes = somme_prefixe_exclusive(numeros.data(), numeros.size());
+
+	auto &aretes = adjacence.aretes;
+	auto &aretes_demi_aretes = adjacence.aretes_demi_aretes;
+	auto &opposees = adjacence.demi_aretes_opposees;
+
+	aretes.resize(nombre_aretes);
+	aretes_demi_aretes.resize(nombre_demi_aretes);
+	opposees.resize(nombre_demi_aretes);
+
+	parallel_for_light_items(plage(0, nombre_demi_aretes), [&](const plage &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			const auto debut_groupe = (i == 0 || cles[i].cle != cles[i - 1].cle);
+			const auto numero = numeros[i] - (debut_groupe ? 0 : 1);
+			const auto demi_arete = cles[i].demi_arete;
+
+			if (debut_groupe) {
+				aretes[numero] = glm::uvec2(cles[i].cle >> 32, cles[i].cle & 0xffffffff);
+			}
+
+			aretes_demi_aretes[demi_arete] = numero;
+
+			/* Seules les arêtes partagées par exactement deux demi-arêtes ont
+			 * une opposée. */
+			auto opposee = INVALID_INDEX;
+
+			if (debut_groupe) {
+				if (i + 1 < nombre_demi_aretes && cles[i + 1].cle == cles[i].cle
+				    && (i + 2 >= nombre_demi_aretes || cles[i + 2].cle != cles[i].cle))
+				{
+					opposee = cles[i + 1].demi_arete;
+				}
+			}
+			else if ((i < 2 || cles[i - 2].cle != cles[i].cle)
+			         && (i + 1 >= nombre_demi_aretes || cles[i + 1].cle != cles[i].cle))
+			{
+				opposee = cles[i - 1].demi_arete;
+			}
+
+			opposees[demi_arete] = opposee;
+		}
+	});
+}
+
+void construit_adjacence(
+		const PolygonList &polygones,
+		size_t nombre_points,
+		AdjacenceMaillage &adjacence)
+{
+	construit_sommets_polygones(polygones, nombre_points, adjacence);
+	construit_aretes(polygones, adjacence);
+}
@@ -0,0 +1,76 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+class PolygonList;
+
+/**
+ * Informations de connectivité d'un maillage.
+ *
+ * Les demi-arêtes sont identifiées par la position de leur sommet de départ
+ * dans les index de la PolygonList : la demi-arête c du polygone p va du
+ * sommet index[c] au sommet suivant de p.
+ */
+struct AdjacenceMaillage {
+	/* Sommet → polygones, en lignes compressées : les polygones adjacents au
+	 * sommet v sont polygones_sommets[debuts_sommets[v], debuts_sommets[v + 1][,
+	 * par ordre croissant. */
+	std::vector<unsigned int> debuts_sommets{};
+	std::vector<unsigned int> polygones_sommets{};
+
+	/* Arêtes uniques, le plus petit index en premier, triées. */
+	std::vector<glm::uvec2> aretes{};
+
+	/* Pour chaque demi-arête : le polygone auquel elle appartient, l'arête
+	 * qu'elle parcourt, et sa demi-arête opposée (INVALID_INDEX sur un bord
+	 * ou une arête non-manifold). */
+	std::vector<unsigned int> polygones_demi_aretes{};
+	std::vector<unsigned int> aretes_demi_aretes{};
+	std::vector<unsigned int> demi_aretes_opposees{};
+
+	size_t nombre_polygones(size_t sommet) const
+	{
+		return debuts_sommets[sommet + 1] - debuts_sommets[sommet];
+	}
+
+	const unsigned int *polygones(size_t sommet) const
+	{
+		/* Pas d'operator[] : le début peut être la fin du tableau. */
+		return polygones_sommets.data() + debuts_sommets[sommet];
+	}
+};
+
+/**
+ * Construit, en parallèle, l'adjacence des polygones dont les sommets sont
+ * dans [0, nombre_points[. Un sommet hors de cet intervalle est une erreur ;
+ * il n'est alors associé à aucun polygone.
+ */
+void construit_adjacence(
+		const PolygonList &polygones,
+		size_t nombre_points,
+		AdjacenceMaillage &adjacence);
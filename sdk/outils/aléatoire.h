@@ -0,0 +1,104 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Générateur de nombres aléatoires sans état, basé sur un compteur : chaque
+ * valeur est un hachage de la graine, de l'index de l'élément et d'un numéro
+ * de flux (par exemple la composante d'un vecteur).
+ *
+ * Contrairement à un générateur séquentiel comme std::mt19937, la valeur d'un
+ * élément ne dépend pas du nombre de valeurs tirées avant lui : les éléments
+ * peuvent être traités en parallèle, dans n'importe quel ordre, et ajouter
+ * des éléments en amont ne change pas les valeurs des premiers.
+ */
+class GenerateurCompteur {
+	uint64_t m_graine;
+
+	/* Finaliseur de SplitMix64 (variante 13 de Stafford). */
+	static constexpr uint64_t melange(uint64_t x)
+	{
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+
+public:
+	explicit constexpr GenerateurCompteur(uint64_t graine)
+	    : m_graine(melange(graine + 0x9e3779b97f4a7c15ull))
+	{}
+
+	/**
+	 * Retourne un générateur indépendant de celui-ci pour un sous-ensemble
+	 * d'éléments, par exemple les points générés sur le polygone n.
+	 */
+	constexpr GenerateurCompteur derive(uint64_t n) const
+	{
+		return GenerateurCompteur(m_graine ^ melange(n + 0x632be59bd9b4e019ull));
+	}
+
+	/**
+	 * Retourne un entier aléatoire sur 32 bits.
+	 */
+	constexpr uint32_t entier(uint64_t index, uint32_t flux = 0) const
+	{
+		const auto h = melange(m_graine ^ (static_cast<uint64_t>(flux) * 0xd1b54a32d192ed03ull));
+		return static_cast<uint32_t>(melange(h + index * 0x9e3779b97f4a7c15ull) >> 32);
+	}
+
+	/**
+	 * Retourne un nombre aléatoire uniforme dans [0, 1[.
+	 */
+	constexpr float uniforme(uint64_t index, uint32_t flux = 0) const
+	{
+		/* Les 24 bits de poids fort tiennent exactement dans la mantisse. */
+		return static_cast<float>(entier(index, flux) >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/**
+	 * Retourne un nombre aléatoire uniforme dans [min, max[.
+	 */
+	constexpr float uniforme(uint64_t index, uint32_t flux, float min, float max) const
+	{
+		return min + (max - min) * uniforme(index, flux);
+	}
+
+	/**
+	 * Retourne un nombre aléatoire suivant une loi normale, par la méthode de
+	 * Box-Muller. Utilise les flux 2 * flux et 2 * flux + 1.
+	 */
+	float normale(uint64_t index, uint32_t flux, float moyenne, float ecart_type) const
+	{
+		/* u1 est dans ]0, 1] pour que le logarithme soit défini. */
+		const auto u1 = 1.0f - uniforme(index, 2 * flux);
+		const auto u2 = uniforme(index, 2 * flux + 1);
+
+		const auto rayon = std::sqrt(-2.0f * std::log(u1));
+		return moyenne + ecart_type * rayon * std::cos(2.0f * static_cast<float>(M_PI) * u2);
+	}
+};
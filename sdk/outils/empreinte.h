@@ -0,0 +1,92 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * Outils pour calculer des empreintes (hachages non cryptographiques sur 64
+ * bits) de valeurs, afin de reconnaître des configurations déjà vues.
+ *
+ * Les empreintes ne dépendent que des valeurs hachées, jamais d'adresses en
+ * mémoire : elles sont les mêmes d'une exécution à l'autre.
+ */
+
+/* Empreinte réservée pour dire que la valeur n'a pas d'empreinte. */
+static constexpr uint64_t EMPREINTE_INVALIDE = 0;
+
+/* Graine d'une seconde empreinte des mêmes valeurs, indépendante de la
+ * première : ensemble, elles font une empreinte sur 128 bits pour les clés
+ * dont une collision rendrait silencieusement une autre valeur, comme celles
+ * de CacheResultats. */
+static constexpr uint64_t GRAINE_VERIFICATION = 0x6a09e667f3bcc909ull;
+
+/**
+ * Combine une empreinte avec une valeur, l'ordre des combinaisons compte.
+ */
+inline uint64_t combine_empreinte(uint64_t empreinte, uint64_t valeur)
+{
+	/* Finaliseur de SplitMix64 appliqué à la somme, comme pour
+	 * GenerateurCompteur. */
+	auto x = empreinte + 0x9e3779b97f4a7c15ull + valeur * 0xd1b54a32d192ed03ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	x ^= (x >> 31);
+
+	/* Ne retourne jamais l'empreinte invalide. */
+	return (x == EMPREINTE_INVALIDE) ? 1 : x;
+}
+
+inline uint64_t combine_empreinte(uint64_t empreinte, const void *donnees, size_t taille)
+{
+	auto octets = static_cast<const unsigned char *>(donnees);
+
+	/* Hache par mots de 8 octets, puis les octets restants. */
+	for (; taille >= 8; taille -= 8, octets += 8) {
+		uint64_t mot;
+		std::memcpy(&mot, octets, 8);
+		empreinte = combine_empreinte(empreinte, mot);
+	}
+
+	uint64_t reste = 0;
+	std::memcpy(&reste, octets, taille);
+
+	return combine_empreinte(empreinte, reste ^ (static_cast<uint64_t>(taille) << 56));
+}
+
+inline uint64_t combine_empreinte(uint64_t empreinte, const std::string &chaine)
+{
+	return combine_empreinte(empreinte, chaine.data(), chaine.size());
+}
+
+inline uint64_t combine_empreinte(uint64_t empreinte, float valeur)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &valeur, sizeof(float));
+	return combine_empreinte(empreinte, static_cast<uint64_t>(bits));
+}
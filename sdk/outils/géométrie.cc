@@ -24,49 +24,217 @@
 
 #include "géométrie.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tbb/parallel_reduce.h>
+
 #include "../attribute.h"
 #include "../geomlists.h"
 
+#include "adjacence.h"
 #include "parallélisme.h"
 
+glm::vec3 normale_polygone(
+		const PointList &points,
+		const unsigned int *sommets,
+		size_t nombre_sommets)
+{
+	/* Les positions sont prises relativement au premier sommet, pour ne pas
+	 * perdre de précision loin de l'origine. */
+	const auto v0 = points[sommets[0]];
+	auto normale = glm::vec3(0.0f);
+
+	for (size_t j = 1; j + 1 < nombre_sommets; ++j) {
+		normale += glm::cross(points[sommets[j]] - v0, points[sommets[j + 1]] - v0);
+	}
+
+	return normale;
+}
+
+/* Angle du polygone au coin c, entre les arêtes vers le sommet précédent et
+ * le sommet suivant. */
+static float angle_coin(
+		const PointList &points,
+		const unsigned int *sommets,
+		size_t nombre_sommets,
+		size_t c)
+{
+	const auto p = points[sommets[c]];
+	const auto precedent = points[sommets[(c + nombre_sommets - 1) % nombre_sommets]] - p;
+	const auto suivant = points[sommets[(c + 1) % nombre_sommets]] - p;
+
+	const auto longueurs = glm::length(precedent) * glm::length(suivant);
+
+	if (longueurs == 0.0f) {
+		return 0.0f;
+	}
+
+	return std::acos(std::clamp(glm::dot(precedent, suivant) / longueurs, -1.0f, 1.0f));
+}
+
 void calcule_normales(
 		const PointList &points,
 		const PolygonList &polygones,
+		const AdjacenceMaillage &adjacence,
 		Attribute &normales,
-		bool flip)
+		bool flip,
+		ponderation_normale ponderation)
 {
+	/* Première passe : une normale par polygone, déjà normalisée pour la
+	 * pondération par angle. */
+	std::vector<glm::vec3> normales_polygones(polygones.size());
+
 	parallel_for(tbb::blocked_range<size_t>(0, polygones.size()),
 				 [&](const tbb::blocked_range<size_t> &r)
 	{
 		for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
-			const auto &quad = polygones[i];
+			auto normale = normale_polygone(points, polygones.sommets(i), polygones.nombre_sommets(i));
+
+			if (ponderation == PONDERATION_ANGLE) {
+				const auto longueur = glm::length(normale);
+				normale = (longueur > 0.0f) ? normale / longueur : glm::vec3(0.0f);
+			}
+
+			normales_polygones[i] = normale;
+		}
+	});
+
+	/* Seconde passe : chaque point rassemble les normales de ses polygones,
+	 * triés par index, puis normalise le résultat. */
+	auto vue_normales = normales.view<glm::vec3>();
+	const auto signe = flip ? 1.0f : -1.0f;
+
+	parallel_for(tbb::blocked_range<size_t>(0, vue_normales.size()),
+				 [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
+			const auto polygones_point = adjacence.polygones(i);
+			auto normale = glm::vec3(0.0f);
+
+			for (size_t j = 0, je = adjacence.nombre_polygones(i); j < je; ++j) {
+				const auto p = polygones_point[j];
+
+				if (ponderation == PONDERATION_AIRE) {
+					normale += normales_polygones[p];
+					continue;
+				}
+
+				const auto sommets = polygones.sommets(p);
+				const auto nombre_sommets = polygones.nombre_sommets(p);
+
+				for (size_t c = 0; c < nombre_sommets; ++c) {
+					if (sommets[c] == i) {
+						const auto angle = angle_coin(points, sommets, nombre_sommets, c);
+						normale += angle * normales_polygones[p];
+					}
+				}
+			}
+
+			const auto longueur = glm::length(normale);
+			vue_normales[i] = (longueur > 0.0f) ? (signe / longueur) * normale : glm::vec3(0.0f);
+		}
+	});
+}
 
-			const auto v0 = points[quad[0]];
-			const auto v1 = points[quad[1]];
-			const auto v2 = points[quad[2]];
+void triangule_polygones(
+		const PolygonList &polygones,
+		std::vector<unsigned int> &index)
+{
+	index.resize(polygones.nombre_triangles() * 3);
 
-			const auto normal = normale_triangle(v0, v1, v2);
+	/* Un polygone de n sommets donne n - 2 triangles, donc les triangles du
+	 * polygone i commencent à debut(i) - 2 * i : chaque polygone peut être
+	 * traité indépendamment, sans passe de préfixe. */
+	parallel_for_light_items(tbb::blocked_range<size_t>(0, polygones.size()),
+							 [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
+			const auto sommets = polygones.sommets(i);
+			const auto nombre_sommets = polygones.nombre_sommets(i);
 
-			normales.vec3(quad[0], normales.vec3(quad[0]) + normal);
-			normales.vec3(quad[1], normales.vec3(quad[1]) + normal);
-			normales.vec3(quad[2], normales.vec3(quad[2]) + normal);
+			auto sortie = &index[3 * (polygones.debut(i) - 2 * i)];
 
-			if (quad[3] != INVALID_INDEX) {
-				normales.vec3(quad[3], normales.vec3(quad[3]) + normal);
+			for (size_t j = 1; j + 1 < nombre_sommets; ++j) {
+				*sortie++ = sommets[0];
+				*sortie++ = sommets[j];
+				*sortie++ = sommets[j + 1];
 			}
 		}
 	});
+}
+
+/* Boîte englobante partielle, accumulée par chaque tâche de la réduction. */
+struct BoiteDelimitation {
+	float min[3] = {
+		std::numeric_limits<float>::infinity(),
+		std::numeric_limits<float>::infinity(),
+		std::numeric_limits<float>::infinity(),
+	};
 
-	if (flip) {
-		for (size_t i = 0, ie = points.size(); i < ie ; ++i) {
-			normales.vec3(i, glm::normalize(normales.vec3(i)));
+	float max[3] = {
+		-std::numeric_limits<float>::infinity(),
+		-std::numeric_limits<float>::infinity(),
+		-std::numeric_limits<float>::infinity(),
+	};
+
+	void fusionne(const BoiteDelimitation &autre)
+	{
+		for (int i = 0; i < 3; ++i) {
+			min[i] = std::min(min[i], autre.min[i]);
+			max[i] = std::max(max[i], autre.max[i]);
 		}
 	}
-	else {
-		for (size_t i = 0, ie = points.size(); i < ie ; ++i) {
-			normales.vec3(i, -glm::normalize(normales.vec3(i)));
-		}
+};
+
+/* La foulée est un paramètre de gabarit afin que le compilateur connaisse
+ * l'espacement des points et puisse vectoriser la boucle. */
+template <size_t foulee>
+static void boite_delimitation_voies(
+		const float *voies,
+		size_t debut,
+		size_t fin,
+		BoiteDelimitation &boite)
+{
+	auto min_x = boite.min[0], min_y = boite.min[1], min_z = boite.min[2];
+	auto max_x = boite.max[0], max_y = boite.max[1], max_z = boite.max[2];
+
+	for (size_t i = debut; i < fin; ++i) {
+		const auto x = voies[i * foulee + 0];
+		const auto y = voies[i * foulee + 1];
+		const auto z = voies[i * foulee + 2];
+
+		min_x = (x < min_x) ? x : min_x;
+		min_y = (y < min_y) ? y : min_y;
+		min_z = (z < min_z) ? z : min_z;
+
+		max_x = (x > max_x) ? x : max_x;
+		max_y = (y > max_y) ? y : max_y;
+		max_z = (z > max_z) ? z : max_z;
 	}
+
+	boite.min[0] = min_x; boite.min[1] = min_y; boite.min[2] = min_z;
+	boite.max[0] = max_x; boite.max[1] = max_y; boite.max[2] = max_z;
+}
+
+template <size_t foulee>
+static BoiteDelimitation reduis_boite_delimitation(const float *voies, size_t nombre_points)
+{
+	/* Le minimum et le maximum étant exacts, le découpage en tâches n'a pas
+	 * d'incidence sur le résultat. */
+	return tbb::parallel_reduce(
+				tbb::blocked_range<size_t>(0, nombre_points, 16384),
+				BoiteDelimitation(),
+				[&](const tbb::blocked_range<size_t> &r, BoiteDelimitation boite)
+	{
+		boite_delimitation_voies<foulee>(voies, r.begin(), r.end(), boite);
+		return boite;
+	},
+	[](BoiteDelimitation a, const BoiteDelimitation &b)
+	{
+		a.fusionne(b);
+		return a;
+	});
 }
 
 void calcule_boite_delimitation(
@@ -74,28 +242,18 @@ void calcule_boite_delimitation(
 		glm::vec3 &min,
 		glm::vec3 &max)
 {
-	for (size_t i = 0, ie = points.size(); i < ie; ++i) {
-		auto vert = points[i];
-
-		if (vert.x < min.x) {
-			min.x = vert.x;
-		}
-		else if (vert.x > max.x) {
-			max.x = vert.x;
-		}
+	if (points.size() == 0) {
+		min = glm::vec3(0.0f);
+		max = glm::vec3(0.0f);
+		return;
+	}
 
-		if (vert.y < min.y) {
-			min.y = vert.y;
-		}
-		else if (vert.y > max.y) {
-			max.y = vert.y;
-		}
+	/* Travaille directement sur les voies des points, afin que la boucle
+	 * puisse être vectorisée quand les points sont alignés. */
+	const auto boite = (points.foulee() == 4)
+	                   ? reduis_boite_delimitation<4>(points.voies(), points.size())
+	                   : reduis_boite_delimitation<3>(points.voies(), points.size());
 
-		if (vert.z < min.z) {
-			min.z = vert.z;
-		}
-		else if (vert.z > max.z) {
-			max.z = vert.z;
-		}
-	}
+	min = glm::vec3(boite.min[0], boite.min[1], boite.min[2]);
+	max = glm::vec3(boite.max[0], boite.max[1], boite.max[2]);
 }
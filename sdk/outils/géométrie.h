@@ -25,10 +25,12 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <vector>
 
 class Attribute;
 class PointList;
 class PolygonList;
+struct AdjacenceMaillage;
 
 inline glm::vec3 normale_triangle(
 		const glm::vec3 &v0,
@@ -41,12 +43,53 @@ inline glm::vec3 normale_triangle(
 	return glm::cross(n1, n0);
 }
 
+/**
+ * Normale d'un polygone quelconque par la méthode de Newell. Sa longueur est
+ * le double de l'aire du polygone ; pour un triangle elle est égale à
+ * normale_triangle().
+ */
+glm::vec3 normale_polygone(
+		const PointList &points,
+		const unsigned int *sommets,
+		size_t nombre_sommets);
+
+enum ponderation_normale {
+	/* Chaque polygone contribue proportionnellement à son aire. */
+	PONDERATION_AIRE = 0,
+	/* Chaque polygone contribue proportionnellement à l'angle qu'il forme au
+	 * sommet, ce qui ne dépend pas de la façon dont la surface est découpée. */
+	PONDERATION_ANGLE = 1,
+};
+
+/**
+ * Calcule les normales des points à partir de celles des polygones adjacents.
+ *
+ * Chaque point rassemble les contributions de ses polygones dans l'ordre de
+ * l'adjacence, sans écriture partagée entre threads : le résultat est le même
+ * quel que soit le nombre de threads. Les points n'appartenant à aucun
+ * polygone, ou dont les contributions s'annulent, ont une normale nulle.
+ */
 void calcule_normales(
 		const PointList &points,
 		const PolygonList &polygones,
+		const AdjacenceMaillage &adjacence,
 		Attribute &normales,
-		bool flip);
+		bool flip,
+		ponderation_normale ponderation = PONDERATION_AIRE);
 
+/**
+ * Triangule les polygones en éventail, en parallèle, et écrit les index des
+ * sommets des triangles bout à bout dans le vecteur.
+ */
+void triangule_polygones(
+		const PolygonList &polygones,
+		std::vector<unsigned int> &index);
+
+/**
+ * Calcule, en parallèle, la boîte délimitation des points. Les valeurs de min
+ * et max passées ne sont pas prises en compte ; pour une liste vide, la boîte
+ * est réduite à l'origine.
+ */
 void calcule_boite_delimitation(
 		const PointList &points,
 		glm::vec3 &min,
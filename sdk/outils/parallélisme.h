@@ -24,7 +24,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <tbb/parallel_for.h>
+#include <type_traits>
+#include <vector>
 
 /**
  * Wrappers around Intel's TBB utilities.
@@ -58,7 +61,8 @@ void parallel_for(RangeType &&range, OpType &&op, int grain_size = 1)
 		return;
 	}
 
-	tbb::parallel_for(RangeType(range.begin(), range.end(), grain_size), op);
+	using type_plage = std::decay_t<RangeType>;
+	tbb::parallel_for(type_plage(range.begin(), range.end(), grain_size), op);
 }
 
 template <typename RangeType, typename OpType>
@@ -72,3 +76,59 @@ inline void parallel_for_heavy_items(RangeType &&range, OpType &&op)
 {
 	parallel_for(range, op, 1);
 }
+
+/**
+ * Remplace chaque élément du tableau par la somme des éléments qui le
+ * précèdent (somme préfixe exclusive), et retourne la somme totale.
+ *
+ * Le découpage en blocs ne dépend pas du nombre de threads : pour des
+ * flottants, le résultat est le même d'une exécution à l'autre.
+ */
+template <typename T>
+T somme_prefixe_exclusive(T *donnees, size_t taille)
+{
+	constexpr size_t TAILLE_BLOC = 4096;
+	const auto nombre_blocs = (taille + TAILLE_BLOC - 1) / TAILLE_BLOC;
+
+	std::vector<T> sommes_blocs(nombre_blocs, T(0));
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, nombre_blocs),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto b = r.begin(), be = r.end(); b < be; ++b) {
+			const auto fin = std::min(taille, (b + 1) * TAILLE_BLOC);
+			auto somme = T(0);
+
+			for (auto i = b * TAILLE_BLOC; i < fin; ++i) {
+				somme += donnees[i];
+			}
+
+			sommes_blocs[b] = somme;
+		}
+	});
+
+	auto total = T(0);
+
+	for (auto &somme : sommes_blocs) {
+		const auto valeur = somme;
+		somme = total;
+		total += valeur;
+	}
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, nombre_blocs),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto b = r.begin(), be = r.end(); b < be; ++b) {
+			const auto fin = std::min(taille, (b + 1) * TAILLE_BLOC);
+			auto somme = sommes_blocs[b];
+
+			for (auto i = b * TAILLE_BLOC; i < fin; ++i) {
+				const auto valeur = donnees[i];
+				donnees[i] = somme;
+				somme += valeur;
+			}
+		}
+	});
+
+	return total;
+}
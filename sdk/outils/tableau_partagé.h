@@ -0,0 +1,276 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+/**
+ * Retourne le compteur des octets dupliqués par les copies sur écriture faites
+ * par le thread courant. Celui qui veut mesurer les copies d'un travail (par
+ * exemple execute_operateur) remet le compteur à zéro avant, et le lit après.
+ */
+inline size_t &octets_dupliques_thread()
+{
+	static thread_local size_t octets = 0;
+	return octets;
+}
+
+inline void compte_octets_dupliques(size_t octets)
+{
+	octets_dupliques_thread() += octets;
+}
+
+/**
+ * Tableau dont le stockage est partagé entre ses copies, et qui n'est dupliqué
+ * qu'au premier accès en écriture (copie sur écriture).
+ *
+ * Les méthodes constantes ne copient jamais la mémoire. Les méthodes non
+ * constantes dupliquent le stockage s'il est encore partagé avec un autre
+ * tableau : une branche du graphe qui ne fait que lire les données de son
+ * entrée ne paye donc plus de copie.
+ *
+ * Le stockage est aligné sur 64 octets (la taille d'une ligne de cache), afin
+ * que les boucles sur les éléments puissent être vectorisées.
+ *
+ * La duplication n'est pas protégée contre les accès concurrents : avant
+ * d'écrire dans le tableau depuis plusieurs threads, il faut appeler detache()
+ * (ou prendre le pointeur retourné par donnees()) depuis un seul thread.
+ *
+ * Un tableau peut aussi lire une mémoire qu'il n'a pas allouée, par exemple
+ * une projection en mémoire d'un fichier (voir externe()) : elle est traitée
+ * comme un stockage partagé, et dupliquée au premier accès en écriture.
+ */
+template <typename T>
+class TableauPartage {
+	static_assert(std::is_trivially_destructible<T>::value,
+	              "TableauPartage ne peut contenir que des types sans destructeur");
+
+	static constexpr auto ALIGNEMENT = std::align_val_t(64);
+
+	struct Stockage {
+		T *donnees = nullptr;
+		size_t capacite = 0;
+
+		/* Propriétaire d'une mémoire externe, nul si le stockage a été alloué
+		 * par le tableau. */
+		std::shared_ptr<const void> proprietaire{};
+
+		explicit Stockage(size_t n)
+		    : donnees(static_cast<T *>(::operator new(n * sizeof(T), ALIGNEMENT)))
+		    , capacite(n)
+		{}
+
+		Stockage(const T *externe, size_t n, std::shared_ptr<const void> proprio)
+		    : donnees(const_cast<T *>(externe))
+		    , capacite(n)
+		    , proprietaire(std::move(proprio))
+		{}
+
+		~Stockage()
+		{
+			if (proprietaire == nullptr) {
+				::operator delete(donnees, ALIGNEMENT);
+			}
+		}
+
+		Stockage(const Stockage &) = delete;
+		Stockage &operator=(const Stockage &) = delete;
+	};
+
+	std::shared_ptr<Stockage> m_stockage{};
+	size_t m_taille = 0;
+
+public:
+	TableauPartage() = default;
+
+	/**
+	 * Retourne un tableau lisant les n éléments à l'adresse donnees, sans les
+	 * copier. La mémoire n'est jamais modifiée : elle est dupliquée au premier
+	 * accès en écriture. Le propriétaire est gardé en vie tant qu'un tableau
+	 * lit la mémoire, c'est lui qui la libère.
+	 */
+	static TableauPartage externe(const T *donnees, size_t n, std::shared_ptr<const void> proprietaire)
+	{
+		auto tableau = TableauPartage();
+		tableau.m_stockage = std::make_shared<Stockage>(donnees, n, std::move(proprietaire));
+		tableau.m_taille = n;
+		return tableau;
+	}
+
+	size_t taille() const
+	{
+		return m_taille;
+	}
+
+	bool est_vide() const
+	{
+		return m_taille == 0;
+	}
+
+	size_t taille_octets() const
+	{
+		return m_taille * sizeof(T);
+	}
+
+	/**
+	 * Retourne vrai si le stockage est partagé avec un autre tableau.
+	 */
+	bool est_partage() const
+	{
+		return m_stockage != nullptr && m_stockage.use_count() > 1;
+	}
+
+	/**
+	 * Retourne vrai si le tableau lit une mémoire qu'il n'a pas allouée.
+	 */
+	bool est_externe() const
+	{
+		return m_stockage != nullptr && m_stockage->proprietaire != nullptr;
+	}
+
+	/**
+	 * Duplique le stockage s'il est partagé, afin que ce tableau en soit le
+	 * seul propriétaire.
+	 */
+	void detache()
+	{
+		if (!est_proprietaire()) {
+			realloue(m_taille);
+		}
+	}
+
+	const T *donnees() const
+	{
+		return (m_stockage != nullptr) ? m_stockage->donnees : nullptr;
+	}
+
+	T *donnees()
+	{
+		detache();
+		return (m_stockage != nullptr) ? m_stockage->donnees : nullptr;
+	}
+
+	const T &operator[](size_t i) const
+	{
+		return m_stockage->donnees[i];
+	}
+
+	T &operator[](size_t i)
+	{
+		detache();
+		return m_stockage->donnees[i];
+	}
+
+	void ajoute(const T &valeur)
+	{
+		if (m_stockage == nullptr || !est_proprietaire() || m_taille == m_stockage->capacite) {
+			realloue(std::max(m_taille * 2, m_taille + 1));
+		}
+
+		new (&m_stockage->donnees[m_taille]) T(valeur);
+		++m_taille;
+	}
+
+	void reserve(size_t n)
+	{
+		if (m_stockage == nullptr || n > m_stockage->capacite) {
+			realloue(std::max(n, m_taille));
+		}
+		else {
+			detache();
+		}
+	}
+
+	void redimensionne(size_t n)
+	{
+		if (m_stockage == nullptr || n > m_stockage->capacite) {
+			realloue(n);
+		}
+		else {
+			detache();
+		}
+
+		if (n > m_taille) {
+			std::uninitialized_value_construct(m_stockage->donnees + m_taille,
+			                                   m_stockage->donnees + n);
+		}
+
+		m_taille = n;
+	}
+
+	void efface()
+	{
+		/* Ne touche pas au stockage s'il est partagé, abandonne-le. */
+		if (!est_proprietaire()) {
+			m_stockage.reset();
+		}
+
+		m_taille = 0;
+	}
+
+private:
+	/* Vrai si le tableau peut écrire dans son stockage sans le dupliquer. */
+	bool est_proprietaire() const
+	{
+		if (m_stockage == nullptr) {
+			return true;
+		}
+
+		if (est_partage() || est_externe()) {
+			return false;
+		}
+
+		/* use_count() est une lecture relâchée : la dernière copie a pu être
+		 * libérée par un autre thread, par exemple la collection publiée à
+		 * l'interface. La barrière ordonne ses dernières lectures avant les
+		 * écritures qui vont suivre sur place. */
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return true;
+	}
+
+	void realloue(size_t capacite)
+	{
+		auto stockage = std::make_shared<Stockage>(capacite);
+
+		if (m_stockage != nullptr && m_taille != 0) {
+			const auto nombre = std::min(m_taille, capacite);
+
+			std::uninitialized_copy_n(m_stockage->donnees, nombre, stockage->donnees);
+
+			/* Seules les copies d'un stockage partagé sont comptées, pas
+			 * l'agrandissement d'un stockage propre. */
+			if (est_partage() || est_externe()) {
+				compte_octets_dupliques(nombre * sizeof(T));
+			}
+		}
+
+		m_stockage = std::move(stockage);
+	}
+};
@@ -0,0 +1,157 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <tbb/blocked_range.h>
+
+#include "../geomlists.h"
+
+struct Triangle {
+	glm::vec3 v0, v1, v2;
+};
+
+/**
+ * Vue sur les triangles obtenus en triangulant en éventail les polygones d'un
+ * maillage, sans copier ni les index ni les positions.
+ *
+ * Un polygone de n sommets donne n - 2 triangles, donc les triangles du
+ * polygone p sont [debut(p) - 2 * p, debut(p + 1) - 2 * (p + 1)[ : le
+ * triangle t est celui d'index t dans le résultat de triangule_polygones(),
+ * et retrouver son polygone est une recherche dichotomique (une division
+ * quand tous les polygones ont le même nombre de sommets).
+ *
+ * L'accès par index convient aux accès isolés ; pour parcourir une plage,
+ * pour_chaque() ne cherche que le premier polygone et avance ensuite de
+ * proche en proche. Une plage tbb::blocked_range<size_t>(0, taille()) peut
+ * donc être découpée librement entre les threads.
+ *
+ * La vue garde des références vers les listes, qui doivent lui survivre et ne
+ * pas être modifiées pendant qu'elle est utilisée.
+ */
+class VueTriangles {
+	const PointList &m_points;
+	const PolygonList &m_polygones;
+
+	size_t premier_triangle(size_t polygone) const
+	{
+		return m_polygones.debut(polygone) - 2 * polygone;
+	}
+
+public:
+	VueTriangles(const PointList &points, const PolygonList &polygones)
+	    : m_points(points)
+	    , m_polygones(polygones)
+	{}
+
+	size_t taille() const
+	{
+		return m_polygones.nombre_triangles();
+	}
+
+	bool est_vide() const
+	{
+		return taille() == 0;
+	}
+
+	/**
+	 * Retourne l'index du polygone dont le triangle t est issu.
+	 */
+	size_t polygone(size_t t) const
+	{
+		if (m_polygones.est_uniforme()) {
+			return t / (m_polygones.sommets_par_polygone() - 2);
+		}
+
+		/* Cherche le dernier polygone commençant avant t : les polygones de
+		 * moins de trois sommets, qui n'ont pas de triangle, sont sautés. */
+		size_t debut = 0;
+		size_t fin = m_polygones.size();
+
+		while (fin - debut > 1) {
+			const auto milieu = debut + (fin - debut) / 2;
+
+			if (premier_triangle(milieu) <= t) {
+				debut = milieu;
+			}
+			else {
+				fin = milieu;
+			}
+		}
+
+		return debut;
+	}
+
+	/**
+	 * Retourne les index des sommets du triangle t.
+	 */
+	glm::uvec3 sommets(size_t t) const
+	{
+		const auto p = polygone(t);
+		return sommets(p, t - premier_triangle(p));
+	}
+
+	Triangle operator[](size_t t) const
+	{
+		return triangle(sommets(t));
+	}
+
+	/**
+	 * Appelle op(t, triangle) pour chaque triangle t de la plage, dans
+	 * l'ordre.
+	 */
+	template <typename Op>
+	void pour_chaque(const tbb::blocked_range<size_t> &plage, Op &&op) const
+	{
+		if (plage.empty()) {
+			return;
+		}
+
+		auto p = polygone(plage.begin());
+		auto j = plage.begin() - premier_triangle(p);
+
+		for (auto t = plage.begin(), te = plage.end(); t < te; ++t) {
+			while (j + 2 >= m_polygones.nombre_sommets(p)) {
+				++p;
+				j = 0;
+			}
+
+			op(t, triangle(sommets(p, j)));
+			++j;
+		}
+	}
+
+private:
+	glm::uvec3 sommets(size_t p, size_t j) const
+	{
+		const auto index = m_polygones.sommets(p);
+		return glm::uvec3(index[0], index[j + 1], index[j + 2]);
+	}
+
+	Triangle triangle(const glm::uvec3 &index) const
+	{
+		return Triangle{ m_points[index[0]], m_points[index[1]], m_points[index[2]] };
+	}
+};
@@ -24,6 +24,8 @@
 
 #include "persona.h"
 
+#include "outils/empreinte.h"
+
 void Persona::add_prop(std::string name, std::string ui_name, property_type type)
 {
 	Property prop;
@@ -221,6 +223,53 @@ std::vector<Property> &Persona::props()
 	return m_props;
 }
 
+uint64_t Persona::empreinte_proprietes(uint64_t graine) const
+{
+	auto empreinte = combine_empreinte(graine, static_cast<uint64_t>(m_props.size()));
+
+	for (const Property &prop : m_props) {
+		empreinte = combine_empreinte(empreinte, prop.name);
+		empreinte = combine_empreinte(empreinte, static_cast<uint64_t>(prop.type));
+
+		switch (prop.type) {
+			case property_type::prop_bool:
+				empreinte = combine_empreinte(
+				                empreinte,
+				                static_cast<uint64_t>(std::experimental::any_cast<bool>(prop.data)));
+				break;
+			case property_type::prop_float:
+				empreinte = combine_empreinte(
+				                empreinte,
+				                std::experimental::any_cast<float>(prop.data));
+				break;
+			case property_type::prop_vec3:
+			{
+				const auto valeur = std::experimental::any_cast<glm::vec3>(prop.data);
+				empreinte = combine_empreinte(empreinte, valeur.x);
+				empreinte = combine_empreinte(empreinte, valeur.y);
+				empreinte = combine_empreinte(empreinte, valeur.z);
+				break;
+			}
+			case property_type::prop_enum:
+			case property_type::prop_int:
+				empreinte = combine_empreinte(
+				                empreinte,
+				                static_cast<uint64_t>(std::experimental::any_cast<int>(prop.data)));
+				break;
+			case property_type::prop_input_file:
+			case property_type::prop_output_file:
+			case property_type::prop_string:
+			case property_type::prop_list:
+				empreinte = combine_empreinte(
+				                empreinte,
+				                std::experimental::any_cast<std::string>(prop.data));
+				break;
+		}
+	}
+
+	return empreinte;
+}
+
 void Persona::valeur_propriete_bool(const std::string &prop_name, bool valeur)
 {
 	Property *prop = find_property(prop_name);
@@ -25,6 +25,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <experimental/any>
 #include <glm/glm.hpp>
 #include <iostream>
@@ -123,6 +124,15 @@ public:
 
 	std::vector<Property> &props();
 
+	/**
+	 * Retourne une empreinte des noms et des valeurs des propriétés : deux
+	 * personas dont les propriétés ont les mêmes valeurs ont la même
+	 * empreinte. Les informations d'interface (nom affiché, visibilité,
+	 * bornes) n'y participent pas. Des graines différentes donnent des
+	 * empreintes indépendantes.
+	 */
+	uint64_t empreinte_proprietes(uint64_t graine = 0) const;
+
 	void valeur_propriete_bool(const std::string &prop_name, bool valeur);
 	void valeur_propriete_int(const std::string &prop_name, int valeur);
 	void valeur_propriete_float(const std::string &prop_name, float valeur);
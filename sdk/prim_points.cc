@@ -29,11 +29,11 @@
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 
-#include "outils/géométrie.h"
-
 #include "context.h"
 #include "renderbuffer.h"
 
+static const auto ID_ATTR_COULEUR = attribute_id("color", ATTR_TYPE_VEC3);
+
 /* ************************************************************************** */
 
 static RenderBuffer *create_point_buffer()
@@ -77,16 +77,9 @@ PrimPoints::PrimPoints()
 
 PrimPoints::PrimPoints(const PrimPoints &other)
     : Primitive(other)
+    , m_points(other.m_points)
     , m_renderbuffer(nullptr)
-{
-	/* Copy points. */
-	auto points = other.points();
-	m_points.resize(points->size());
-
-	for (auto i = 0ul; i < points->size(); ++i) {
-		m_points[i] = (*points)[i];
-	}
-}
+{}
 
 PrimPoints::~PrimPoints()
 {
@@ -105,10 +98,17 @@ const PointList *PrimPoints::points() const
 
 Primitive *PrimPoints::copy() const
 {
-	auto prim = new PrimPoints(*this);
-	prim->tagUpdate();
+	return new PrimPoints(*this);
+}
+
+size_t PrimPoints::taille_octets() const
+{
+	return Primitive::taille_octets() + m_points.byte_size();
+}
 
-	return prim;
+size_t PrimPoints::nombre_points() const
+{
+	return m_points.size();
 }
 
 size_t PrimPoints::typeID() const
@@ -137,14 +137,17 @@ void PrimPoints::prepareRenderData()
 		m_points[i] = m_points[i] * glm::mat3(m_inv_matrix);
 	}
 
+	invalide_boite_delimitation();
+
 	m_renderbuffer->set_vertex_buffer("vertex",
 	                                  m_points.data(),
 	                                  m_points.byte_size(),
 	                                  nullptr,
 	                                  0,
-	                                  m_points.size());
+	                                  m_points.size(),
+	                                  m_points.foulee());
 
-	auto colors = this->attribute("color", ATTR_TYPE_VEC3);
+	auto colors = this->attribute(ID_ATTR_COULEUR);
 
 	if (colors != nullptr) {
 		m_renderbuffer->set_color_buffer("vertex_color", colors->data(), colors->byte_size());
@@ -155,9 +158,8 @@ void PrimPoints::prepareRenderData()
 
 void PrimPoints::computeBBox(glm::vec3 &min, glm::vec3 &max)
 {
-	calcule_boite_delimitation(m_points, m_min, m_max);
+	met_a_jour_boite_delimitation(m_points);
 
 	min = m_min;
 	max = m_max;
-	m_dimensions = m_max - m_min;
 }
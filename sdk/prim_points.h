@@ -46,6 +46,10 @@ public:
 
 	Primitive *copy() const override;
 
+	size_t taille_octets() const override;
+
+	size_t nombre_points() const override;
+
 	void render(const ViewerContext &context) override;
 
 	void prepareRenderData() override;
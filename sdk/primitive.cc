@@ -28,8 +28,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "outils/chaîne_caractère.h"
+#include "outils/géométrie.h"
 #include "outils/rendu.h"
 
+#include "geomlists.h"
+
 Primitive::Primitive(const Primitive &other)
     : m_dimensions(other.m_dimensions)
     , m_scale(other.m_scale)
@@ -42,17 +45,17 @@ Primitive::Primitive(const Primitive &other)
     , m_inv_matrix(other.m_inv_matrix)
     , m_name(other.m_name)
     , m_draw_bbox(other.m_draw_bbox)
-    , m_need_update(other.m_need_update)
-    , m_need_data_update(other.m_need_data_update)
+    , m_need_update(true)
+    , m_need_data_update(true)
+    , m_version(other.m_version)
+    , m_version_boite(other.m_version_boite)
 {
-	for (auto attr : m_attributes) {
-		delete attr;
-	}
-
-	m_attributes.clear();
+	/* Les tampons de rendu ne sont pas copiés, ils doivent être préparés à
+	 * nouveau ; la version est gardée car la géométrie est la même, ce qui
+	 * permet de réutiliser la boîte délimitation et les autres caches. */
 
 	for (auto attr : other.m_attributes) {
-		this->add_attribute(new Attribute(*attr));
+		this->insert_attribute(new Attribute(*attr));
 	}
 }
 
@@ -157,6 +160,43 @@ void Primitive::tagUpdate()
 {
 	m_need_update = true;
 	m_need_data_update = true;
+	++m_version;
+}
+
+unsigned long Primitive::version() const
+{
+	return m_version;
+}
+
+size_t Primitive::taille_octets() const
+{
+	auto taille = 0ul;
+
+	for (const auto &attr : m_attributes) {
+		taille += attr->byte_size();
+	}
+
+	return taille;
+}
+
+size_t Primitive::nombre_points() const
+{
+	return 0;
+}
+
+void Primitive::met_a_jour_boite_delimitation(const PointList &points)
+{
+	if (m_version_boite != m_version) {
+		calcule_boite_delimitation(points, m_min, m_max);
+		m_version_boite = m_version;
+	}
+
+	m_dimensions = m_max - m_min;
+}
+
+void Primitive::invalide_boite_delimitation()
+{
+	m_version_boite = VERSION_INVALIDE;
 }
 
 std::string Primitive::name() const
@@ -169,10 +209,41 @@ void Primitive::name(const std::string &name)
 	m_name = name;
 }
 
+using TableAttributs = std::vector<std::pair<AttributeID, Attribute *>>;
+
+static TableAttributs::iterator cherche_attribut(TableAttributs &table, AttributeID id)
+{
+	return std::lower_bound(table.begin(), table.end(), id,
+	                        [](const TableAttributs::value_type &entree, AttributeID valeur)
+	{
+		return entree.first < valeur;
+	});
+}
+
+void Primitive::insert_attribute(Attribute *attr)
+{
+	const auto id = attr->id();
+
+	m_attributes.push_back(attr);
+
+	if (id == INVALID_ATTRIBUTE_ID) {
+		return;
+	}
+
+	auto iter = cherche_attribut(m_table_attributs, id);
+
+	if (iter != m_table_attributs.end() && iter->first == id) {
+		iter->second = attr;
+	}
+	else {
+		m_table_attributs.insert(iter, std::make_pair(id, attr));
+	}
+}
+
 void Primitive::add_attribute(Attribute *attr)
 {
-	if (!has_attribute(attr->name(), attr->type())) {
-		m_attributes.push_back(attr);
+	if (!has_attribute(attr->id())) {
+		insert_attribute(attr);
 	}
 }
 
@@ -182,7 +253,7 @@ Attribute *Primitive::add_attribute(const std::string &name, const AttributeType
 
 	if (attr == nullptr) {
 		attr = new Attribute(name, type, size);
-		m_attributes.push_back(attr);
+		insert_attribute(attr);
 	}
 
 	return attr;
@@ -190,32 +261,37 @@ Attribute *Primitive::add_attribute(const std::string &name, const AttributeType
 
 Attribute *Primitive::attribute(const std::string &name, const AttributeType type)
 {
-	auto iter = std::find_if(m_attributes.begin(), m_attributes.end(),
-	                         [&](Attribute *attr)
-	{
-		return (attr->type() == type) && (attr->name() == name);
-	});
+	return attribute(find_attribute_id(name, type));
+}
+
+Attribute *Primitive::attribute(AttributeID id)
+{
+	auto iter = cherche_attribut(m_table_attributs, id);
 
-	if (iter == m_attributes.end()) {
+	if (iter == m_table_attributs.end() || iter->first != id) {
 		return nullptr;
 	}
 
-	return *iter;
+	return iter->second;
 }
 
 void Primitive::remove_attribute(const std::string &name, const AttributeType type)
 {
-	auto iter = std::find_if(m_attributes.begin(), m_attributes.end(),
-	                         [&](Attribute *attr)
-	{
-		return (attr->type() == type) && (attr->name() == name);
-	});
+	remove_attribute(find_attribute_id(name, type));
+}
 
-	if (iter != m_attributes.end()) {
-		delete *iter;
+void Primitive::remove_attribute(AttributeID id)
+{
+	auto attr = attribute(id);
+
+	if (attr == nullptr) {
+		return;
 	}
 
-	m_attributes.erase(iter);
+	m_table_attributs.erase(cherche_attribut(m_table_attributs, id));
+	m_attributes.erase(std::find(m_attributes.begin(), m_attributes.end(), attr));
+
+	delete attr;
 }
 
 bool Primitive::has_attribute(const std::string &name, const AttributeType type)
@@ -223,6 +299,16 @@ bool Primitive::has_attribute(const std::string &name, const AttributeType type)
 	return (attribute(name, type) != nullptr);
 }
 
+bool Primitive::has_attribute(AttributeID id)
+{
+	return (attribute(id) != nullptr);
+}
+
+const std::vector<Attribute *> &Primitive::attributes() const
+{
+	return m_attributes;
+}
+
 /* ********************************************** */
 
 PrimitiveCollection::PrimitiveCollection(PrimitiveFactory *factory)
@@ -323,13 +409,16 @@ void PrimitiveCollection::destroy(const std::vector<Primitive *> &prims)
 void PrimitiveCollection::copy_collection(const PrimitiveCollection &coll)
 {
 	for (auto prim : primitive_iterator(&coll)) {
-		this->add(prim);
+		this->add(prim->copy());
 	}
 }
 
 void PrimitiveCollection::merge_collection(PrimitiveCollection &coll)
 {
-	copy_collection(coll);
+	for (auto prim : primitive_iterator(&coll)) {
+		this->add(prim);
+	}
+
 	coll.clear();
 }
 
@@ -338,6 +427,17 @@ PrimitiveFactory *PrimitiveCollection::factory() const
 	return m_factory;
 }
 
+size_t PrimitiveCollection::taille_octets() const
+{
+	auto taille = 0ul;
+
+	for (const auto &prim : m_collection) {
+		taille += prim->taille_octets();
+	}
+
+	return taille;
+}
+
 int PrimitiveCollection::refcount() const
 {
 	return m_ref;
@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <limits>
 #include <memory>
 #include <unordered_map>
 
@@ -32,6 +33,7 @@
 
 class Modifier;
 class ParamCallback;
+class PointList;
 class Ray;
 class ViewerContext;
 
@@ -39,6 +41,8 @@ class ViewerContext;
 
 class Primitive {
 protected:
+	static constexpr auto VERSION_INVALIDE = std::numeric_limits<unsigned long>::max();
+
 	std::unique_ptr<Cube> m_bbox{};
 
 	glm::vec3 m_dimensions = glm::vec3(1.0f);
@@ -59,8 +63,32 @@ protected:
 	bool m_need_update = true;
 	bool m_need_data_update = true;
 
+	/* Incrémentée à chaque appel de tagUpdate(), pour que les données dérivées
+	 * de la géométrie (adjacence, etc.) sachent si elles sont périmées. */
+	unsigned long m_version = 0;
+
+	/* Version pour laquelle m_min et m_max ont été calculés. */
+	unsigned long m_version_boite = VERSION_INVALIDE;
+
 	std::vector<Attribute *> m_attributes = {};
 
+	/* Attributs triés par identifiant, pour une recherche dichotomique. La
+	 * table ne dépend que du nombre d'attributs de la primitive, et non du
+	 * nombre de noms internés depuis le lancement. */
+	std::vector<std::pair<AttributeID, Attribute *>> m_table_attributs = {};
+
+	/**
+	 * Calcule m_min, m_max et m_dimensions à partir des points, sauf si les
+	 * valeurs en cache ont été calculées depuis le dernier appel à tagUpdate().
+	 */
+	void met_a_jour_boite_delimitation(const PointList &points);
+
+	/**
+	 * Force le prochain appel à met_a_jour_boite_delimitation() à recalculer
+	 * la boîte, pour les modifications des points faites sans tagUpdate().
+	 */
+	void invalide_boite_delimitation();
+
 public:
 	Primitive() = default;
 	Primitive(const Primitive &other);
@@ -120,6 +148,12 @@ public:
 	 */
 	void tagUpdate();
 
+	/**
+	 * Retourne le numéro de version de cette primitive, incrémenté à chaque
+	 * appel de tagUpdate().
+	 */
+	unsigned long version() const;
+
 	std::string name() const;
 	void name(const std::string &name);
 
@@ -129,6 +163,19 @@ public:
 	 */
 	virtual Primitive *copy() const = 0;
 
+	/**
+	 * Retourne la taille en octets des données de cette primitive (listes
+	 * géométriques et attributs). Les tampons partagés avec des copies sont
+	 * comptés en entier.
+	 */
+	virtual size_t taille_octets() const;
+
+	/**
+	 * Retourne le nombre de points de cette primitive, 0 pour les primitives
+	 * qui n'en ont pas.
+	 */
+	virtual size_t nombre_points() const;
+
 	/**
 	 * @brief typeID The unique ID that is shared between primitives instanced
 	 *               from a type derived from this class.
@@ -189,6 +236,18 @@ public:
 	 */
 	Attribute *attribute(const std::string &name, const AttributeType type);
 
+	/**
+	 * @brief attribute Return an attribute from this primitive's attibute list,
+	 *                  using a binary search over its table sorted by
+	 *                  identifier: O(log n) in the number of attributes, with
+	 *                  no string comparison.
+	 * @param id The identifier of the attribute, as returned by attribute_id().
+	 *
+	 * @return The attribute corresponding to the given identifier, nullptr
+	 *         if no such attribute exists.
+	 */
+	Attribute *attribute(AttributeID id);
+
 	/**
 	 * @brief remove_attribute Remove an attribute from this primitive's attibute list.
 	 * @param name The name of the attribute to remove.
@@ -196,6 +255,8 @@ public:
 	 */
 	void remove_attribute(const std::string &name, const AttributeType type);
 
+	void remove_attribute(AttributeID id);
+
 	/**
 	 * @brief has_attribute Return whether the given attribute exists in this
 	 *                      primitive's attibute list.
@@ -205,6 +266,17 @@ public:
 	 * @return True if such attribute exists, false otherwise.
 	 */
 	bool has_attribute(const std::string &name, const AttributeType type);
+
+	bool has_attribute(AttributeID id);
+
+	/**
+	 * Retourne les attributs de la primitive, dans l'ordre où ils ont été
+	 * ajoutés.
+	 */
+	const std::vector<Attribute *> &attributes() const;
+
+private:
+	void insert_attribute(Attribute *attr);
 };
 
 /* ********************************************** */
@@ -298,6 +370,9 @@ public:
 
 	/**
 	 * @brief copy_collection Copy the primitives from one collection to this.
+	 *                        The geometry buffers of the copies are shared
+	 *                        with the originals until either side writes to
+	 *                        them, so this is cheap.
 	 * @param coll The collection to copy the primitives from.
 	 */
 	void copy_collection(const PrimitiveCollection &coll);
@@ -317,6 +392,12 @@ public:
 	 */
 	PrimitiveFactory *factory() const;
 
+	/**
+	 * Retourne la somme des tailles en octets des primitives de cette
+	 * collection.
+	 */
+	size_t taille_octets() const;
+
 	/* Reference counting, NOT to be used from plugins. They are used to
 	 * indicate that primitives are ready to be deleted.
 	 *
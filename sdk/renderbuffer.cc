@@ -160,7 +160,8 @@ void RenderBuffer::set_vertex_buffer(const std::string &attribute,
                                      const size_t vertices_size,
                                      const void *indices_ptr,
                                      const size_t indices_size,
-                                     const size_t elements)
+                                     const size_t elements,
+                                     const int composantes)
 {
 	init();
 
@@ -174,7 +175,7 @@ void RenderBuffer::set_vertex_buffer(const std::string &attribute,
 		m_index_drawing = true;
 	}
 
-	m_buffer_data->attribPointer(m_program[attribute], 3);
+	m_buffer_data->attribPointer(m_program[attribute], composantes);
 	m_buffer_data->unbind();
 }
 
@@ -100,12 +100,15 @@ public:
 	                       const std::vector<glm::vec3> &vertices,
 	                       const std::vector<unsigned int> &indices);
 
+	/* composantes : nombre de flottants par sommet dans vertices_ptr, 4 pour
+	 * des points stockés en voies alignées (le shader ignore la quatrième). */
 	void set_vertex_buffer(const std::string &attribute,
 	                       const void *vertices_ptr,
 	                       const size_t vertices_size,
 	                       const void *indices_ptr,
 	                       const size_t indices_size,
-	                       const size_t elements);
+	                       const size_t elements,
+	                       const int composantes = 3);
 
 	void set_extra_buffer(const std::string &attribute,
 	                      const std::vector<glm::vec3> &values);
@@ -29,11 +29,11 @@
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 
-#include "outils/géométrie.h"
-
 #include "context.h"
 #include "renderbuffer.h"
 
+static const auto ID_ATTR_COULEUR = attribute_id("color", ATTR_TYPE_VEC3);
+
 /* ************************************************************************** */
 
 static RenderBuffer *create_point_buffer()
@@ -76,24 +76,10 @@ SegmentPrim::SegmentPrim()
 
 SegmentPrim::SegmentPrim(const SegmentPrim &other)
     : Primitive(other)
+    , m_points(other.m_points)
+    , m_edges(other.m_edges)
     , m_renderbuffer(nullptr)
-{
-	/* Copy points. */
-	auto points = other.points();
-	m_points.resize(points->size());
-
-	for (auto i = 0ul; i < points->size(); ++i) {
-		m_points[i] = (*points)[i];
-	}
-
-	/* Copy edges. */
-	auto edges = other.edges();
-	m_edges.resize(edges->size());
-
-	for (auto i = 0ul; i < edges->size(); ++i) {
-		m_edges[i] = (*edges)[i];
-	}
-}
+{}
 
 SegmentPrim::~SegmentPrim()
 {
@@ -122,10 +108,17 @@ const EdgeList *SegmentPrim::edges() const
 
 Primitive *SegmentPrim::copy() const
 {
-	auto prim = new SegmentPrim(*this);
-	prim->tagUpdate();
+	return new SegmentPrim(*this);
+}
+
+size_t SegmentPrim::taille_octets() const
+{
+	return Primitive::taille_octets() + m_points.byte_size() + m_edges.byte_size();
+}
 
-	return prim;
+size_t SegmentPrim::nombre_points() const
+{
+	return m_points.size();
 }
 
 size_t SegmentPrim::typeID() const
@@ -171,6 +164,8 @@ void SegmentPrim::prepareRenderData()
 		m_points[i] = m_points[i] * glm::mat3(m_inv_matrix);
 	}
 
+	invalide_boite_delimitation();
+
 	auto edgelist = this->edges();
 	auto indices = std::vector<unsigned int>{};
 	indices.reserve(edgelist->size());
@@ -186,9 +181,10 @@ void SegmentPrim::prepareRenderData()
 	                                  m_points.byte_size(),
 	                                  &indices[0],
 	                                  indices.size() * sizeof(GLuint),
-	                                  indices.size());
+	                                  indices.size(),
+	                                  m_points.foulee());
 
-	auto colors = this->attribute("color", ATTR_TYPE_VEC3);
+	auto colors = this->attribute(ID_ATTR_COULEUR);
 
 	if (colors != nullptr) {
 		m_renderbuffer->set_color_buffer("vertex_color", colors->data(), colors->byte_size());
@@ -199,9 +195,8 @@ void SegmentPrim::prepareRenderData()
 
 void SegmentPrim::computeBBox(glm::vec3 &min, glm::vec3 &max)
 {
-	calcule_boite_delimitation(m_points, m_min, m_max);
+	met_a_jour_boite_delimitation(m_points);
 
 	min = m_min;
 	max = m_max;
-	m_dimensions = m_max - m_min;
 }
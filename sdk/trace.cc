@@ -0,0 +1,252 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/* ************************************************************************** */
+
+struct EvenementTrace {
+	char nom[PorteeTrace::TAILLE_NOM];
+	const char *categorie;
+	uint64_t debut;
+	uint64_t duree;
+	int64_t valeur;
+};
+
+static constexpr uint64_t CAPACITE_TAMPON = 1ul << 15;
+
+/* Tampon circulaire d'un thread : seul ce thread écrit les évènements, puis
+ * publie leur nombre ; l'exportation le lit pour savoir quels évènements sont
+ * complets. */
+struct TamponTrace {
+	std::unique_ptr<EvenementTrace[]> evenements{new EvenementTrace[CAPACITE_TAMPON]};
+	std::atomic<uint64_t> nombre_ecrits{0};
+
+	/* Les évènements avant celui-ci ont été oubliés par vide_trace(). */
+	std::atomic<uint64_t> premier{0};
+
+	size_t index_thread = 0;
+};
+
+static std::atomic<bool> enregistrement_actif{false};
+
+/* Les tampons des threads, gardés jusqu'à la fin du programme pour que les
+ * évènements d'un thread terminé puissent encore être exportés. */
+static std::mutex verrou_tampons;
+static std::vector<std::unique_ptr<TamponTrace>> tampons;
+
+static thread_local TamponTrace *tampon_thread = nullptr;
+
+static const auto origine = std::chrono::steady_clock::now();
+
+static uint64_t maintenant()
+{
+	const auto duree = std::chrono::steady_clock::now() - origine;
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duree).count());
+}
+
+static TamponTrace *tampon_courant()
+{
+	if (tampon_thread == nullptr) {
+		std::lock_guard<std::mutex> verrou(verrou_tampons);
+		tampons.emplace_back(new TamponTrace);
+		tampon_thread = tampons.back().get();
+		tampon_thread->index_thread = tampons.size() - 1;
+	}
+
+	return tampon_thread;
+}
+
+/* ************************************************************************** */
+
+void active_trace(bool ouinon)
+{
+	enregistrement_actif = ouinon;
+}
+
+bool trace_active()
+{
+	return enregistrement_actif.load(std::memory_order_relaxed);
+}
+
+void vide_trace()
+{
+	std::lock_guard<std::mutex> verrou(verrou_tampons);
+
+	for (auto &tampon : tampons) {
+		tampon->premier = tampon->nombre_ecrits.load();
+	}
+}
+
+/* ************************************************************************** */
+
+PorteeTrace::PorteeTrace(const char *categorie, const char *nom, int64_t valeur)
+{
+	if (!trace_active()) {
+		return;
+	}
+
+	m_categorie = categorie;
+	m_valeur = valeur;
+
+	std::strncpy(m_nom, nom, TAILLE_NOM - 1);
+	m_nom[TAILLE_NOM - 1] = '\0';
+
+	m_debut = maintenant();
+}
+
+PorteeTrace::~PorteeTrace()
+{
+	if (m_categorie == nullptr) {
+		return;
+	}
+
+	const auto fin = maintenant();
+	auto tampon = tampon_courant();
+
+	const auto index = tampon->nombre_ecrits.load(std::memory_order_relaxed);
+	auto &evenement = tampon->evenements[index % CAPACITE_TAMPON];
+
+	std::memcpy(evenement.nom, m_nom, TAILLE_NOM);
+	evenement.categorie = m_categorie;
+	evenement.debut = m_debut;
+	evenement.duree = fin - m_debut;
+	evenement.valeur = m_valeur;
+
+	tampon->nombre_ecrits.store(index + 1, std::memory_order_release);
+}
+
+/* ************************************************************************** */
+
+static void ecris_chaine(std::ostream &os, const char *chaine)
+{
+	os << '"';
+
+	for (auto c = chaine; *c != '\0'; ++c) {
+		switch (*c) {
+			case '"':
+				os << "\\\"";
+				break;
+			case '\\':
+				os << "\\\\";
+				break;
+			default:
+				/* Les caractères de contrôle ne sont pas permis en JSON. */
+				if (static_cast<unsigned char>(*c) < 0x20) {
+					os << ' ';
+				}
+				else {
+					os << *c;
+				}
+				break;
+		}
+	}
+
+	os << '"';
+}
+
+/* Copie les évènements complets du tampon. Le propriétaire peut écrire en même
+ * temps : les évènements qu'il a pu remplacer pendant la copie sont ignorés. */
+static void copie_evenements(const TamponTrace &tampon, std::vector<EvenementTrace> &evenements)
+{
+	const auto fin = tampon.nombre_ecrits.load(std::memory_order_acquire);
+	auto debut = std::max(tampon.premier.load(), (fin > CAPACITE_TAMPON) ? fin - CAPACITE_TAMPON : 0);
+
+	evenements.clear();
+
+	for (auto i = debut; i < fin; ++i) {
+		evenements.push_back(tampon.evenements[i % CAPACITE_TAMPON]);
+	}
+
+	/* Le propriétaire peut être en train d'écrire l'évènement fin_copie, qui
+	 * remplace celui d'index fin_copie - CAPACITE_TAMPON. */
+	const auto fin_copie = tampon.nombre_ecrits.load(std::memory_order_acquire);
+
+	if (fin_copie + 1 > debut + CAPACITE_TAMPON) {
+		const auto remplaces = std::min<uint64_t>(fin_copie + 1 - CAPACITE_TAMPON - debut, evenements.size());
+		evenements.erase(evenements.begin(), evenements.begin() + static_cast<std::ptrdiff_t>(remplaces));
+	}
+}
+
+bool ecris_trace_chrome(const std::string &chemin)
+{
+	std::ofstream fichier(chemin.c_str());
+
+	if (!fichier.is_open()) {
+		return false;
+	}
+
+	fichier << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	fichier.setf(std::ios::fixed);
+	fichier.precision(3);
+
+	auto premier = true;
+	std::vector<EvenementTrace> evenements;
+
+	std::lock_guard<std::mutex> verrou(verrou_tampons);
+
+	for (const auto &tampon : tampons) {
+		copie_evenements(*tampon, evenements);
+
+		if (evenements.empty()) {
+			continue;
+		}
+
+		const auto tid = tampon->index_thread;
+
+		/* Les temps sont en microsecondes. */
+		for (const auto &evenement : evenements) {
+			fichier << (premier ? "" : ",\n") << "{\"name\":";
+			ecris_chaine(fichier, evenement.nom);
+			fichier << ",\"cat\":";
+			ecris_chaine(fichier, evenement.categorie);
+			fichier << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+			        << ",\"ts\":" << static_cast<double>(evenement.debut) * 1e-3
+			        << ",\"dur\":" << static_cast<double>(evenement.duree) * 1e-3;
+
+			if (evenement.valeur >= 0) {
+				fichier << ",\"args\":{\"valeur\":" << evenement.valeur << '}';
+			}
+
+			fichier << '}';
+			premier = false;
+		}
+
+		fichier << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+		        << ",\"args\":{\"name\":\"Thread " << tid << "\"}}";
+	}
+
+	fichier << "\n]}\n";
+
+	return fichier.good();
+}
@@ -0,0 +1,82 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Enregistrement, optionnel, de la chronologie de l'évaluation : quels noeuds
+ * et opérateurs ont été exécutés, quand, et sur quel thread. La trace est
+ * écrite au format JSON de Chrome (chrome://tracing, ui.perfetto.dev), où le
+ * chemin critique d'une image lente se lit directement.
+ *
+ * Chaque thread écrit ses évènements dans son propre tampon circulaire, sans
+ * verrou ; quand un tampon est plein, ses évènements les plus anciens sont
+ * remplacés. Quand l'enregistrement est désactivé, une portée ne coûte que la
+ * lecture d'un booléen.
+ */
+
+/**
+ * Active ou désactive l'enregistrement des évènements.
+ */
+void active_trace(bool ouinon);
+
+bool trace_active();
+
+/**
+ * Oublie les évènements enregistrés jusqu'à présent.
+ */
+void vide_trace();
+
+/**
+ * Écrit les évènements enregistrés dans le fichier au format JSON de Chrome.
+ * Retourne faux si le fichier n'a pas pu être écrit.
+ */
+bool ecris_trace_chrome(const std::string &chemin);
+
+/**
+ * Enregistre un évènement couvrant la durée de vie de la portée. La catégorie
+ * doit être une chaîne statique ; le nom est copié, et tronqué s'il est trop
+ * long. Une valeur positive, par exemple le numéro d'une passe, est ajoutée
+ * aux arguments de l'évènement.
+ */
+class PorteeTrace {
+public:
+	static constexpr size_t TAILLE_NOM = 48;
+
+private:
+	const char *m_categorie = nullptr;
+	char m_nom[TAILLE_NOM];
+	int64_t m_valeur = -1;
+	uint64_t m_debut = 0;
+
+public:
+	PorteeTrace(const char *categorie, const char *nom, int64_t valeur = -1);
+	~PorteeTrace();
+
+	PorteeTrace(const PorteeTrace &) = delete;
+	PorteeTrace &operator=(const PorteeTrace &) = delete;
+};
@@ -0,0 +1,154 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+/* Banc d'essai comparant les deux dispositions en mémoire de PointList sur
+ * des noyaux typiques : boîte délimitation et déplacement des points. */
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+#include <kamikaze/geomlists.h>
+#include <kamikaze/outils/géométrie.h>
+
+#include <tbb/tick_count.h>
+
+static constexpr auto NOMBRE_POINTS = 10000000ul;
+static constexpr auto NOMBRE_ITERATIONS = 10;
+
+static PointList cree_points(disposition_points disposition)
+{
+	PointList points(disposition);
+	points.resize(NOMBRE_POINTS);
+
+	for (size_t i = 0; i < NOMBRE_POINTS; ++i) {
+		const auto f = static_cast<float>(i);
+		points[i] = glm::vec3(f, -f, f * 0.5f);
+	}
+
+	return points;
+}
+
+template <typename Op>
+static double chronometre(Op &&op)
+{
+	auto meilleur = std::numeric_limits<double>::max();
+
+	for (int i = 0; i < NOMBRE_ITERATIONS; ++i) {
+		const auto debut = tbb::tick_count::now();
+		op();
+		const auto fin = tbb::tick_count::now();
+
+		meilleur = std::min(meilleur, (fin - debut).seconds());
+	}
+
+	return meilleur;
+}
+
+/* La foulée est un paramètre de gabarit afin que le compilateur connaisse
+ * l'espacement des points et puisse vectoriser les boucles. */
+template <size_t foulee>
+static void deplace_points(PointList &points, const glm::vec3 &decalage)
+{
+	auto voies = points.voies();
+
+	for (size_t i = 0, ie = points.size(); i < ie; ++i) {
+		voies[i * foulee + 0] += decalage.x;
+		voies[i * foulee + 1] += decalage.y;
+		voies[i * foulee + 2] += decalage.z;
+	}
+}
+
+/* Noyau plus coûteux en calcul : rotation puis torsion des points. */
+template <size_t foulee>
+static void tord_points(PointList &points, const glm::mat3 &rotation)
+{
+	auto voies = points.voies();
+
+	for (size_t i = 0, ie = points.size(); i < ie; ++i) {
+		const auto x = voies[i * foulee + 0];
+		const auto y = voies[i * foulee + 1];
+		const auto z = voies[i * foulee + 2];
+
+		auto rx = rotation[0][0] * x + rotation[1][0] * y + rotation[2][0] * z;
+		auto ry = rotation[0][1] * x + rotation[1][1] * y + rotation[2][1] * z;
+		auto rz = rotation[0][2] * x + rotation[1][2] * y + rotation[2][2] * z;
+
+		const auto t = ry * 1e-7f;
+		const auto c = 1.0f - 0.5f * t * t;
+		const auto s = t - t * t * t / 6.0f;
+
+		voies[i * foulee + 0] = rx * c - rz * s;
+		voies[i * foulee + 1] = ry;
+		voies[i * foulee + 2] = rx * s + rz * c;
+	}
+}
+
+static void banc_essai(const char *nom, disposition_points disposition)
+{
+	auto points = cree_points(disposition);
+
+	const auto temps_boite = chronometre([&]()
+	{
+		auto min = glm::vec3(std::numeric_limits<float>::max());
+		auto max = glm::vec3(-std::numeric_limits<float>::max());
+		calcule_boite_delimitation(points, min, max);
+	});
+
+	const auto temps_deplacement = chronometre([&]()
+	{
+		if (points.foulee() == 4) {
+			deplace_points<4>(points, glm::vec3(0.5f, 1.0f, 2.0f));
+		}
+		else {
+			deplace_points<3>(points, glm::vec3(0.5f, 1.0f, 2.0f));
+		}
+	});
+
+	const auto temps_torsion = chronometre([&]()
+	{
+		if (points.foulee() == 4) {
+			tord_points<4>(points, glm::mat3(1.0f));
+		}
+		else {
+			tord_points<3>(points, glm::mat3(1.0f));
+		}
+	});
+
+	std::cout << nom << " (" << points.byte_size() / (1024 * 1024) << " Mo)\n"
+	          << "\tboîte délimitation : " << temps_boite * 1000.0 << " ms\n"
+	          << "\tdéplacement        : " << temps_deplacement * 1000.0 << " ms\n"
+	          << "\ttorsion            : " << temps_torsion * 1000.0 << " ms\n";
+}
+
+int main()
+{
+	std::cout << NOMBRE_POINTS << " points, meilleur temps sur "
+	          << NOMBRE_ITERATIONS << " itérations\n";
+
+	banc_essai("DISPOSITION_AOS", DISPOSITION_AOS);
+	banc_essai("DISPOSITION_VOIES_ALIGNEES", DISPOSITION_VOIES_ALIGNEES);
+
+	return 0;
+}
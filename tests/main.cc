@@ -22,9 +22,32 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
 #include <numero7/test_unitaire/test_unitaire.h>
+#include <sstream>
+#include <thread>
+#include <vector>
 
+#include <kamikaze/bruit.h>
+#include <kamikaze/cache.h>
+#include <kamikaze/mesh.h>
+#include <kamikaze/noeud.h>
+#include <kamikaze/operateur.h>
+#include <kamikaze/outils/adjacence.h>
+#include <kamikaze/outils/empreinte.h>
+#include <kamikaze/outils/géométrie.h>
+#include <kamikaze/outils/triangles.h>
+#include <kamikaze/trace.h>
+
+#include "core/cache_disque.h"
+#include "core/graphs/depsgraph.h"
+#include "core/graphs/object_graph.h"
 #include "core/kamikaze_main.h"
+#include "core/object.h"
 #include "core/sauvegarde.h"
 #include "core/scene.h"
 
@@ -60,11 +83,995 @@ void test_lecture_fichier(numero7::test_unitaire::ControleurUnitaire &controleur
 	CU_VERIFIE_CONDITION(controleur, erreur == kamikaze::erreur_fichier::GREFFON_MANQUANT);
 }
 
+void test_copie_sur_ecriture(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	Mesh maillage;
+	maillage.points()->push_back(glm::vec3(0.0f, 1.0f, 2.0f));
+	maillage.polys()->push_back(glm::uvec4(0, 0, 0, INVALID_INDEX));
+
+	auto copie = std::unique_ptr<Mesh>(static_cast<Mesh *>(maillage.copy()));
+
+	const Mesh *copie_const = copie.get();
+
+	/* Les lectures ne doivent pas dupliquer les tampons. */
+	CU_VERIFIE_CONDITION(controleur, copie_const->points()->data() == maillage.points()->data());
+	CU_VERIFIE_CONDITION(controleur, copie_const->polys()->data() == maillage.polys()->data());
+	CU_VERIFIE_CONDITION(controleur, (*copie_const->points())[0] == glm::vec3(0.0f, 1.0f, 2.0f));
+
+	/* La première écriture duplique le tampon, sans toucher à l'original. */
+	(*copie->points())[0] = glm::vec3(3.0f);
+
+	CU_VERIFIE_CONDITION(controleur, copie->points()->data() != maillage.points()->data());
+	CU_VERIFIE_CONDITION(controleur, (*maillage.points())[0] == glm::vec3(0.0f, 1.0f, 2.0f));
+	CU_VERIFIE_CONDITION(controleur, copie_const->polys()->data() == maillage.polys()->data());
+}
+
+void test_stockage_externe(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	const glm::vec3 positions[2] = { glm::vec3(1.0f), glm::vec3(2.0f) };
+	auto proprietaire = std::make_shared<int>(0);
+
+	PointList points;
+	points.partage_externe(DISPOSITION_AOS, positions, 2, proprietaire);
+
+	const PointList &points_const = points;
+
+	/* Les lectures se font dans la mémoire externe, qui est gardée en vie. */
+	CU_VERIFIE_CONDITION(controleur, points_const.data() == positions);
+	CU_VERIFIE_CONDITION(controleur, points_const[1] == glm::vec3(2.0f));
+	CU_VERIFIE_CONDITION(controleur, proprietaire.use_count() == 2);
+
+	/* L'écriture duplique les points, la mémoire externe n'est pas modifiée
+	 * et son propriétaire est relâché. */
+	points[0] = glm::vec3(3.0f);
+
+	CU_VERIFIE_CONDITION(controleur, points_const.data() != positions);
+	CU_VERIFIE_CONDITION(controleur, positions[0] == glm::vec3(1.0f));
+	CU_VERIFIE_CONDITION(controleur, points_const[1] == glm::vec3(2.0f));
+	CU_VERIFIE_CONDITION(controleur, proprietaire.use_count() == 1);
+}
+
+void test_ecriture_polygones(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	/* Les polygones s'écrivent comme dans l'ancienne représentation. */
+	PolygonList polygones;
+	polygones.resize(3);
+
+	polygones[0] = glm::uvec4(0, 1, 2, 3);
+	polygones[1] = glm::uvec4(4, 5, 6, INVALID_INDEX);
+	polygones[2] = glm::uvec4(7, 8, 9, 10);
+
+	const PolygonList &polygones_const = polygones;
+
+	CU_VERIFIE_CONDITION(controleur, polygones.size() == 3);
+	CU_VERIFIE_CONDITION(controleur, polygones.nombre_index() == 11);
+	CU_VERIFIE_CONDITION(controleur, polygones.nombre_sommets(1) == 3);
+	CU_VERIFIE_CONDITION(controleur, polygones_const[1] == glm::uvec4(4, 5, 6, INVALID_INDEX));
+	CU_VERIFIE_CONDITION(controleur, polygones_const[2] == glm::uvec4(7, 8, 9, 10));
+	CU_VERIFIE_CONDITION(controleur, polygones[2][3] == 10);
+
+	/* Agrandir un polygone déplace les suivants, sans toucher aux copies. */
+	const auto copie = polygones;
+	polygones[1] = glm::uvec4(4, 5, 6, 11);
+
+	CU_VERIFIE_CONDITION(controleur, polygones_const[1] == glm::uvec4(4, 5, 6, 11));
+	CU_VERIFIE_CONDITION(controleur, polygones_const[2] == glm::uvec4(7, 8, 9, 10));
+	CU_VERIFIE_CONDITION(controleur, copie[1] == glm::uvec4(4, 5, 6, INVALID_INDEX));
+
+	polygones.resize(2);
+	polygones.push_back(glm::uvec4(1, 2, 3, INVALID_INDEX));
+
+	CU_VERIFIE_CONDITION(controleur, polygones.nombre_index() == 11);
+	CU_VERIFIE_CONDITION(controleur, polygones_const[2] == glm::uvec4(1, 2, 3, INVALID_INDEX));
+}
+
+void test_adjacence(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	/* Un quadrilatère et un triangle partageant l'arête (1, 2). */
+	Mesh maillage;
+
+	for (int i = 0; i < 5; ++i) {
+		maillage.points()->push_back(glm::vec3(static_cast<float>(i)));
+	}
+
+	const unsigned int quad[4] = { 0, 1, 2, 3 };
+	const unsigned int triangle[3] = { 2, 1, 4 };
+	maillage.polys()->ajoute_polygone(quad, 4);
+	maillage.polys()->ajoute_polygone(triangle, 3);
+
+	const auto adjacence = maillage.adjacence();
+
+	CU_VERIFIE_CONDITION(controleur, adjacence->nombre_polygones(1) == 2);
+	CU_VERIFIE_CONDITION(controleur, adjacence->nombre_polygones(4) == 1);
+	CU_VERIFIE_CONDITION(controleur, adjacence->aretes.size() == 6);
+
+	/* Seule l'arête partagée a des demi-arêtes opposées. */
+	CU_VERIFIE_CONDITION(controleur, adjacence->demi_aretes_opposees[1] == 4);
+	CU_VERIFIE_CONDITION(controleur, adjacence->demi_aretes_opposees[4] == 1);
+	CU_VERIFIE_CONDITION(controleur, adjacence->demi_aretes_opposees[0] == INVALID_INDEX);
+
+	/* Le cache est réutilisé, puis invalidé par tagUpdate(). */
+	CU_VERIFIE_CONDITION(controleur, maillage.adjacence() == adjacence);
+
+	maillage.tagUpdate();
+
+	CU_VERIFIE_CONDITION(controleur, maillage.adjacence() != adjacence);
+}
+
+void test_vue_triangles(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	/* Un pentagone, un polygone dégénéré sans triangle, puis un triangle. */
+	PointList points;
+
+	for (int i = 0; i < 7; ++i) {
+		points.push_back(glm::vec3(static_cast<float>(i), static_cast<float>(i * i), 0.0f));
+	}
+
+	PolygonList polygones;
+	const unsigned int pentagone[5] = { 0, 1, 2, 3, 4 };
+	const unsigned int segment[2] = { 4, 5 };
+	const unsigned int triangle[3] = { 6, 0, 2 };
+	polygones.ajoute_polygone(pentagone, 5);
+	polygones.ajoute_polygone(segment, 2);
+	polygones.ajoute_polygone(triangle, 3);
+
+	auto index = std::vector<unsigned int>{};
+	triangule_polygones(polygones, index);
+
+	const auto vue = VueTriangles(points, polygones);
+
+	CU_VERIFIE_CONDITION(controleur, vue.taille() == 4);
+	CU_VERIFIE_CONDITION(controleur, vue.polygone(2) == 0);
+	CU_VERIFIE_CONDITION(controleur, vue.polygone(3) == 2);
+
+	/* L'accès par index et le parcours d'une plage commençant au milieu d'un
+	 * polygone donnent les triangles de triangule_polygones(). */
+	for (size_t t = 0; t < vue.taille(); ++t) {
+		const auto sommets = vue.sommets(t);
+
+		CU_VERIFIE_CONDITION(controleur, sommets[0] == index[t * 3 + 0]);
+		CU_VERIFIE_CONDITION(controleur, sommets[1] == index[t * 3 + 1]);
+		CU_VERIFIE_CONDITION(controleur, sommets[2] == index[t * 3 + 2]);
+	}
+
+	vue.pour_chaque(tbb::blocked_range<size_t>(1, vue.taille()), [&](size_t t, const Triangle &tri)
+	{
+		CU_VERIFIE_CONDITION(controleur, tri.v0 == points[index[t * 3 + 0]]);
+		CU_VERIFIE_CONDITION(controleur, tri.v1 == points[index[t * 3 + 1]]);
+		CU_VERIFIE_CONDITION(controleur, tri.v2 == points[index[t * 3 + 2]]);
+	});
+}
+
+void test_cache_resultats(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	/* Les empreintes ne dépendent que des valeurs des propriétés. */
+	Persona persona;
+	persona.add_prop("taille", "Taille", property_type::prop_float);
+
+	const auto empreinte_initiale = persona.empreinte_proprietes();
+
+	persona.valeur_propriete_float("taille", 2.0f);
+	CU_VERIFIE_CONDITION(controleur, persona.empreinte_proprietes() != empreinte_initiale);
+
+	persona.valeur_propriete_float("taille", 0.0f);
+	CU_VERIFIE_CONDITION(controleur, persona.empreinte_proprietes() == empreinte_initiale);
+
+	/* Un budget pour deux collections d'un maillage de 100 points. */
+	PrimitiveCollection collection(nullptr);
+	auto maillage = new Mesh;
+	maillage->points()->resize(100);
+	collection.add(maillage);
+
+	const auto octets = collection.taille_octets();
+	CacheResultats cache(2 * octets);
+
+	auto avertissements = std::vector<std::string>{ "avertissement" };
+	cache.ajoute(1, 10, collection, avertissements);
+	cache.ajoute(2, 20, collection, {});
+
+	PrimitiveCollection resultat(nullptr);
+	CU_VERIFIE_CONDITION(controleur, cache.cherche(1, 10, resultat, avertissements));
+	CU_VERIFIE_CONDITION(controleur, resultat.primitives().size() == 1);
+	CU_VERIFIE_CONDITION(controleur, avertissements.size() == 1);
+
+	/* Les tampons sont partagés avec la collection mise en cache. */
+	const auto copie = static_cast<const Mesh *>(resultat.primitives()[0]);
+	CU_VERIFIE_CONDITION(controleur, copie->points()->data() == maillage->points()->data());
+
+	/* 1 vient d'être utilisée : ajouter 3 supprime 2. */
+	cache.ajoute(3, 30, collection, {});
+
+	CU_VERIFIE_CONDITION(controleur, !cache.cherche(2, 20, resultat, avertissements));
+	CU_VERIFIE_CONDITION(controleur, cache.cherche(1, 10, resultat, avertissements));
+	CU_VERIFIE_CONDITION(controleur, resultat.primitives().size() == 1);
+
+	/* Une empreinte en collision avec une autre n'en prend pas le résultat. */
+	CU_VERIFIE_CONDITION(controleur, !cache.cherche(1, 11, resultat, avertissements));
+
+	const auto stats = cache.statistiques();
+	CU_VERIFIE_CONDITION(controleur, stats.succes == 2);
+	CU_VERIFIE_CONDITION(controleur, stats.echecs == 2);
+	CU_VERIFIE_CONDITION(controleur, stats.evictions == 1);
+	CU_VERIFIE_CONDITION(controleur, stats.octets == 2 * octets);
+}
+
+/* Opérateur sans entrée comptant ses exécutions, partagé par deux branches. */
+class OperateurSource : public Operateur {
+public:
+	std::atomic<int> executions{0};
+	int nombre_primitives = 1;
+	bool deterministe = true;
+
+	OperateurSource(Noeud *noeud, const Context &contexte)
+	    : Operateur(noeud, contexte)
+	{
+		sorties(1);
+	}
+
+	/* Dynamique, pour que son résultat ne soit pas repris du cache. */
+	type_operateur type() const override
+	{
+		return DYNAMIQUE;
+	}
+
+	const char *nom() override
+	{
+		return "Source";
+	}
+
+	bool resultat_deterministe() const override
+	{
+		return deterministe;
+	}
+
+	void execute(const Context &/*contexte*/, double /*temps*/) override
+	{
+		++executions;
+		m_collection->free_all();
+
+		for (int i = 0; i < nombre_primitives; ++i) {
+			m_collection->add(new Mesh);
+		}
+	}
+};
+
+class OperateurBranche : public Operateur {
+public:
+	OperateurBranche(Noeud *noeud, const Context &contexte)
+	    : Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
+	{
+		entrees(1);
+		sorties(1);
+	}
+
+	const char *nom() override
+	{
+		return "Branche";
+	}
+
+	void execute(const Context &contexte, double temps) override
+	{
+		entree(0)->requiers_collection(m_collection, contexte, temps);
+	}
+};
+
+class OperateurJonction : public Operateur {
+public:
+	OperateurJonction(Noeud *noeud, const Context &contexte)
+	    : Operateur(noeud, contexte, RESULTAT_DETERMINISTE)
+	{
+		entrees(2);
+		sorties(1);
+	}
+
+	const char *nom() override
+	{
+		return "Jonction";
+	}
+
+	void execute(const Context &contexte, double temps) override
+	{
+		PrimitiveCollection *collections[2] = { m_collection, nullptr };
+		requiers_collections_paralleles(collections, 2, contexte, temps);
+
+		if (collections[1] != nullptr) {
+			m_collection->merge_collection(*collections[1]);
+		}
+	}
+};
+
+static void connecte_noeuds(Noeud &de, Noeud &a, int entree)
+{
+	a.entree(entree)->lien = de.sortie(0);
+	de.sortie(0)->liens.push_back(a.entree(entree));
+}
+
+void test_branches_paralleles(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	/* Graphe en losange : la source alimente deux branches, évaluées en
+	 * parallèle par la jonction. */
+	Context contexte{};
+	Noeud source, gauche, droite, jonction;
+
+	auto operateur_source = new OperateurSource(&source, contexte);
+	new OperateurBranche(&gauche, contexte);
+	new OperateurBranche(&droite, contexte);
+	auto operateur_jonction = new OperateurJonction(&jonction, contexte);
+
+	for (auto noeud : { &source, &gauche, &droite, &jonction }) {
+		noeud->synchronise_donnees();
+	}
+
+	connecte_noeuds(source, gauche, 0);
+	connecte_noeuds(source, droite, 0);
+	connecte_noeuds(gauche, jonction, 0);
+	connecte_noeuds(droite, jonction, 1);
+
+	execute_operateur(operateur_jonction, contexte, 0.0);
+
+	/* La source n'est exécutée qu'une fois, et son résultat atteint la
+	 * jonction par les deux branches. */
+	CU_VERIFIE_CONDITION(controleur, operateur_source->executions == 1);
+	CU_VERIFIE_CONDITION(controleur, operateur_jonction->collection()->primitives().size() == 2);
+}
+
+void test_empreintes_losanges(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	/* Une pile de losanges : sans garder les empreintes, celle du sommet
+	 * parcourrait 2^64 chemins. */
+	static constexpr int NOMBRE_LOSANGES = 64;
+
+	Context contexte{};
+	Noeud racine;
+	Noeud jonctions[NOMBRE_LOSANGES];
+
+	new OperateurBranche(&racine, contexte);
+	racine.synchronise_donnees();
+
+	Noeud *precedent = &racine;
+	Operateur *sommet = nullptr;
+
+	for (auto &jonction : jonctions) {
+		sommet = new OperateurJonction(&jonction, contexte);
+		jonction.synchronise_donnees();
+
+		connecte_noeuds(*precedent, jonction, 0);
+		connecte_noeuds(*precedent, jonction, 1);
+		precedent = &jonction;
+	}
+
+	PorteeEmpreintes portee;
+
+	const auto empreinte = sommet->empreinte();
+
+	CU_VERIFIE_CONDITION(controleur, empreinte != EMPREINTE_INVALIDE);
+	CU_VERIFIE_CONDITION(controleur, sommet->empreinte_configuration() == empreinte);
+	CU_VERIFIE_CONDITION(controleur, sommet->empreinte() == empreinte);
+}
+
+void test_annulation(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	JetonAnnulation jeton;
+	Context contexte{};
+	contexte.annulation = &jeton;
+
+	Noeud source, branche;
+
+	auto operateur_source = new OperateurSource(&source, contexte);
+	auto operateur_branche = new OperateurBranche(&branche, contexte);
+
+	for (auto noeud : { &source, &branche }) {
+		noeud->synchronise_donnees();
+	}
+
+	connecte_noeuds(source, branche, 0);
+
+	/* Une évaluation annulée n'exécute rien, et reste à faire. */
+	jeton.annule();
+	execute_operateur(operateur_branche, contexte, 0.0);
+
+	CU_VERIFIE_CONDITION(controleur, operateur_source->executions == 0);
+	CU_VERIFIE_CONDITION(controleur, operateur_branche->besoin_execution());
+
+	jeton.reinitialise();
+	execute_operateur(operateur_branche, contexte, 0.0);
+
+	CU_VERIFIE_CONDITION(controleur, operateur_source->executions == 1);
+	CU_VERIFIE_CONDITION(controleur, !operateur_branche->besoin_execution());
+	CU_VERIFIE_CONDITION(controleur, operateur_branche->collection()->primitives().size() == 1);
+}
+
+void test_statistiques(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	Context contexte{};
+	Noeud source, branche;
+
+	new OperateurSource(&source, contexte);
+	auto operateur_branche = new OperateurBranche(&branche, contexte);
+
+	for (auto noeud : { &source, &branche }) {
+		noeud->synchronise_donnees();
+	}
+
+	connecte_noeuds(source, branche, 0);
+
+	execute_operateur(operateur_branche, contexte, 0.0);
+
+	auto stats = operateur_branche->statistiques();
+	CU_VERIFIE_CONDITION(controleur, stats.nombre_executions == 1);
+	CU_VERIFIE_CONDITION(controleur, stats.primitives_entree == 1);
+	CU_VERIFIE_CONDITION(controleur, stats.primitives_sortie == 1);
+	CU_VERIFIE_CONDITION(controleur, stats.temps_min >= 0.0);
+	CU_VERIFIE_CONDITION(controleur, stats.temps_median <= stats.temps_max);
+
+	/* Les anciens accesseurs lisent les statistiques. */
+	CU_VERIFIE_CONDITION(controleur, operateur_branche->nombre_executions() == 1);
+	CU_VERIFIE_CONDITION(controleur, operateur_branche->temps_execution() == stats.temps_dernier);
+	CU_VERIFIE_CONDITION(controleur, operateur_branche->min_temps_execution() == stats.temps_min);
+	CU_VERIFIE_CONDITION(controleur, operateur_branche->temps_agrege() == stats.temps_agrege_dernier);
+	CU_VERIFIE_CONDITION(controleur, stats.temps_agrege_dernier >= stats.temps_dernier);
+
+	/* Le résultat repris du cache compte dans le temps agrégé, dont le
+	 * minimum est celui de toutes les évaluations. */
+	Noeud seul;
+	auto operateur_seul = new OperateurBranche(&seul, contexte);
+	seul.synchronise_donnees();
+
+	execute_operateur(operateur_seul, contexte, 0.0);
+	operateur_seul->besoin_execution(true);
+	execute_operateur(operateur_seul, contexte, 0.0);
+
+	stats = operateur_seul->statistiques();
+	CU_VERIFIE_CONDITION(controleur, stats.nombre_executions == 1);
+	CU_VERIFIE_CONDITION(controleur, stats.succes_cache == 1);
+	CU_VERIFIE_CONDITION(controleur, stats.temps_agrege_min <= stats.temps_agrege_dernier);
+	CU_VERIFIE_CONDITION(controleur, operateur_seul->min_temps_agrege() == stats.temps_agrege_min);
+
+	operateur_branche->reinitialise_statistiques();
+
+	stats = operateur_branche->statistiques();
+	CU_VERIFIE_CONDITION(controleur, stats.nombre_executions == 0);
+	CU_VERIFIE_CONDITION(controleur, operateur_branche->min_temps_execution() == 0.0);
+}
+
+/* Opérateur modifiant une copie d'un maillage dont il partage les tampons. */
+class OperateurEcriture : public Operateur {
+public:
+	Mesh original{};
+
+	OperateurEcriture(Noeud *noeud, const Context &contexte)
+	    : Operateur(noeud, contexte)
+	{
+		entrees(1);
+		sorties(1);
+
+		for (int i = 0; i < 100; ++i) {
+			original.points()->push_back(glm::vec3(static_cast<float>(i)));
+		}
+	}
+
+	const char *nom() override
+	{
+		return "Écriture";
+	}
+
+	void execute(const Context &contexte, double temps) override
+	{
+		entree(0)->requiers_collection(m_collection, contexte, temps);
+
+		auto copie = static_cast<Mesh *>(original.copy());
+		m_collection->add(copie);
+
+		(*copie->points())[0] = glm::vec3(-1.0f);
+
+		/* Agrandit le tampon, qui n'est plus partagé. */
+		copie->points()->push_back(glm::vec3(100.0f));
+	}
+};
+
+void test_octets_dupliques(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	Context contexte{};
+	Noeud source, ecriture;
+
+	auto operateur_source = new OperateurSource(&source, contexte);
+	auto operateur_ecriture = new OperateurEcriture(&ecriture, contexte);
+
+	for (auto noeud : { &source, &ecriture }) {
+		noeud->synchronise_donnees();
+	}
+
+	connecte_noeuds(source, ecriture, 0);
+
+	execute_operateur(operateur_ecriture, contexte, 0.0);
+
+	/* Seule la duplication des points partagés est comptée, pas leur
+	 * agrandissement, et seulement pour l'opérateur qui les a dupliqués. */
+	CU_VERIFIE_CONDITION(controleur, operateur_ecriture->statistiques().octets_dupliques_dernier == 100 * sizeof(glm::vec3));
+	CU_VERIFIE_CONDITION(controleur, operateur_source->statistiques().octets_dupliques_dernier == 0);
+}
+
+void test_cache_images(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	auto scene = Scene();
+
+	Context contexte{};
+	contexte.scene = &scene;
+
+	auto objet = new Object(contexte);
+	scene.addObject(objet);
+
+	auto noeud = new Noeud;
+	auto operateur_source = new OperateurSource(noeud, contexte);
+	noeud->synchronise_donnees();
+
+	objet->graph()->ajoute(noeud);
+	objet->graph()->connecte(noeud->sortie(0), objet->graph()->sortie()->entree(0));
+
+	ObjectGraphDepsNode *noeud_graphe = nullptr;
+
+	for (const auto &noeud_deps : scene.depsgraph()->nodes()) {
+		if (dynamic_cast<ObjectGraphDepsNode *>(noeud_deps.get()) != nullptr) {
+			noeud_graphe = static_cast<ObjectGraphDepsNode *>(noeud_deps.get());
+		}
+	}
+
+	CU_VERIFIE_CONDITION(controleur, noeud_graphe != nullptr);
+
+	for (int image = 1; image <= 3; ++image) {
+		scene.currentFrame(image);
+		scene.updateForNewFrame(contexte);
+	}
+
+	CU_VERIFIE_CONDITION(controleur, operateur_source->executions == 3);
+
+	/* Revenir sur des images déjà évaluées les reprend du cache. */
+	for (int image : { 1, 2 }) {
+		scene.currentFrame(image);
+		scene.updateForNewFrame(contexte);
+	}
+
+	CU_VERIFIE_CONDITION(controleur, operateur_source->executions == 3);
+	CU_VERIFIE_CONDITION(controleur, objet->graph()->sortie()->operateur()->collection()->primitives().size() == 1);
+
+	/* Une fois le graphe modifié, les images en cache ne servent plus. */
+	noeud_graphe->invalidate_frame_cache();
+
+	scene.currentFrame(1);
+	scene.updateForNewFrame(contexte);
+
+	CU_VERIFIE_CONDITION(controleur, operateur_source->executions == 4);
+
+	/* Un autre objet dont le graphe a la même configuration, mais un autre
+	 * résultat, ne reprend pas les images du premier. */
+	auto autre_objet = new Object(contexte);
+	scene.addObject(autre_objet);
+
+	auto autre_noeud = new Noeud;
+	auto autre_source = new OperateurSource(autre_noeud, contexte);
+	autre_source->nombre_primitives = 2;
+	autre_noeud->synchronise_donnees();
+
+	autre_objet->graph()->ajoute(autre_noeud);
+	autre_objet->graph()->connecte(autre_noeud->sortie(0), autre_objet->graph()->sortie()->entree(0));
+
+	for (int image : { 2, 1 }) {
+		scene.currentFrame(image);
+		scene.updateForNewFrame(contexte);
+	}
+
+	CU_VERIFIE_CONDITION(controleur, objet->graph()->sortie()->operateur()->collection()->primitives().size() == 1);
+	CU_VERIFIE_CONDITION(controleur, autre_objet->graph()->sortie()->operateur()->collection()->primitives().size() == 2);
+
+	/* Un opérateur non déterministe, par exemple une simulation gardant son
+	 * état d'une image à l'autre, est exécuté à chaque image. */
+	operateur_source->deterministe = false;
+	noeud_graphe->invalidate_frame_cache();
+
+	const int executions = operateur_source->executions;
+
+	for (int image : { 1, 2, 1 }) {
+		scene.currentFrame(image);
+		scene.updateForNewFrame(contexte);
+	}
+
+	CU_VERIFIE_CONDITION(controleur, operateur_source->executions == executions + 3);
+}
+
+void test_publication_collections(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	auto scene = Scene();
+
+	Context contexte{};
+	contexte.scene = &scene;
+
+	auto objet = new Object(contexte);
+	scene.addObject(objet);
+
+	/* Sans réaffichage, les collections jamais affichées sont libérées à la
+	 * publication suivante. */
+	auto premiere = std::make_shared<PrimitiveCollection>(contexte.primitive_factory);
+	auto temoin = std::weak_ptr<PrimitiveCollection>(premiere);
+
+	objet->publie_collection(std::move(premiere));
+
+	for (int i = 0; i < 3; ++i) {
+		objet->publie_collection(std::make_shared<PrimitiveCollection>(contexte.primitive_factory));
+	}
+
+	CU_VERIFIE_CONDITION(controleur, temoin.expired());
+
+	/* La collection affichée reste valide jusqu'au prochain appel à
+	 * collection(), quel que soit le nombre de publications. */
+	const auto affichee = objet->collection();
+
+	objet->publie_collection(std::make_shared<PrimitiveCollection>(contexte.primitive_factory));
+	objet->publie_collection(std::make_shared<PrimitiveCollection>(contexte.primitive_factory));
+
+	CU_VERIFIE_CONDITION(controleur, affichee != nullptr);
+	CU_VERIFIE_CONDITION(controleur, affichee->primitives().empty());
+	CU_VERIFIE_CONDITION(controleur, objet->collection() != affichee);
+}
+
+void test_cache_disque(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	PrimitiveFactory usine;
+	auto factory = &usine;
+	Mesh::id = REGISTER_PRIMITIVE("Mesh", Mesh);
+
+	const auto dossier = filesystem::temp_directory_path() / (
+	                         "kamikaze_test_cache_"
+	                         + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+
+	PrimitiveCollection collection(&usine);
+	auto maillage = static_cast<Mesh *>(collection.build("Mesh"));
+
+	for (int i = 0; i < 4; ++i) {
+		maillage->points()->push_back(glm::vec3(static_cast<float>(i)));
+	}
+
+	/* Un triangle et un quadrilatère : les polygones ont des décalages. */
+	maillage->polys()->push_back(glm::uvec4(0, 1, 2, INVALID_INDEX));
+	maillage->polys()->push_back(glm::uvec4(0, 2, 3, 1));
+
+	auto couleur = maillage->add_attribute("couleur", ATTR_TYPE_VEC3, 4);
+
+	/* Seuls les points et les attributs changent d'une image à l'autre. */
+	{
+		kamikaze::EcrivainCache ecrivain(dossier);
+
+		for (int image = 1; image <= 3; ++image) {
+			(*maillage->points())[0] = glm::vec3(static_cast<float>(image));
+			couleur->vec3(0, glm::vec3(static_cast<float>(image)));
+
+			CU_VERIFIE_CONDITION(controleur, ecrivain.ecris_image(image, collection) == kamikaze::AUCUNE_ERREUR);
+		}
+	}
+
+	kamikaze::LecteurCache lecteur(dossier);
+	std::vector<std::unique_ptr<PrimitiveCollection>> images;
+
+	for (int image = 1; image <= 3; ++image) {
+		images.emplace_back(new PrimitiveCollection(&usine));
+		auto &lue = *images.back();
+
+		CU_VERIFIE_CONDITION(controleur, lecteur.charge_image(image, lue) == kamikaze::AUCUNE_ERREUR);
+		CU_VERIFIE_CONDITION(controleur, lue.primitives().size() == 1);
+
+		const auto maillage_lu = static_cast<const Mesh *>(lue.primitives()[0]);
+		CU_VERIFIE_CONDITION(controleur, maillage_lu->points()->size() == 4);
+		CU_VERIFIE_CONDITION(controleur, (*maillage_lu->points())[0] == glm::vec3(static_cast<float>(image)));
+		CU_VERIFIE_CONDITION(controleur, (*maillage_lu->points())[3] == glm::vec3(3.0f));
+		CU_VERIFIE_CONDITION(controleur, maillage_lu->polys()->size() == 2);
+		CU_VERIFIE_CONDITION(controleur, (*maillage_lu->polys())[0] == glm::uvec4(0, 1, 2, INVALID_INDEX));
+		CU_VERIFIE_CONDITION(controleur, (*maillage_lu->polys())[1] == glm::uvec4(0, 2, 3, 1));
+
+		auto couleur_lue = lue.primitives()[0]->attribute("couleur", ATTR_TYPE_VEC3);
+		CU_VERIFIE_CONDITION(controleur, couleur_lue != nullptr);
+		CU_VERIFIE_CONDITION(controleur, couleur_lue->vec3(0) == glm::vec3(static_cast<float>(image)));
+	}
+
+	/* La topologie n'est écrite que dans le fichier de la première image, vers
+	 * lequel renvoient les suivantes. */
+	const auto premier = static_cast<const Mesh *>(images[0]->primitives()[0]);
+
+	for (int i = 1; i < 3; ++i) {
+		const auto suivant = static_cast<const Mesh *>(images[i]->primitives()[0]);
+		CU_VERIFIE_CONDITION(controleur, suivant->polys()->data() == premier->polys()->data());
+		CU_VERIFIE_CONDITION(controleur, suivant->points()->data() != premier->points()->data());
+	}
+
+	/* Un fichier renvoyant vers celui d'un autre précalcul est rejeté. */
+	{
+		kamikaze::EcrivainCache ecrivain(dossier);
+		CU_VERIFIE_CONDITION(controleur, ecrivain.ecris_image(1, collection) == kamikaze::AUCUNE_ERREUR);
+	}
+
+	kamikaze::LecteurCache autre_lecteur(dossier);
+	PrimitiveCollection lue(&usine);
+
+	CU_VERIFIE_CONDITION(controleur, autre_lecteur.charge_image(2, lue) == kamikaze::CORROMPU);
+	CU_VERIFIE_CONDITION(controleur, lue.primitives().empty());
+
+	/* Les index sont vérifiés avant d'être partagés. */
+	maillage->polys()->push_back(glm::uvec4(0, 1, 9, INVALID_INDEX));
+
+	{
+		kamikaze::EcrivainCache ecrivain(dossier);
+		CU_VERIFIE_CONDITION(controleur, ecrivain.ecris_image(4, collection) == kamikaze::AUCUNE_ERREUR);
+	}
+
+	CU_VERIFIE_CONDITION(controleur, autre_lecteur.charge_image(4, lue) == kamikaze::CORROMPU);
+	CU_VERIFIE_CONDITION(controleur, lue.primitives().empty());
+
+	images.clear();
+
+	std::error_code erreur;
+	filesystem::remove_all(dossier, erreur);
+}
+
+/* Accès à l'état interne du graphe de dépendances. */
+class DepsgraphTester {
+public:
+	static DepsNode *noeud_graphe(Depsgraph &graphe, Object *objet)
+	{
+		return graphe.find_node(objet, true);
+	}
+
+	static DepsNode *noeud_objet(Depsgraph &graphe, Object *objet)
+	{
+		return graphe.m_scene_node_map[objet];
+	}
+
+	static DepsNode *noeud_temps(Depsgraph &graphe)
+	{
+		return graphe.m_time_node;
+	}
+
+	static size_t position(const DepsNode *noeud)
+	{
+		return noeud->m_order_index;
+	}
+
+	static std::vector<DepsNode *> ordre(Depsgraph &graphe)
+	{
+		return graphe.m_order;
+	}
+
+	/* Vérifie que l'ordre est topologique, et que les positions des noeuds
+	 * sont à jour. */
+	static bool ordre_valide(Depsgraph &graphe)
+	{
+		for (size_t i = 0; i < graphe.m_order.size(); ++i) {
+			if (graphe.m_order[i]->m_order_index != i) {
+				return false;
+			}
+		}
+
+		for (const auto &noeud : graphe.nodes()) {
+			for (DepsInputSocket *lien : noeud->output()->links) {
+				if (lien->parent->m_order_index <= noeud->m_order_index) {
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	static bool aucun_visite(Depsgraph &graphe)
+	{
+		for (const auto &noeud : graphe.nodes()) {
+			if (noeud->m_visited) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/* Retourne les noeuds que la prochaine passe évaluera. */
+	static std::vector<DepsNode *> noeuds_sales(Depsgraph &graphe)
+	{
+		std::unique_lock<std::mutex> verrou(graphe.m_mutex);
+		return graphe.m_dirty_nodes;
+	}
+
+	static void marque(Depsgraph &graphe, DepsNode *noeud)
+	{
+		std::unique_lock<std::mutex> verrou(graphe.m_mutex);
+		graphe.tag_update(noeud);
+	}
+
+	/* Oublie les noeuds sales, comme si une passe les avait évalués. */
+	static void nettoie(Depsgraph &graphe)
+	{
+		std::unique_lock<std::mutex> verrou(graphe.m_mutex);
+
+		for (DepsNode *noeud : graphe.m_dirty_nodes) {
+			noeud->m_dirty = false;
+		}
+
+		graphe.m_dirty_nodes.clear();
+	}
+};
+
+void test_ordre_depsgraph(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	auto scene = Scene();
+
+	Context contexte{};
+	contexte.scene = &scene;
+
+	Object *objets[3];
+
+	for (auto &objet : objets) {
+		objet = new Object(contexte);
+		scene.addObject(objet);
+	}
+
+	auto graphe = scene.depsgraph();
+	auto a = objets[0], b = objets[1], c = objets[2];
+
+	CU_VERIFIE_CONDITION(controleur, DepsgraphTester::ordre_valide(*graphe));
+
+	/* C a été ajouté après A : le lien va contre l'ordre, qui est corrigé. */
+	const auto graphe_a = DepsgraphTester::noeud_graphe(*graphe, a);
+
+	CU_VERIFIE_CONDITION(controleur, DepsgraphTester::position(DepsgraphTester::noeud_objet(*graphe, c))
+	                                 > DepsgraphTester::position(graphe_a));
+
+	graphe->connect(c, a);
+
+	CU_VERIFIE_CONDITION(controleur, DepsgraphTester::ordre_valide(*graphe));
+	CU_VERIFIE_CONDITION(controleur, graphe_a->input()->links.size() == 1);
+	CU_VERIFIE_CONDITION(controleur, DepsgraphTester::aucun_visite(*graphe));
+
+	graphe->connect(a, b);
+
+	CU_VERIFIE_CONDITION(controleur, DepsgraphTester::ordre_valide(*graphe));
+
+	/* B dépend de C par A : le lien inverse formerait un cycle, il est refusé
+	 * sans toucher à l'ordre. */
+	const auto ordre = DepsgraphTester::ordre(*graphe);
+	const auto graphe_c = DepsgraphTester::noeud_graphe(*graphe, c);
+	const auto liens_c = graphe_c->input()->links.size();
+
+	graphe->connect(b, c);
+
+	CU_VERIFIE_CONDITION(controleur, DepsgraphTester::ordre(*graphe) == ordre);
+	CU_VERIFIE_CONDITION(controleur, graphe_c->input()->links.size() == liens_c);
+	CU_VERIFIE_CONDITION(controleur, DepsgraphTester::aucun_visite(*graphe));
+
+	/* Seuls le noeud modifié et ceux en aval sont évalués par la passe
+	 * suivante. */
+	DepsgraphTester::nettoie(*graphe);
+	DepsgraphTester::marque(*graphe, graphe_a);
+
+	auto sales = DepsgraphTester::noeuds_sales(*graphe);
+	std::sort(sales.begin(), sales.end());
+
+	auto attendus = std::vector<DepsNode *>{
+	        graphe_a,
+	        DepsgraphTester::noeud_objet(*graphe, a),
+	        DepsgraphTester::noeud_graphe(*graphe, b),
+	        DepsgraphTester::noeud_objet(*graphe, b),
+	};
+
+	std::sort(attendus.begin(), attendus.end());
+
+	CU_VERIFIE_CONDITION(controleur, sales == attendus);
+	CU_VERIFIE_CONDITION(controleur, std::find(sales.begin(), sales.end(), graphe_c) == sales.end());
+	CU_VERIFIE_CONDITION(controleur, std::find(sales.begin(), sales.end(), DepsgraphTester::noeud_temps(*graphe)) == sales.end());
+}
+
+void test_trace(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	{
+		/* Rien n'est enregistré tant que la trace n'est pas active. */
+		PorteeTrace trace("test", "Inactive");
+	}
+
+	active_trace(true);
+	vide_trace();
+
+	{
+		PorteeTrace trace("test", "Nom \"entre guillemets\"", 7);
+
+		std::thread thread([]()
+		{
+			PorteeTrace trace_thread("test", "Autre thread");
+		});
+
+		thread.join();
+	}
+
+	active_trace(false);
+
+	const auto chemin = filesystem::temp_directory_path() / (
+	                        "kamikaze_test_trace_"
+	                        + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+	                        + ".json");
+
+	CU_VERIFIE_CONDITION(controleur, ecris_trace_chrome(chemin.string()));
+
+	std::ifstream fichier(chemin.c_str());
+	std::stringstream ss;
+	ss << fichier.rdbuf();
+	const auto json = ss.str();
+
+	fichier.close();
+
+	std::error_code erreur;
+	filesystem::remove(chemin, erreur);
+
+	CU_VERIFIE_CONDITION(controleur, json.find("Inactive") == std::string::npos);
+	CU_VERIFIE_CONDITION(controleur, json.find("\"name\":\"Nom \\\"entre guillemets\\\"\"") != std::string::npos);
+	CU_VERIFIE_CONDITION(controleur, json.find("\"args\":{\"valeur\":7}") != std::string::npos);
+	CU_VERIFIE_CONDITION(controleur, json.find("Autre thread") != std::string::npos);
+}
+
+void test_bruit_par_lots(numero7::test_unitaire::ControleurUnitaire &controleur)
+{
+	/* Un nombre de positions qui n'est pas multiple de la taille des lots,
+	 * avec des coordonnées négatives. */
+	std::vector<glm::vec3> positions;
+
+	for (int i = 0; i < 1001; ++i) {
+		const auto f = static_cast<float>(i);
+		positions.push_back(glm::vec3(f * 0.37f - 150.0f, f * -0.11f, f * 0.73f - 2.5f));
+	}
+
+	const auto nombre = positions.size();
+	std::vector<float> valeurs(nombre);
+
+	const auto verifie = [&](auto &&bruit_ponctuel)
+	{
+		auto ecart = 0.0f;
+
+		for (size_t i = 0; i < nombre; ++i) {
+			const auto &p = positions[i];
+			ecart = std::max(ecart, std::abs(bruit_ponctuel(p.x, p.y, p.z) - valeurs[i]));
+		}
+
+		CU_VERIFIE_CONDITION(controleur, ecart <= TOLERANCE_BRUIT_LOT);
+	};
+
+	bruit_simplex_3d(positions.data(), valeurs.data(), nombre);
+	verifie([](float x, float y, float z) { return bruit_simplex_3d(x, y, z); });
+
+	BruitPerlin3D perlin;
+	perlin(positions.data(), valeurs.data(), nombre);
+	verifie([&](float x, float y, float z) { return perlin(x, y, z); });
+
+	BruitFlux3D flux;
+	flux.change_temps(0.5f);
+	flux(positions.data(), valeurs.data(), nombre);
+	verifie([&](float x, float y, float z) { return flux(x, y, z); });
+}
+
 int main()
 {
 	numero7::test_unitaire::ControleurUnitaire controlleur;
 
 	controlleur.ajoute_fonction(test_lecture_fichier);
+	controlleur.ajoute_fonction(test_copie_sur_ecriture);
+	controlleur.ajoute_fonction(test_stockage_externe);
+	controlleur.ajoute_fonction(test_ecriture_polygones);
+	controlleur.ajoute_fonction(test_adjacence);
+	controlleur.ajoute_fonction(test_vue_triangles);
+	controlleur.ajoute_fonction(test_cache_resultats);
+	controlleur.ajoute_fonction(test_branches_paralleles);
+	controlleur.ajoute_fonction(test_empreintes_losanges);
+	controlleur.ajoute_fonction(test_annulation);
+	controlleur.ajoute_fonction(test_statistiques);
+	controlleur.ajoute_fonction(test_octets_dupliques);
+	controlleur.ajoute_fonction(test_cache_images);
+	controlleur.ajoute_fonction(test_publication_collections);
+	controlleur.ajoute_fonction(test_cache_disque);
+	controlleur.ajoute_fonction(test_ordre_depsgraph);
+	controlleur.ajoute_fonction(test_trace);
+	controlleur.ajoute_fonction(test_bruit_par_lots);
 
 	controlleur.performe_controles();
 	controlleur.imprime_resultat();
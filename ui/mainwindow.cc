@@ -24,7 +24,9 @@
 
 #include "mainwindow.h"
 
+#include <kamikaze/operateur.h>
 #include <kamikaze/primitive.h>
+#include <kamikaze/trace.h>
 
 #include <QDockWidget>
 #include <QMessageBox>
@@ -138,6 +140,11 @@ void MainWindow::generateObjectMenu()
 	action->setData(QVariant::fromValue(QString("add object")));
 
 	connect(action, SIGNAL(triggered()), this, SLOT(handleCommand()));
+
+	auto menu_precalcul = menuBar()->addMenu("Bake");
+	action = menu_precalcul->addAction("Bake Active Object");
+
+	connect(action, SIGNAL(triggered()), this, SLOT(precalcule_objet()));
 }
 
 void MainWindow::generateDebugMenu()
@@ -155,6 +162,33 @@ void MainWindow::generateDebugMenu()
 	action->setData(QVariant::fromValue(QString("dump_object_graph")));
 
 	connect(action, SIGNAL(triggered()), this, SLOT(dumpGraph()));
+
+	action = m_add_object_menu->addAction("Dump Dependency Graph Statistics");
+	action->setData(QVariant::fromValue(QString("dump_dependency_graph_statistics")));
+
+	connect(action, SIGNAL(triggered()), this, SLOT(dumpGraph()));
+
+	action = m_add_object_menu->addAction("Dump Object Graph Statistics");
+	action->setData(QVariant::fromValue(QString("dump_object_graph_statistics")));
+
+	connect(action, SIGNAL(triggered()), this, SLOT(dumpGraph()));
+
+	m_add_object_menu->addSeparator();
+
+	action = m_add_object_menu->addAction("Record Evaluation Trace");
+	action->setCheckable(true);
+
+	connect(action, SIGNAL(toggled(bool)), this, SLOT(recordTrace(bool)));
+
+	action = m_add_object_menu->addAction("Write Evaluation Trace");
+	action->setData(QVariant::fromValue(QString("write_trace")));
+
+	connect(action, SIGNAL(triggered()), this, SLOT(dumpGraph()));
+
+	action = m_add_object_menu->addAction("Reset Operator Statistics");
+	action->setData(QVariant::fromValue(QString("reset_statistics")));
+
+	connect(action, SIGNAL(triggered()), this, SLOT(dumpGraph()));
 }
 
 void MainWindow::generateNodeMenu()
@@ -575,6 +609,81 @@ void MainWindow::dumpGraph()
 			std::cerr << "Cannot create graph image from dot\n";
 		}
 	}
+	else if (data == "dump_object_graph_statistics") {
+		auto scene_node = scene->active_node();
+
+		if (!scene_node) {
+			return;
+		}
+
+		auto object = static_cast<Object *>(scene_node);
+
+		GraphDumper gd(object->graph());
+		gd.show_statistics(true);
+		gd("/tmp/object_graph_statistics.gv");
+		gd.dump_json("/tmp/object_graph_statistics.json");
+
+		if (system("dot /tmp/object_graph_statistics.gv -Tpng -o object_graph_statistics.png") == -1) {
+			std::cerr << "Cannot create graph image from dot\n";
+		}
+	}
+	else if (data == "dump_dependency_graph_statistics") {
+		DepsGraphDumper gd(scene->depsgraph());
+		gd.show_statistics(true);
+		gd("/tmp/depsgraph_statistics.gv");
+		gd.dump_json("/tmp/depsgraph_statistics.json");
+
+		if (system("dot /tmp/depsgraph_statistics.gv -Tpng -o depsgraph_statistics.png") == -1) {
+			std::cerr << "Cannot create graph image from dot\n";
+		}
+	}
+	else if (data == "reset_statistics") {
+		for (const auto &node : scene->nodes()) {
+			auto object = static_cast<Object *>(node.get());
+
+			for (const auto &noeud : object->graph()->noeuds()) {
+				noeud->operateur()->reinitialise_statistiques();
+			}
+		}
+	}
+	else if (data == "write_trace") {
+		/* To be opened in chrome://tracing or ui.perfetto.dev. */
+		if (!ecris_trace_chrome("/tmp/kamikaze_trace.json")) {
+			std::cerr << "Cannot write trace to /tmp/kamikaze_trace.json\n";
+		}
+	}
+}
+
+void MainWindow::recordTrace(bool yesno)
+{
+	/* Start a new trace. */
+	if (yesno) {
+		vide_trace();
+	}
+
+	active_trace(yesno);
+}
+
+void MainWindow::precalcule_objet()
+{
+	auto scene = m_context.scene;
+	auto scene_node = scene->active_node();
+
+	if (!scene_node) {
+		return;
+	}
+
+	auto object = static_cast<Object *>(scene_node);
+
+	if (object->eval_string("bake_directory").empty()) {
+		QMessageBox::critical(this, "Error", "L'objet n'a pas de dossier de précalcul !");
+		return;
+	}
+
+	/* Le précalcul est fait dans une tâche, et réévalue l'objet à sa fin. */
+	if (!scene->depsgraph()->bake(m_context, object, scene->startFrame(), scene->endFrame())) {
+		QMessageBox::critical(this, "Error", "Un précalcul est déjà en cours !");
+	}
 }
 
 void MainWindow::closeEvent(QCloseEvent *)
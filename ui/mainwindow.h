@@ -111,4 +111,7 @@ private Q_SLOTS:
 	void addPropertiesWidget();
 
 	void dumpGraph();
+	void recordTrace(bool yesno);
+
+	void precalcule_objet();
 };
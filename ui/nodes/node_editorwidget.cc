@@ -464,17 +464,27 @@ bool QtNodeEditor::mouseClickHandler(QGraphicsSceneMouseEvent *mouseEvent)
 
 			if (noeud != nullptr) {
 				auto operateur = noeud->operateur();
+				const auto stats = operateur->statistiques();
 
 				std::stringstream ss;
 				ss << "<p>Opérateur : " << noeud->nom() << "</p>";
 				ss << "<hr/>";
 				ss << "<p>Temps d'exécution :";
-				ss << "<p>- dernière : " << operateur->temps_execution() << " secondes.</p>";
-				ss << "<p>- minimum : " << operateur->min_temps_execution() << " secondes.</p>";
-				ss << "<p>- agrégé : " << operateur->temps_agrege() << " secondes.</p>";
-				ss << "<p>- minimum agrégé : " << operateur->min_temps_agrege() << " secondes.</p>";
+				ss << "<p>- dernière : " << stats.temps_dernier << " secondes.</p>";
+				ss << "<p>- médiane : " << stats.temps_median << " secondes.</p>";
+				ss << "<p>- 95e percentile : " << stats.temps_p95 << " secondes.</p>";
+				ss << "<p>- minimum : " << stats.temps_min << " secondes.</p>";
+				ss << "<p>- maximum : " << stats.temps_max << " secondes.</p>";
+				ss << "<p>- agrégé : " << stats.temps_agrege_dernier << " secondes.</p>";
+				ss << "<p>- minimum agrégé : " << stats.temps_agrege_min << " secondes.</p>";
 				ss << "<hr/>";
-				ss << "<p>Nombre d'exécution : " << operateur->nombre_executions() << "</p>";
+				ss << "<p>Nombre d'exécution : " << stats.nombre_executions << "</p>";
+				ss << "<p>Succès du cache : " << stats.taux_succes_cache() * 100.0 << " %</p>";
+				ss << "<hr/>";
+				ss << "<p>Points traités par seconde :";
+				ss << "<p>- entrée : " << stats.debit(stats.points_entree) << "</p>";
+				ss << "<p>- sortie : " << stats.debit(stats.points_sortie) << "</p>";
+				ss << "<p>Mémoire de la sortie : " << stats.octets_dernier / 1024 << " Ko</p>";
 				ss << "<hr/>";
 
 				QToolTip::showText(mouseEvent->screenPos(), ss.str().c_str());
@@ -28,6 +28,7 @@
 #include <glm/gtc/matrix_inverse.hpp>
 #include <iostream>
 #include <kamikaze/renderbuffer.h>
+#include <kamikaze/trace.h>
 
 #include <QApplication>
 #include <QCheckBox>
@@ -124,14 +125,16 @@ void Viewer::paintGL()
 		for (auto &node : m_context->scene->nodes()) {
 			auto object = static_cast<Object *>(node.get());
 
-			if (!object->collection()) {
+			/* The published result of the last evaluation, the one being
+			 * evaluated is never drawn. */
+			const auto collection = object->collection();
+
+			if (!collection) {
 				continue;
 			}
 
 			const bool active_object = (object == m_context->scene->active_node());
 
-			const auto collection = object->collection();
-
 			if (object->parent()) {
 				m_stack.push(object->parent()->matrix());
 			}
@@ -140,8 +143,11 @@ void Viewer::paintGL()
 
 			for (auto &prim : collection->primitives()) {
 				/* update prim before drawing */
-				prim->update();
-				prim->prepareRenderData();
+				{
+					PorteeTrace trace("rendu", prim->name().c_str());
+					prim->update();
+					prim->prepareRenderData();
+				}
 
 				if (prim->drawBBox()) {
 					prim->bbox()->render(m_viewer_context);